@@ -0,0 +1,69 @@
+#include <string.h>
+#include "audio_arena.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 在一个区域中切出一块，放不下时返回NULL
+static void *audio_arena_take(audio_arena_t *arena, uint8_t region, size_t size)
+{
+    void *block;
+
+    if (arena->base[region] == NULL || arena->size[region] - arena->used[region] < size) {
+        return NULL;
+    }
+    block = arena->base[region] + arena->used[region];
+    arena->used[region] += size;
+    return block;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_arena_init(audio_arena_t *arena, void *internal, size_t internal_size, void *external, size_t external_size)
+{
+    memset(arena, 0, sizeof(audio_arena_t));
+    arena->base[AUDIO_ARENA_REGION_INTERNAL] = (uint8_t *)internal;
+    arena->size[AUDIO_ARENA_REGION_INTERNAL] = (internal != NULL) ? internal_size : 0;
+    arena->base[AUDIO_ARENA_REGION_EXTERNAL] = (uint8_t *)external;
+    arena->size[AUDIO_ARENA_REGION_EXTERNAL] = (external != NULL) ? external_size : 0;
+}
+
+// 按放置策略切出一块
+void *audio_arena_alloc(audio_arena_t *arena, const char *name, size_t size, audio_arena_place_t place)
+{
+    uint8_t region = AUDIO_ARENA_REGION_INTERNAL;
+    void *block = NULL;
+
+    size = (size + AUDIO_ARENA_ALIGN - 1) & ~(size_t)(AUDIO_ARENA_ALIGN - 1);
+    if (place == AUDIO_ARENA_ANY) {
+        region = AUDIO_ARENA_REGION_EXTERNAL;
+        block = audio_arena_take(arena, region, size);
+    }
+    // PSRAM不存在或已满时退回内部RAM
+    if (block == NULL) {
+        region = AUDIO_ARENA_REGION_INTERNAL;
+        block = audio_arena_take(arena, region, size);
+    }
+    if (block == NULL) {
+        arena->failed += size;
+        return NULL;
+    }
+
+    if (arena->count < AUDIO_ARENA_MAX_ENTRIES) {
+        arena->entries[arena->count].name = name;
+        arena->entries[arena->count].size = (uint32_t)size;
+        arena->entries[arena->count].region = region;
+        arena->count++;
+    }
+    return block;
+}
+
+// 区域名称
+const char *audio_arena_region_name(uint8_t region)
+{
+    return (region == AUDIO_ARENA_REGION_EXTERNAL) ? "psram" : "internal";
+}
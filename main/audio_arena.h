@@ -0,0 +1,83 @@
+#ifndef __AUDIO_ARENA_H__
+#define __AUDIO_ARENA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* alignment of every block, covers task stacks and DMA-read buffers */
+#define AUDIO_ARENA_ALIGN           (16)
+/* blocks recorded for the report */
+#define AUDIO_ARENA_MAX_ENTRIES     (12)
+
+/* where a block may live */
+typedef enum {
+    AUDIO_ARENA_INTERNAL,           /* task stacks, control blocks, anything a DMA callback reads */
+    AUDIO_ARENA_ANY,                /* touched from tasks only, PSRAM first when the arena has it */
+} audio_arena_place_t;
+
+/* memory regions of the arena */
+typedef enum {
+    AUDIO_ARENA_REGION_INTERNAL,
+    AUDIO_ARENA_REGION_EXTERNAL,
+    AUDIO_ARENA_REGIONS,
+} audio_arena_region_t;
+
+/* one block handed out, for the report */
+typedef struct {
+    const char  *name;              /*!< what the block holds */                // 用途
+    uint32_t    size;               /*!< bytes, after alignment */              // 字节数（对齐后）
+    uint8_t     region;             /*!< audio_arena_region_t */                // 所在区域
+} audio_arena_entry_t;
+
+/**
+ * 音频内存池（arena）
+ *
+ * 开机时预留的固定内存区，音频子系统的缓冲区、任务栈和控制块都从这里按顺序切出，从不归还，
+ * 连接和断开不再触碰堆，与 WiFi、TLS、Bluedroid 共用的内部堆不会因为反复重连产生碎片。
+ * 分两个区域：内部RAM（链接时静态保留）和可选的PSRAM（开机时一次性申请）。
+ * 放置策略：任务栈、控制块以及DMA回调会读取的数据必须在内部RAM；只在任务中访问的大缓冲区优先放在PSRAM，
+ * PSRAM不存在或已满时退回内部RAM。内部RAM不够时分配失败，由调用者在开机日志中报错，
+ * 报告给出各区域的预留量与使用量以及每一块的用途，用来调整预留大小。
+ * 只在开机时单任务调用，不加锁。
+ */
+typedef struct {
+    uint8_t             *base[AUDIO_ARENA_REGIONS];     /*!< start of each region, NULL if absent */   // 各区域起始地址
+    size_t              size[AUDIO_ARENA_REGIONS];      /*!< bytes reserved */                          // 预留字节数
+    size_t              used[AUDIO_ARENA_REGIONS];      /*!< bytes handed out */                        // 已分配字节数
+    size_t              failed;                         /*!< bytes asked for that did not fit */       // 分配失败的字节数
+    audio_arena_entry_t entries[AUDIO_ARENA_MAX_ENTRIES];   /*!< blocks in order */                     // 已分配的各块
+    uint8_t             count;                          /*!< blocks handed out */                       // 已分配的块数
+} audio_arena_t;
+
+/**
+ * @brief  初始化
+ *
+ * @param [out] arena          内存池
+ * @param [in]  internal       内部RAM区域，按 AUDIO_ARENA_ALIGN 对齐
+ * @param [in]  internal_size  内部RAM区域字节数
+ * @param [in]  external       PSRAM区域，没有时为NULL
+ * @param [in]  external_size  PSRAM区域字节数
+ */
+void audio_arena_init(audio_arena_t *arena, void *internal, size_t internal_size, void *external, size_t external_size);
+
+/**
+ * @brief  按放置策略切出一块（开机时调用）
+ *
+ * @param [in] arena  内存池
+ * @param [in] name   用途，须在内存池的生命周期内有效
+ * @param [in] size   字节数
+ * @param [in] place  放置策略
+ *
+ * @return  the block, or NULL if it does not fit（放不下时返回NULL）
+ */
+void *audio_arena_alloc(audio_arena_t *arena, const char *name, size_t size, audio_arena_place_t place);
+
+/**
+ * @brief  区域名称
+ *
+ * @param [in] region  audio_arena_region_t
+ */
+const char *audio_arena_region_name(uint8_t region);
+
+#endif /* __AUDIO_ARENA_H__ */
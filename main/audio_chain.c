@@ -0,0 +1,207 @@
+#include <string.h>
+#include "audio_chain.h"
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#else
+#include <time.h>
+#endif
+
+/* states of the chain, only the output path enters RUNNING and only the control path CONFIGURING */
+enum {
+    AUDIO_CHAIN_IDLE = 0,
+    AUDIO_CHAIN_RUNNING,
+    AUDIO_CHAIN_CONFIGURING,
+};
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 清空一组统计
+static void audio_chain_stats_clear(audio_chain_stats_t *st)
+{
+    st->blocks = 0;
+    st->cycles_min = UINT32_MAX;
+    st->cycles_max = 0;
+    st->cycles_sum = 0;
+}
+
+// 累计一块的耗时
+static void audio_chain_stats_add(audio_chain_stats_t *st, uint32_t cycles)
+{
+    st->blocks++;
+    st->cycles_sum += cycles;
+    if (cycles < st->cycles_min) {
+        st->cycles_min = cycles;
+    }
+    if (cycles > st->cycles_max) {
+        st->cycles_max = cycles;
+    }
+}
+
+// 清空整条链的统计
+static void audio_chain_clear(audio_chain_t *chain)
+{
+    for (int k = 0; k < chain->count; k++) {
+        audio_chain_stats_clear(&chain->stages[k].stats);
+    }
+    audio_chain_stats_clear(&chain->total);
+    chain->blocks = 0;
+}
+
+// 一块的实时预算
+static void audio_chain_set_format(audio_chain_t *chain, uint32_t sample_rate, uint8_t ch_count)
+{
+    chain->sample_rate = sample_rate;
+    chain->ch_count = ch_count;
+    atomic_store(&chain->budget, (uint32_t)((uint64_t)audio_chain_clock_hz() * AUDIO_CHAIN_BLOCK_FRAMES / sample_rate));
+}
+
+// 统计满一轮：发布快照
+static void audio_chain_publish(audio_chain_t *chain)
+{
+    /* a snapshot the reporter has not logged yet is simply replaced on the next round */
+    if (!atomic_load(&chain->report_ready)) {
+        for (int k = 0; k < chain->count; k++) {
+            chain->stages[k].report = chain->stages[k].stats;
+        }
+        chain->total_report = chain->total;
+        atomic_store(&chain->report_ready, true);
+    }
+    audio_chain_clear(chain);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 时钟
+uint32_t audio_chain_clock(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_cpu_get_cycle_count();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+// 时钟频率
+uint32_t audio_chain_clock_hz(void)
+{
+#ifdef ESP_PLATFORM
+    /* follows the current CPU frequency, so the budget stays right when the clock is scaled */
+    return esp_rom_get_cpu_ticks_per_us() * 1000000u;
+#else
+    return 1000000000u;
+#endif
+}
+
+// 初始化
+void audio_chain_init(audio_chain_t *chain, uint32_t sample_rate, uint8_t ch_count)
+{
+    memset(chain, 0, sizeof(audio_chain_t));
+    atomic_init(&chain->state, AUDIO_CHAIN_IDLE);
+    atomic_init(&chain->report_ready, false);
+    atomic_init(&chain->budget, 0);
+    audio_chain_set_format(chain, sample_rate, ch_count);
+    audio_chain_clear(chain);
+}
+
+// 注册一级
+bool audio_chain_add(audio_chain_t *chain, const audio_chain_stage_desc_t *desc, void *ctx)
+{
+    audio_chain_stage_t *st;
+
+    if (chain->count >= AUDIO_CHAIN_MAX_STAGES) {
+        return false;
+    }
+    st = &chain->stages[chain->count];
+    st->desc = desc;
+    st->ctx = ctx;
+    audio_chain_stats_clear(&st->stats);
+    audio_chain_stats_clear(&st->report);
+    chain->count++;
+    return true;
+}
+
+// 逐级重新配置
+void audio_chain_configure(audio_chain_t *chain, uint32_t sample_rate, uint8_t ch_count)
+{
+    int expected = AUDIO_CHAIN_IDLE;
+
+    /* a block holds the chain for a fraction of a millisecond and never waits, so spinning is short */
+    while (!atomic_compare_exchange_weak(&chain->state, &expected, AUDIO_CHAIN_CONFIGURING)) {
+        expected = AUDIO_CHAIN_IDLE;
+    }
+    audio_chain_set_format(chain, sample_rate, ch_count);
+    for (int k = 0; k < chain->count; k++) {
+        const audio_chain_stage_desc_t *desc = chain->stages[k].desc;
+        if (desc->configure) {
+            desc->configure(chain->stages[k].ctx, sample_rate, ch_count);
+        }
+    }
+    audio_chain_clear(chain);
+    atomic_store(&chain->state, AUDIO_CHAIN_IDLE);
+}
+
+// 整条链的延迟
+uint32_t audio_chain_latency(const audio_chain_t *chain)
+{
+    uint32_t frames = 0;
+
+    for (int k = 0; k < chain->count; k++) {
+        frames += chain->stages[k].desc->latency;
+    }
+    return frames;
+}
+
+// 运行整条链
+bool audio_chain_process(audio_chain_t *chain, int16_t *pcm, size_t frames)
+{
+    int expected = AUDIO_CHAIN_IDLE;
+    uint8_t ch;
+
+    if (!atomic_compare_exchange_strong(&chain->state, &expected, AUDIO_CHAIN_RUNNING)) {
+        return false;
+    }
+    ch = chain->ch_count;
+
+    while (frames > 0) {
+        size_t n = (frames > AUDIO_CHAIN_BLOCK_FRAMES) ? AUDIO_CHAIN_BLOCK_FRAMES : frames;
+        bool full = (n == AUDIO_CHAIN_BLOCK_FRAMES);
+        uint32_t start = audio_chain_clock();
+        uint32_t t = start;
+
+        for (int k = 0; k < chain->count; k++) {
+            audio_chain_stage_t *st = &chain->stages[k];
+            uint32_t now;
+
+            if (st->desc->bypassed && st->desc->bypassed(st->ctx)) {
+                continue;
+            }
+            st->desc->process(st->ctx, pcm, n, ch);
+            // 每级结束时读一次时钟，作为下一级的起点
+            now = audio_chain_clock();
+            if (full) {
+                audio_chain_stats_add(&st->stats, now - t);
+            }
+            t = now;
+        }
+        if (full) {
+            audio_chain_stats_add(&chain->total, audio_chain_clock() - start);
+            if (++chain->blocks >= AUDIO_CHAIN_REPORT_BLOCKS) {
+                audio_chain_publish(chain);
+            }
+        }
+
+        pcm += n * ch;
+        frames -= n;
+    }
+
+    atomic_store(&chain->state, AUDIO_CHAIN_IDLE);
+    return true;
+}
@@ -0,0 +1,146 @@
+#ifndef __AUDIO_CHAIN_H__
+#define __AUDIO_CHAIN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* maximum stages in a chain */
+#define AUDIO_CHAIN_MAX_STAGES      (8)
+/* frames per chain block, one I2S DMA descriptor */
+#define AUDIO_CHAIN_BLOCK_FRAMES    (240)
+/* cost statistics are published every this many full blocks (about 5 s at 44.1 kHz) */
+#define AUDIO_CHAIN_REPORT_BLOCKS   (1000)
+
+/**
+ * @brief  处理一个块（原地，可在DMA回调中运行：不等待、不打印日志）
+ *
+ * @param [in]     ctx       处理级的状态
+ * @param [in,out] pcm       16位交织PCM
+ * @param [in]     frames    帧数，不超过 AUDIO_CHAIN_BLOCK_FRAMES
+ * @param [in]     ch_count  声道数
+ */
+typedef void (*audio_chain_process_t)(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count);
+
+/**
+ * @brief  按新的采样率和声道数重新配置（控制路径）
+ *
+ * @param [in] ctx          处理级的状态
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+typedef void (*audio_chain_configure_t)(void *ctx, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  本块是否可以跳过（直通），跳过的块不计入耗时统计
+ *
+ * @param [in] ctx  处理级的状态
+ */
+typedef bool (*audio_chain_bypass_t)(void *ctx);
+
+/* one processing stage, registered once and never changed */
+typedef struct {
+    const char              *name;          /*!< name in the statistics */              // 名称
+    audio_chain_process_t   process;        /*!< in-place block kernel */               // 块处理函数
+    audio_chain_configure_t configure;      /*!< stream format change, may be NULL */   // 格式变化，可为NULL
+    audio_chain_bypass_t    bypassed;       /*!< pass-through test, NULL runs always */  // 直通判断，可为NULL
+    uint16_t                latency;        /*!< frames the stage delays the signal */  // 处理级引入的延迟（帧）
+} audio_chain_stage_desc_t;
+
+/* cost of one stage, in clock ticks per block */
+typedef struct {
+    uint32_t blocks;            /*!< blocks the stage ran on */                 // 处理的块数
+    uint32_t cycles_min;        /*!< fastest block */                           // 最短耗时
+    uint32_t cycles_max;        /*!< slowest block */                           // 最长耗时
+    uint64_t cycles_sum;        /*!< all blocks, summed */                      // 耗时总和
+} audio_chain_stats_t;
+
+/* a registered stage with its statistics */
+typedef struct {
+    const audio_chain_stage_desc_t *desc;   /*!< what the stage does */                 // 处理级描述
+    void                *ctx;               /*!< state handed to the callbacks */       // 处理级状态
+    audio_chain_stats_t stats;              /*!< accumulated on the output path */      // 处理路径中累计的统计
+    audio_chain_stats_t report;             /*!< snapshot handed to the reporter */     // 待输出的快照
+} audio_chain_stage_t;
+
+/**
+ * 音频处理链
+ *
+ * 处理级按注册顺序组成一条链，在输出路径上对 ringbuffer 取出的数据段原地处理，数据段按 AUDIO_CHAIN_BLOCK_FRAMES 切块，
+ * 每块依次经过各级。每级每块用时钟计时（目标板上为CPU周期计数器，主机上为单调时钟纳秒），累计最短/平均/最长耗时，
+ * 与整条链的耗时一起定期发布快照，并给出一块的实时预算，用来观察余量。只统计满块，尾部的短块照常处理但不计时。
+ * 采样率或声道数变化时由 audio_chain_configure 在控制路径中逐级重新配置，期间处理路径跳过整条链、不触碰各级状态，由调用者输出静音。
+ * 注册在输出开始之前完成，之后链的结构不再变化。
+ */
+typedef struct {
+    audio_chain_stage_t stages[AUDIO_CHAIN_MAX_STAGES];   /*!< in processing order */   // 按处理顺序排列的各级
+    uint8_t             count;              /*!< registered stages */                   // 已注册的级数
+    uint8_t             ch_count;           /*!< channels of the stream */              // 声道数
+    uint32_t            sample_rate;        /*!< rate of the stream */                  // 采样率
+    atomic_int          state;              /*!< idle, running a block, or configuring */   // 空闲/处理中/配置中
+    audio_chain_stats_t total;              /*!< whole chain per block */               // 整条链的统计
+    audio_chain_stats_t total_report;       /*!< snapshot of the whole chain */         // 整条链的快照
+    uint32_t            blocks;             /*!< full blocks since the last snapshot */ // 累计的满块数
+    _Atomic uint32_t    budget;             /*!< clock ticks one block lasts in real time */   // 一块的实时预算
+    atomic_bool         report_ready;       /*!< a snapshot waits to be logged */       // 统计待输出
+} audio_chain_t;
+
+/**
+ * @brief  初始化为空链
+ *
+ * @param [out] chain        处理链
+ * @param [in]  sample_rate  采样率
+ * @param [in]  ch_count     声道数
+ */
+void audio_chain_init(audio_chain_t *chain, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  在链尾注册一级（输出开始之前调用）
+ *
+ * @param [in] chain  处理链
+ * @param [in] desc   处理级描述，须在链的生命周期内有效
+ * @param [in] ctx    处理级状态
+ *
+ * @return  false if the chain is full（链已满）
+ */
+bool audio_chain_add(audio_chain_t *chain, const audio_chain_stage_desc_t *desc, void *ctx);
+
+/**
+ * @brief  按新的采样率和声道数逐级重新配置，等待正在处理的块结束后进行（控制路径）
+ *
+ * @param [in] chain        处理链
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_chain_configure(audio_chain_t *chain, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  对一段PCM原地运行整条链（可在DMA回调中调用）
+ *
+ * @param [in]     chain   处理链
+ * @param [in,out] pcm     16位交织PCM
+ * @param [in]     frames  帧数
+ *
+ * @return  false if the chain is being configured and the PCM was left untouched（正在重新配置，未处理）
+ */
+bool audio_chain_process(audio_chain_t *chain, int16_t *pcm, size_t frames);
+
+/**
+ * @brief  整条链引入的延迟（帧），跳过的级也计入，它们随时可能重新打开
+ *
+ * @param [in] chain  处理链
+ */
+uint32_t audio_chain_latency(const audio_chain_t *chain);
+
+/**
+ * @brief  当前时钟（目标板上为CPU周期，主机上为纳秒），也供链外的处理计时
+ */
+uint32_t audio_chain_clock(void);
+
+/**
+ * @brief  时钟频率（Hz）
+ */
+uint32_t audio_chain_clock_hz(void);
+
+#endif /* __AUDIO_CHAIN_H__ */
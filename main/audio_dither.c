@@ -0,0 +1,35 @@
+#include <string.h>
+#include "audio_dither.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_dither_init(audio_dither_t *dither)
+{
+    memset(dither->err, 0, sizeof(dither->err));
+    dither->seed = 1;
+    dither->cycles = 0;
+    dither->samples = 0;
+    atomic_store(&dither->cycles_per_sample_q8, 0);
+    atomic_store(&dither->report_ready, false);
+}
+
+// 累计耗时
+void audio_dither_account(audio_dither_t *dither, uint32_t cycles, size_t samples)
+{
+    dither->cycles += cycles;
+    dither->samples += samples;
+    if (dither->samples < AUDIO_DITHER_REPORT_SAMPLES) {
+        return;
+    }
+
+    /* a snapshot the reporter has not logged yet is simply replaced on the next round */
+    if (!atomic_load(&dither->report_ready)) {
+        atomic_store(&dither->cycles_per_sample_q8, (uint32_t)(((uint64_t)dither->cycles << 8) / dither->samples));
+        atomic_store(&dither->report_ready, true);
+    }
+    dither->cycles = 0;
+    dither->samples = 0;
+}
@@ -0,0 +1,136 @@
+#include <string.h>
+#include "audio_drift.h"
+
+/* time constant of the proportional correction, in seconds */
+#define DRIFT_CORRECT_TIME_S        (20)
+/* smoothing of the fill error, per block (1 / 2^N) */
+#define DRIFT_ERR_SMOOTH_SHIFT      (8)
+/* one ppm as a Q32 step */
+#define DRIFT_PPM_Q32               (4295)
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 四点三次（Catmull-Rom）插值，t为Q15
+static inline int16_t audio_drift_cubic(int32_t x0, int32_t x1, int32_t x2, int32_t x3, int32_t t)
+{
+    /* coefficients are kept doubled so every term stays integral */
+    int32_t c3 = -x0 + 3 * x1 - 3 * x2 + x3;
+    int32_t c2 = 2 * x0 - 5 * x1 + 4 * x2 - x3;
+    int32_t c1 = x2 - x0;
+    int32_t y;
+
+    y = (int32_t)(((int64_t)c3 * t) >> 15) + c2;
+    y = (int32_t)(((int64_t)y * t) >> 15) + c1;
+    y = (int32_t)(((int64_t)y * t) >> 15);
+    y = (y >> 1) + x1;
+
+    if (y > INT16_MAX) {
+        y = INT16_MAX;
+    } else if (y < INT16_MIN) {
+        y = INT16_MIN;
+    }
+    return (int16_t)y;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 配置漂移补偿
+void audio_drift_configure(audio_drift_t *drift, uint32_t sample_rate, uint8_t ch_count)
+{
+    memset(drift, 0, sizeof(audio_drift_t));
+    drift->sample_rate = sample_rate;
+    drift->ch_count = (ch_count > AUDIO_DRIFT_MAX_CH) ? AUDIO_DRIFT_MAX_CH : ch_count;
+    /* an error of one frame is corrected over DRIFT_CORRECT_TIME_S seconds */
+    drift->gain_q32 = ((int64_t)1 << 32) / ((int64_t)sample_rate * DRIFT_CORRECT_TIME_S);
+    drift->pos = (int64_t)AUDIO_DRIFT_HIST_FRAMES << 32;
+}
+
+// 漂移估计
+void audio_drift_update(audio_drift_t *drift, size_t fill_bytes, size_t target_bytes)
+{
+    int32_t frame_bytes = drift->ch_count * sizeof(int16_t);
+    int32_t err = ((int32_t)fill_bytes - (int32_t)target_bytes) / frame_bytes;
+    int64_t delta;
+
+    // 水位误差长时间平滑，滤掉数据包突发到达造成的波动
+    drift->err_avg_q8 += (err * 256 - drift->err_avg_q8) >> DRIFT_ERR_SMOOTH_SHIFT;
+
+    delta = ((int64_t)drift->err_avg_q8 * drift->gain_q32) >> 8;
+    if (delta > AUDIO_DRIFT_MAX_PPM * DRIFT_PPM_Q32) {
+        delta = AUDIO_DRIFT_MAX_PPM * DRIFT_PPM_Q32;
+    } else if (delta < -AUDIO_DRIFT_MAX_PPM * DRIFT_PPM_Q32) {
+        delta = -AUDIO_DRIFT_MAX_PPM * DRIFT_PPM_Q32;
+    }
+    drift->step_delta = (int32_t)delta;
+}
+
+// 当前修正（ppm）
+int32_t audio_drift_ppm(const audio_drift_t *drift)
+{
+    return drift->step_delta / DRIFT_PPM_Q32;
+}
+
+// 分数重采样
+size_t audio_drift_resample(audio_drift_t *drift, const int16_t *in, size_t in_frames,
+                            int16_t *out, size_t out_frames, size_t *produced)
+{
+    const int ch = drift->ch_count;
+    const int64_t step = ((int64_t)1 << 32) + drift->step_delta;
+    int16_t *s = drift->scratch;
+    int64_t pos = drift->pos;
+    size_t total, consumed, n = 0;
+
+    if (out_frames > AUDIO_DRIFT_MAX_BLOCK) {
+        out_frames = AUDIO_DRIFT_MAX_BLOCK;
+    }
+    if (in_frames > audio_drift_max_input(out_frames)) {
+        in_frames = audio_drift_max_input(out_frames);
+    }
+
+    // 历史帧和本次输入拼接成连续的流，插值时无需判断边界
+    memcpy(s, drift->hist, AUDIO_DRIFT_HIST_FRAMES * ch * sizeof(int16_t));
+    memcpy(s + AUDIO_DRIFT_HIST_FRAMES * ch, in, in_frames * ch * sizeof(int16_t));
+    total = AUDIO_DRIFT_HIST_FRAMES + in_frames;
+
+    if (ch == 2) {
+        while (n < out_frames) {
+            int32_t idx = (int32_t)(pos >> 32);
+            if ((size_t)idx + 2 >= total) {
+                break;
+            }
+            int32_t t = (int32_t)((uint32_t)pos >> 17);
+            const int16_t *x = s + (idx - 1) * 2;
+            out[n * 2] = audio_drift_cubic(x[0], x[2], x[4], x[6], t);
+            out[n * 2 + 1] = audio_drift_cubic(x[1], x[3], x[5], x[7], t);
+            n++;
+            pos += step;
+        }
+    } else {
+        while (n < out_frames) {
+            int32_t idx = (int32_t)(pos >> 32);
+            if ((size_t)idx + 2 >= total) {
+                break;
+            }
+            int32_t t = (int32_t)((uint32_t)pos >> 17);
+            const int16_t *x = s + (idx - 1);
+            out[n] = audio_drift_cubic(x[0], x[1], x[2], x[3], t);
+            n++;
+            pos += step;
+        }
+    }
+
+    /* frames before idx - 1 are no longer needed; keep the last three as history */
+    consumed = (size_t)(pos >> 32) - AUDIO_DRIFT_HIST_FRAMES;
+    if (consumed > in_frames) {
+        consumed = in_frames;
+    }
+    memcpy(drift->hist, s + consumed * ch, AUDIO_DRIFT_HIST_FRAMES * ch * sizeof(int16_t));
+    drift->pos = pos - ((int64_t)consumed << 32);
+
+    *produced = n;
+    return consumed;
+}
@@ -0,0 +1,92 @@
+#ifndef __AUDIO_DRIFT_H__
+#define __AUDIO_DRIFT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* maximum channels handled by the resampler */
+#define AUDIO_DRIFT_MAX_CH          (2)
+/* history frames kept between blocks for the 4-tap interpolator */
+#define AUDIO_DRIFT_HIST_FRAMES     (3)
+/* largest output block in frames */
+#define AUDIO_DRIFT_MAX_BLOCK       (256)
+/* largest correction in ppm */
+#define AUDIO_DRIFT_MAX_PPM         (1000)
+
+/**
+ * 时钟漂移补偿：漂移估计 + 定点分数重采样
+ *
+ * 手机的采样时钟和ESP32的I2S时钟存在偏差，缓冲区水位会缓慢上涨或下降。
+ * 估计器对水位误差做长时间平滑，按比例换算成 ppm 级的重采样比例修正：
+ * 水位高于目标时多消耗输入，低于目标时少消耗输入，使缓冲区保持在目标附近。
+ * 比例控制的时间常数为 20 s，100 ppm 的漂移只留下约 2 ms 的稳态偏差，
+ * 1000 ppm 的最大修正约为 1.7 音分，人耳无法察觉。
+ *
+ * 重采样器为四点三次（Catmull-Rom）插值，相位使用 Q32 定点，分辨率远小于 1 ppm。
+ * 比例为 1 且相位为 0 时输出与输入逐位相同。
+ */
+typedef struct {
+    /* drift estimator */
+    uint32_t sample_rate;      /*!< negotiated sample rate */                          // 采样率
+    uint8_t  ch_count;         /*!< channels per frame */                              // 声道数
+    int32_t  err_avg_q8;       /*!< smoothed fill error in frames, Q8 */               // 平滑后的水位误差（帧）
+    int64_t  gain_q32;         /*!< step correction per frame of error, Q32 */         // 每帧误差对应的步长修正
+    int32_t  step_delta;       /*!< step correction, Q32 (1 ppm ~ 4295) */             // 步长修正
+
+    /* resampler */
+    int64_t  pos;              /*!< read position in the scratch stream, Q32 */        // 读位置（Q32）
+    int16_t  hist[AUDIO_DRIFT_HIST_FRAMES * AUDIO_DRIFT_MAX_CH];   /*!< last input frames */   // 历史帧
+    int16_t  scratch[(AUDIO_DRIFT_HIST_FRAMES + AUDIO_DRIFT_MAX_BLOCK + 8) * AUDIO_DRIFT_MAX_CH];
+} audio_drift_t;
+
+/**
+ * @brief  配置漂移补偿并重置状态
+ *
+ * @param [out] drift        漂移补偿器
+ * @param [in]  sample_rate  采样率
+ * @param [in]  ch_count     声道数（1或2）
+ */
+void audio_drift_configure(audio_drift_t *drift, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  漂移估计：每个输出块调用一次，更新重采样比例
+ *
+ * @param [in] drift         漂移补偿器
+ * @param [in] fill_bytes    当前缓冲区水位（字节）
+ * @param [in] target_bytes  缓冲目标（字节）
+ */
+void audio_drift_update(audio_drift_t *drift, size_t fill_bytes, size_t target_bytes);
+
+/**
+ * @brief  当前的重采样修正（ppm），正数表示比输入时钟更快地消耗数据
+ *
+ * @param [in] drift  漂移补偿器
+ */
+int32_t audio_drift_ppm(const audio_drift_t *drift);
+
+/**
+ * @brief  输入帧数上限：产生 out_frames 帧输出最多需要的输入帧数
+ *
+ * @param [in] out_frames  输出帧数
+ */
+static inline size_t audio_drift_max_input(size_t out_frames)
+{
+    return out_frames + 4;
+}
+
+/**
+ * @brief  分数重采样：从输入产生最多 out_frames 帧输出
+ *
+ * @param [in]  drift       漂移补偿器
+ * @param [in]  in          输入PCM（16位交织）
+ * @param [in]  in_frames   输入帧数
+ * @param [out] out         输出PCM（16位交织）
+ * @param [in]  out_frames  最多输出的帧数，不大于 AUDIO_DRIFT_MAX_BLOCK
+ * @param [out] produced    实际输出的帧数
+ *
+ * @return  input frames consumed（消耗的输入帧数）
+ */
+size_t audio_drift_resample(audio_drift_t *drift, const int16_t *in, size_t in_frames,
+                            int16_t *out, size_t out_frames, size_t *produced);
+
+#endif /* __AUDIO_DRIFT_H__ */
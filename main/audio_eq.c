@@ -0,0 +1,258 @@
+#include <string.h>
+#include <math.h>
+#include "audio_eq.h"
+
+/* one section of a preset */
+typedef struct {
+    audio_eq_band_type_t type;
+    uint16_t freq_hz;           /*!< centre or corner frequency */      // 中心/转折频率
+    int16_t  gain_db10;         /*!< gain, 0.1 dB, ignored by the high pass */  // 增益（0.1 dB）
+    uint16_t q100;              /*!< quality factor, 0.01 */            // 品质因数（0.01）
+} audio_eq_band_t;
+
+typedef struct {
+    const char     *name;
+    int16_t         preamp_db10;    /*!< attenuation ahead of the cascade, 0.1 dB */   // 前级衰减（0.1 dB）
+    uint8_t         bands;
+    audio_eq_band_t band[AUDIO_EQ_MAX_BANDS];
+} audio_eq_preset_def_t;
+
+/* the preamp cancels the largest boost of each preset, so a full scale sine cannot clip */
+static const audio_eq_preset_def_t s_presets[AUDIO_EQ_PRESET_MAX] = {
+    [AUDIO_EQ_PRESET_FLAT] = { "flat", 0, 0, { { 0 } } },
+    [AUDIO_EQ_PRESET_SPEAKER] = { "speaker", -40, 4, {
+        { AUDIO_EQ_HIGH_PASS,  90,     0,  71 },    // 低于喇叭谐振的频段不再推动振膜
+        { AUDIO_EQ_PEAK,       160,   40, 100 },
+        { AUDIO_EQ_PEAK,       3500, -20, 120 },
+        { AUDIO_EQ_HIGH_SHELF, 10000, 20,  71 },
+    } },
+    [AUDIO_EQ_PRESET_BASS] = { "bass", -60, 1, {
+        { AUDIO_EQ_LOW_SHELF,  120,   60,  71 },
+    } },
+    [AUDIO_EQ_PRESET_VOCAL] = { "vocal", -40, 3, {
+        { AUDIO_EQ_HIGH_PASS,  100,    0,  71 },
+        { AUDIO_EQ_PEAK,       250,  -20, 100 },
+        { AUDIO_EQ_PEAK,       2500,  40, 100 },
+    } },
+    [AUDIO_EQ_PRESET_TREBLE] = { "treble", -50, 1, {
+        { AUDIO_EQ_HIGH_SHELF, 6000,  50,  71 },
+    } },
+};
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 系数量化为 Q3.29
+static int32_t audio_eq_quantise(double v)
+{
+    return (int32_t)lrint(v * (double)(1 << AUDIO_EQ_COEF_SHIFT));
+}
+
+// 在备用系数组中设计当前预设，然后原子切换
+// 只在控制路径中运行，可以使用浮点
+static void audio_eq_design(audio_eq_t *eq)
+{
+    const audio_eq_preset_def_t *def = &s_presets[eq->preset];
+    unsigned spare = atomic_load(&eq->active) ^ 1;
+    audio_eq_bank_t *bank = &eq->bank[spare];
+    double scale = pow(10.0, def->preamp_db10 / 200.0);
+
+    /* a block that started before the previous switch may still filter with the spare set */
+    // 两次切换挨得很近时，等处理路径确认已换到工作组再改写备用组；一块最多几百微秒
+    while (atomic_load(&eq->reading) == (int)spare) {
+    }
+
+    bank->bands = 0;
+    for (int i = 0; i < def->bands; i++) {
+        /* a corner too close to Nyquist cannot be realised, e.g. the 10 kHz shelf at 16 kHz */
+        if (def->band[i].freq_hz * 20u >= eq->sample_rate * 9u) {
+            continue;
+        }
+        audio_eq_design_section(&bank->coef[bank->bands], def->band[i].type, def->band[i].freq_hz,
+                                def->band[i].gain_db10, def->band[i].q100, eq->sample_rate,
+                                (bank->bands == 0) ? scale : 1.0);
+        bank->bands++;
+    }
+    atomic_store(&eq->active, spare);
+}
+
+// 处理链适配
+static void audio_eq_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_eq_process((audio_eq_t *)ctx, pcm, frames, ch_count);
+}
+
+static void audio_eq_stage_configure(void *ctx, uint32_t sample_rate, uint8_t ch_count)
+{
+    /* the channel count only matters per block */
+    audio_eq_configure((audio_eq_t *)ctx, sample_rate);
+}
+
+static bool audio_eq_stage_bypassed(void *ctx)
+{
+    return audio_eq_bypassed((const audio_eq_t *)ctx);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 按 RBJ Audio EQ Cookbook 设计一节，scale 为并入前馈系数的前级增益
+void audio_eq_design_section(audio_eq_coef_t *coef, audio_eq_band_type_t type, uint32_t freq_hz,
+                             int32_t gain_db10, uint32_t q100, uint32_t sample_rate, double scale)
+{
+    double a = pow(10.0, gain_db10 / 400.0);
+    double w0 = 2.0 * M_PI * freq_hz / sample_rate;
+    double cw = cos(w0);
+    double alpha = sin(w0) / (2.0 * q100 / 100.0);
+    double sa = 2.0 * sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (type) {
+    case AUDIO_EQ_LOW_SHELF:
+        b0 = a * ((a + 1) - (a - 1) * cw + sa);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cw);
+        b2 = a * ((a + 1) - (a - 1) * cw - sa);
+        a0 = (a + 1) + (a - 1) * cw + sa;
+        a1 = -2 * ((a - 1) + (a + 1) * cw);
+        a2 = (a + 1) + (a - 1) * cw - sa;
+        break;
+    case AUDIO_EQ_HIGH_SHELF:
+        b0 = a * ((a + 1) + (a - 1) * cw + sa);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cw);
+        b2 = a * ((a + 1) + (a - 1) * cw - sa);
+        a0 = (a + 1) - (a - 1) * cw + sa;
+        a1 = 2 * ((a - 1) - (a + 1) * cw);
+        a2 = (a + 1) - (a - 1) * cw - sa;
+        break;
+    case AUDIO_EQ_LOW_PASS:
+        b0 = (1 - cw) / 2;
+        b1 = 1 - cw;
+        b2 = (1 - cw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cw;
+        a2 = 1 - alpha;
+        break;
+    case AUDIO_EQ_HIGH_PASS:
+        b0 = (1 + cw) / 2;
+        b1 = -(1 + cw);
+        b2 = (1 + cw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cw;
+        a2 = 1 - alpha;
+        break;
+    case AUDIO_EQ_PEAK:
+    default:
+        b0 = 1 + alpha * a;
+        b1 = -2 * cw;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cw;
+        a2 = 1 - alpha / a;
+        break;
+    }
+
+    coef->b0 = audio_eq_quantise(scale * b0 / a0);
+    coef->b1 = audio_eq_quantise(scale * b1 / a0);
+    coef->b2 = audio_eq_quantise(scale * b2 / a0);
+    coef->a1 = audio_eq_quantise(a1 / a0);
+    coef->a2 = audio_eq_quantise(a2 / a0);
+}
+
+// 初始化
+void audio_eq_init(audio_eq_t *eq, uint32_t sample_rate, audio_eq_preset_t preset)
+{
+    memset(eq->bank, 0, sizeof(eq->bank));
+    atomic_init(&eq->active, 0);
+    atomic_init(&eq->reading, -1);
+    eq->preset = (preset < AUDIO_EQ_PRESET_MAX) ? preset : AUDIO_EQ_PRESET_FLAT;
+    audio_eq_configure(eq, sample_rate);
+}
+
+// 采样率变化
+void audio_eq_configure(audio_eq_t *eq, uint32_t sample_rate)
+{
+    eq->sample_rate = sample_rate;
+    memset(eq->state, 0, sizeof(eq->state));
+    audio_eq_design(eq);
+}
+
+// 切换预设
+bool audio_eq_set_preset(audio_eq_t *eq, audio_eq_preset_t preset)
+{
+    if (preset >= AUDIO_EQ_PRESET_MAX) {
+        return false;
+    }
+    if (preset != eq->preset) {
+        /* the history stays, the new response takes over within a few samples */
+        eq->preset = preset;
+        audio_eq_design(eq);
+    }
+    return true;
+}
+
+// 预设名称
+const char *audio_eq_preset_name(audio_eq_preset_t preset)
+{
+    return (preset < AUDIO_EQ_PRESET_MAX) ? s_presets[preset].name : "unknown";
+}
+
+// 块处理
+void audio_eq_process(audio_eq_t *eq, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    unsigned idx = atomic_load(&eq->active);
+    unsigned cur;
+    const audio_eq_bank_t *bank;
+    int32_t *w = eq->work;
+
+    /* announce the set before checking it is still the active one, so the control path sees every reader */
+    // 读取一次，切换在下一块生效；登记之后工作组又变了就改用新的一组
+    atomic_store(&eq->reading, (int)idx);
+    while ((cur = atomic_load(&eq->active)) != idx) {
+        idx = cur;
+        atomic_store(&eq->reading, (int)idx);
+    }
+    bank = &eq->bank[idx];
+
+    if (bank->bands == 0 || ch_count == 0 || ch_count > AUDIO_EQ_MAX_CH) {
+        atomic_store(&eq->reading, -1);
+        return;
+    }
+
+    while (frames > 0) {
+        size_t n = (frames > AUDIO_EQ_BLOCK_FRAMES) ? AUDIO_EQ_BLOCK_FRAMES : frames;
+        size_t samples = n * ch_count;
+
+        for (size_t i = 0; i < samples; i++) {
+            w[i] = pcm[i] * (1 << AUDIO_EQ_STATE_SHIFT);
+        }
+        // 逐节逐声道，内层循环的系数和状态都在寄存器中
+        for (int k = 0; k < bank->bands; k++) {
+            for (int c = 0; c < ch_count; c++) {
+                audio_eq_section(&bank->coef[k], &eq->state[k][c], w + c, n, ch_count);
+            }
+        }
+        for (size_t i = 0; i < samples; i++) {
+            int32_t y = (w[i] + (1 << (AUDIO_EQ_STATE_SHIFT - 1))) >> AUDIO_EQ_STATE_SHIFT;
+            if (y > INT16_MAX) {
+                y = INT16_MAX;
+            } else if (y < INT16_MIN) {
+                y = INT16_MIN;
+            }
+            pcm[i] = (int16_t)y;
+        }
+
+        pcm += samples;
+        frames -= n;
+    }
+    atomic_store(&eq->reading, -1);
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_eq_stage = {
+    .name = "eq",
+    .process = audio_eq_stage_process,
+    .configure = audio_eq_stage_configure,
+    .bypassed = audio_eq_stage_bypassed,
+};
@@ -0,0 +1,183 @@
+#ifndef __AUDIO_EQ_H__
+#define __AUDIO_EQ_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "audio_chain.h"
+
+/* maximum channels */
+#define AUDIO_EQ_MAX_CH             (2)
+/* biquad sections per preset */
+#define AUDIO_EQ_MAX_BANDS          (4)
+/* fraction bits of the coefficients, Q3.29 leaves room for shelf gains up to +12 dB */
+#define AUDIO_EQ_COEF_SHIFT         (29)
+/* extra fraction bits carried between sections, the output is rounded back to 16 bits once */
+#define AUDIO_EQ_STATE_SHIFT        (8)
+/* frames filtered per pass of the block kernel */
+#define AUDIO_EQ_BLOCK_FRAMES       (256)
+
+/* presets, also the values of the player application setting (plus one) */
+typedef enum {
+    AUDIO_EQ_PRESET_FLAT,       /* bypass */                                    // 直通
+    AUDIO_EQ_PRESET_SPEAKER,    /* small full-range driver of the cube */       // 小尺寸全频喇叭校正
+    AUDIO_EQ_PRESET_BASS,       /* low shelf boost */                           // 低音增强
+    AUDIO_EQ_PRESET_VOCAL,      /* presence boost, less mud */                  // 人声
+    AUDIO_EQ_PRESET_TREBLE,     /* high shelf boost */                          // 高音增强
+    AUDIO_EQ_PRESET_MAX,
+} audio_eq_preset_t;
+
+/* section types */
+typedef enum {
+    AUDIO_EQ_PEAK,              /* peaking bell */          // 峰值
+    AUDIO_EQ_LOW_SHELF,         /* low shelf */             // 低架
+    AUDIO_EQ_HIGH_SHELF,        /* high shelf */            // 高架
+    AUDIO_EQ_HIGH_PASS,         /* second order high pass */    // 二阶高通
+    AUDIO_EQ_LOW_PASS,          /* second order low pass */     // 二阶低通
+} audio_eq_band_type_t;
+
+/* one biquad section, normalised by a0 */
+typedef struct {
+    int32_t b0, b1, b2;         /*!< feed-forward, Q3.29 */                     // 前馈系数
+    int32_t a1, a2;             /*!< feedback, Q3.29 */                         // 反馈系数
+} audio_eq_coef_t;
+
+/* coefficient set of one preset at one sample rate */
+typedef struct {
+    uint8_t         bands;                          /*!< sections in use, 0 bypasses */   // 使用的节数
+    audio_eq_coef_t coef[AUDIO_EQ_MAX_BANDS];       /*!< sections in cascade order */     // 级联的各节系数
+} audio_eq_bank_t;
+
+/* direct form I history of one section and channel, AUDIO_EQ_STATE_SHIFT fraction bits */
+typedef struct {
+    int32_t x1, x2;
+    int32_t y1, y2;
+} audio_eq_state_t;
+
+/**
+ * @brief  一节双二阶滤波（直接I型），原地处理；乘积不超过 2^55，用64位累加后截回状态精度
+ *
+ * @param [in]     c       系数
+ * @param [in,out] s       滤波器状态
+ * @param [in,out] w       带 AUDIO_EQ_STATE_SHIFT 位小数的样本
+ * @param [in]     n       样本数
+ * @param [in]     stride  样本间隔（交织数据为声道数）
+ */
+static inline void audio_eq_section(const audio_eq_coef_t *c, audio_eq_state_t *s, int32_t *w, size_t n, uint8_t stride)
+{
+    const int32_t b0 = c->b0, b1 = c->b1, b2 = c->b2, a1 = c->a1, a2 = c->a2;
+    int32_t x1 = s->x1, x2 = s->x2, y1 = s->y1, y2 = s->y2;
+
+    for (size_t i = 0; i < n; i++, w += stride) {
+        int32_t x = *w;
+        int64_t acc = (int64_t)b0 * x + (int64_t)b1 * x1 + (int64_t)b2 * x2
+                    - (int64_t)a1 * y1 - (int64_t)a2 * y2;
+        int32_t y = (int32_t)(acc >> AUDIO_EQ_COEF_SHIFT);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        *w = y;
+    }
+
+    s->x1 = x1;
+    s->x2 = x2;
+    s->y1 = y1;
+    s->y2 = y2;
+}
+
+/**
+ * 级联双二阶定点均衡器
+ *
+ * 系数按 RBJ 公式用浮点设计后量化为 Q3.29，只在采样率变化（ESP_A2D_AUDIO_CFG_EVT）或切换预设时重新计算，
+ * 计算在控制路径中进行，写入空闲的一组系数后原子切换，处理路径不加锁、全部为定点运算，可在DMA回调中运行。
+ * 处理路径每块开始时登记正在使用的一组，切换前开始的块还在读备用组时，控制路径等它结束再改写。
+ * 处理按块进行：先把整块转为带 8 位小数的32位样本，逐节逐声道滤波（每节的系数和状态在寄存器中），
+ * 最后一次性舍入饱和回16位。预设自带前级衰减，满幅正弦在提升频段也不会削波。
+ */
+typedef struct {
+    audio_eq_bank_t     bank[2];            /*!< active and spare coefficient sets */   // 工作与备用系数组
+    atomic_uint         active;             /*!< index of the set the kernel uses */    // 当前使用的系数组
+    atomic_int          reading;            /*!< set a block is filtering with, -1 between blocks */   // 正在处理的块使用的系数组
+    audio_eq_state_t    state[AUDIO_EQ_MAX_BANDS][AUDIO_EQ_MAX_CH];   /*!< filter history */   // 滤波器状态
+    int32_t             work[AUDIO_EQ_BLOCK_FRAMES * AUDIO_EQ_MAX_CH];    /*!< widened block */    // 块处理缓冲区
+    uint32_t            sample_rate;        /*!< rate the coefficients are designed for */   // 设计采样率
+    audio_eq_preset_t   preset;             /*!< selected preset */                     // 当前预设
+} audio_eq_t;
+
+/**
+ * @brief  初始化并按预设设计系数
+ *
+ * @param [out] eq           均衡器
+ * @param [in]  sample_rate  采样率
+ * @param [in]  preset       预设
+ */
+void audio_eq_init(audio_eq_t *eq, uint32_t sample_rate, audio_eq_preset_t preset);
+
+/**
+ * @brief  采样率变化时重新设计系数并清空滤波器状态（输出停止时调用）
+ *
+ * @param [in] eq           均衡器
+ * @param [in] sample_rate  采样率
+ */
+void audio_eq_configure(audio_eq_t *eq, uint32_t sample_rate);
+
+/**
+ * @brief  切换预设，可在播放中调用（与 audio_eq_configure 在同一任务中）；
+ *         上一次切换前开始的块还未结束时等待它结束，调用任务的优先级应低于处理任务
+ *
+ * @param [in] eq      均衡器
+ * @param [in] preset  预设
+ *
+ * @return  false if the preset is out of range（预设无效）
+ */
+bool audio_eq_set_preset(audio_eq_t *eq, audio_eq_preset_t preset);
+
+/**
+ * @brief  预设名称
+ *
+ * @param [in] preset  预设
+ */
+const char *audio_eq_preset_name(audio_eq_preset_t preset);
+
+/**
+ * @brief  按 RBJ 公式设计一节并量化（控制路径，使用浮点），也供其它处理级使用
+ *
+ * @param [out] coef         系数
+ * @param [in]  type         类型
+ * @param [in]  freq_hz      中心/转折频率
+ * @param [in]  gain_db10    增益（0.1 dB），高通、低通忽略
+ * @param [in]  q100         品质因数（0.01）
+ * @param [in]  sample_rate  采样率
+ * @param [in]  scale        并入前馈系数的增益
+ */
+void audio_eq_design_section(audio_eq_coef_t *coef, audio_eq_band_type_t type, uint32_t freq_hz,
+                             int32_t gain_db10, uint32_t q100, uint32_t sample_rate, double scale);
+
+/**
+ * @brief  对一个PCM块原地均衡
+ *
+ * @param [in]     eq        均衡器
+ * @param [in,out] pcm       16位交织PCM
+ * @param [in]     frames    帧数
+ * @param [in]     ch_count  声道数
+ */
+void audio_eq_process(audio_eq_t *eq, int16_t *pcm, size_t frames, uint8_t ch_count);
+
+/**
+ * @brief  当前预设是否为直通
+ *
+ * @param [in] eq  均衡器
+ */
+static inline bool audio_eq_bypassed(const audio_eq_t *eq)
+{
+    return eq->bank[atomic_load(&eq->active)].bands == 0;
+}
+
+/**
+ * 处理链中的均衡级，ctx 为 audio_eq_t，直通的预设跳过
+ */
+extern const audio_chain_stage_desc_t audio_eq_stage;
+
+#endif /* __AUDIO_EQ_H__ */
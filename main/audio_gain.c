@@ -0,0 +1,129 @@
+#include "audio_gain.h"
+
+/* AVRCP absolute volume 0..0x7F to Q15 gain, 0 mutes, 1..0x7F span -60 dB..0 dB evenly in dB */
+static const uint16_t s_volume_to_gain[128] = {
+        0,    35,    37,    39,    41,    43,    45,    48,
+       51,    53,    56,    60,    63,    66,    70,    74,
+       78,    83,    87,    92,    97,   103,   108,   114,
+      121,   128,   135,   142,   150,   159,   168,   177,
+      187,   197,   208,   220,   232,   245,   259,   273,
+      289,   305,   322,   340,   359,   379,   400,   422,
+      446,   471,   497,   525,   554,   585,   618,   653,
+      689,   728,   768,   811,   857,   904,   955,  1008,
+     1065,  1124,  1187,  1253,  1324,  1398,  1476,  1558,
+     1645,  1737,  1834,  1937,  2045,  2159,  2280,  2408,
+     2542,  2684,  2834,  2993,  3160,  3337,  3523,  3720,
+     3928,  4148,  4379,  4624,  4883,  5156,  5444,  5748,
+     6070,  6409,  6767,  7145,  7545,  7966,  8412,  8882,
+     9378,  9903, 10456, 11041, 11658, 12309, 12998, 13724,
+    14491, 15301, 16157, 17060, 18013, 19020, 20083, 21206,
+    22391, 23643, 24965, 26360, 27834, 29390, 31032, 32768,
+};
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 固定增益
+static void audio_gain_apply_const(int16_t *pcm, size_t samples, int32_t g)
+{
+    size_t i = 0;
+
+    /* two samples per iteration, matching one stereo frame */
+    for (; i + 1 < samples; i += 2) {
+        int32_t a = (pcm[i] * g) >> 15;
+        int32_t b = (pcm[i + 1] * g) >> 15;
+        pcm[i] = (int16_t)a;
+        pcm[i + 1] = (int16_t)b;
+    }
+    if (i < samples) {
+        pcm[i] = (int16_t)((pcm[i] * g) >> 15);
+    }
+}
+
+// 处理链适配
+static void audio_gain_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_gain_process((audio_gain_t *)ctx, pcm, frames, ch_count);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 线性斜坡增益，同一帧内各声道使用相同增益
+void audio_gain_ramp(int16_t *pcm, size_t frames, uint8_t ch_count, int32_t from, int32_t to)
+{
+    /* 15 extra fraction bits over the Q15 gain (unity still fits), so the ramp lands on `to` */
+    int32_t acc = from << 15;
+    int64_t delta = (int64_t)(to - from) * 32768;
+    // 上升时向上取整、下降时向零取整，最后一帧的 acc >> 15 恰好等于 to，也不会越过 to
+    int32_t step = (int32_t)(((delta > 0) ? delta + (int64_t)frames - 1 : delta) / (int64_t)frames);
+
+    if (ch_count == 2) {
+        for (size_t i = 0; i < frames; i++) {
+            acc += step;
+            int32_t g = acc >> 15;
+            pcm[2 * i] = (int16_t)((pcm[2 * i] * g) >> 15);
+            pcm[2 * i + 1] = (int16_t)((pcm[2 * i + 1] * g) >> 15);
+        }
+    } else {
+        for (size_t i = 0; i < frames; i++) {
+            acc += step;
+            pcm[i] = (int16_t)((pcm[i] * (acc >> 15)) >> 15);
+        }
+    }
+}
+
+// 初始化增益引擎
+void audio_gain_init(audio_gain_t *gain)
+{
+    atomic_init(&gain->target, AUDIO_GAIN_UNITY);
+    gain->current = AUDIO_GAIN_UNITY;
+}
+
+// 音量换算为增益
+int32_t audio_gain_from_volume(uint8_t volume)
+{
+    return s_volume_to_gain[volume & 0x7f];
+}
+
+// 设置目标音量
+void audio_gain_set_volume(audio_gain_t *gain, uint8_t volume)
+{
+    atomic_store_explicit(&gain->target, audio_gain_from_volume(volume), memory_order_relaxed);
+}
+
+// 施加增益
+void audio_gain_process(audio_gain_t *gain, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    int32_t target = atomic_load_explicit(&gain->target, memory_order_relaxed);
+    int32_t from = gain->current;
+    int32_t to = target;
+
+    if (frames == 0) {
+        return;
+    }
+
+    if (from == to) {
+        if (to != AUDIO_GAIN_UNITY) {
+            audio_gain_apply_const(pcm, frames * ch_count, to);
+        }
+        return;
+    }
+
+    // 单块内的变化量受限，较大的音量跳变分摊到多个块
+    if (to - from > AUDIO_GAIN_MAX_STEP) {
+        to = from + AUDIO_GAIN_MAX_STEP;
+    } else if (from - to > AUDIO_GAIN_MAX_STEP) {
+        to = from - AUDIO_GAIN_MAX_STEP;
+    }
+    audio_gain_ramp(pcm, frames, ch_count, from, to);
+    gain->current = to;
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_gain_stage = {
+    .name = "gain",
+    .process = audio_gain_stage_process,
+};
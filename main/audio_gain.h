@@ -0,0 +1,74 @@
+#ifndef __AUDIO_GAIN_H__
+#define __AUDIO_GAIN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "audio_chain.h"
+
+/* unity gain in Q15, kept one above INT16_MAX so the bypass is bit exact */
+#define AUDIO_GAIN_UNITY        (32768)
+/* largest gain change applied within one block (Q15), spreads big jumps over several blocks */
+#define AUDIO_GAIN_MAX_STEP     (4096)
+
+/**
+ * 定点增益引擎
+ *
+ * AVRCP绝对音量（0~0x7F）按感知（dB）映射表换算成Q15增益：0为静音，1~0x7F线性分布在 -60 dB ~ 0 dB。
+ * 目标增益通过原子变量交给I2S任务，不需要加锁；I2S任务每块读取一次目标增益，
+ * 在块内做线性斜坡过渡，避免音量变化时的拉链噪声。增益为单位增益时直接跳过。
+ */
+typedef struct {
+    _Atomic int32_t target;     /*!< target gain, Q15, written by the control path */   // 目标增益
+    int32_t         current;    /*!< gain reached at the end of the last block */        // 当前增益
+} audio_gain_t;
+
+/**
+ * @brief  初始化增益引擎，初始为单位增益
+ *
+ * @param [out] gain  增益引擎
+ */
+void audio_gain_init(audio_gain_t *gain);
+
+/**
+ * @brief  AVRCP绝对音量换算为Q15增益
+ *
+ * @param [in] volume  AVRCP绝对音量（0~0x7F）
+ */
+int32_t audio_gain_from_volume(uint8_t volume);
+
+/**
+ * @brief  设置目标音量，可在任意任务中调用
+ *
+ * @param [in] gain    增益引擎
+ * @param [in] volume  AVRCP绝对音量（0~0x7F）
+ */
+void audio_gain_set_volume(audio_gain_t *gain, uint8_t volume);
+
+/**
+ * @brief  对一个PCM块原地施加增益
+ *
+ * @param [in]     gain      增益引擎
+ * @param [in,out] pcm       16位交织PCM
+ * @param [in]     frames    帧数
+ * @param [in]     ch_count  声道数
+ */
+void audio_gain_process(audio_gain_t *gain, int16_t *pcm, size_t frames, uint8_t ch_count);
+
+/**
+ * @brief  对一个PCM块原地施加从 from 到 to 的线性斜坡增益（淡入淡出也使用它）
+ *
+ * @param [in,out] pcm       16位交织PCM
+ * @param [in]     frames    帧数
+ * @param [in]     ch_count  声道数
+ * @param [in]     from      起始增益（Q15）
+ * @param [in]     to        结束增益（Q15）
+ */
+void audio_gain_ramp(int16_t *pcm, size_t frames, uint8_t ch_count, int32_t from, int32_t to);
+
+/**
+ * 处理链中的音量级，ctx 为 audio_gain_t
+ */
+extern const audio_chain_stage_desc_t audio_gain_stage;
+
+#endif /* __AUDIO_GAIN_H__ */
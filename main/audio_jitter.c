@@ -0,0 +1,183 @@
+#include <string.h>
+#include "audio_jitter.h"
+
+/* margin added to the target on every underflow */
+#define JITTER_UNDERFLOW_STEP_MS       (20)
+/* the underflow margin decays by this much per clean second */
+#define JITTER_BOOST_DECAY_MS          (2)
+/* the overflow path trims the underflow margin by this much */
+#define JITTER_OVERFLOW_STEP_MS        (10)
+/* inter-arrival gaps longer than this are a stream restart, not jitter */
+#define JITTER_RESTART_GAP_US          (500 * 1000)
+/* RSSI delta (dB below the golden range) that counts as a weak link */
+#define JITTER_RSSI_WEAK_DB            (-10)
+/* margin added on a weak link */
+#define JITTER_RSSI_MARGIN_MS          (30)
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 减小欠载补偿，生产者和消费者都会修改，使用比较交换
+static void audio_jitter_boost_sub(audio_jitter_t *jb, uint32_t step)
+{
+    uint32_t boost = atomic_load(&jb->boost_ms);
+    while (boost > 0 && !atomic_compare_exchange_weak(&jb->boost_ms, &boost, (boost > step) ? boost - step : 0)) {
+    }
+}
+
+// 重新计算缓冲目标
+static void audio_jitter_update_target(audio_jitter_t *jb)
+{
+    uint32_t target = jb->min_ms + (jb->peak_us + 999) / 1000 +
+                      atomic_load(&jb->boost_ms) + atomic_load(&jb->rssi_ms);
+    if (target > jb->max_ms) {
+        target = jb->max_ms;
+    }
+    atomic_store(&jb->target_ms, target);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化抖动缓冲区
+void audio_jitter_init(audio_jitter_t *jb, size_t capacity, uint32_t min_ms, uint32_t max_ms)
+{
+    memset(jb, 0, sizeof(audio_jitter_t));
+    jb->capacity = capacity;
+    jb->min_ms = min_ms;
+    jb->max_ms = (max_ms < min_ms) ? min_ms : max_ms;
+    atomic_store(&jb->mode, AUDIO_JITTER_MODE_PREFETCHING);
+    /* default to 44.1 kHz stereo until the codec is configured */
+    audio_jitter_configure(jb, 44100, 2);
+}
+
+// 根据采样率和声道数重新配置
+void audio_jitter_configure(audio_jitter_t *jb, uint32_t sample_rate, uint8_t ch_count)
+{
+    jb->bytes_per_sec = sample_rate * ch_count * sizeof(int16_t);
+    jb->last_arrival_us = 0;
+    jb->last_media_us = 0;
+    jb->jitter_us = 0;
+    jb->peak_us = 0;
+    atomic_store(&jb->boost_ms, 0);
+    audio_jitter_update_target(jb);
+}
+
+// 记录数据包到达
+void audio_jitter_on_packet(audio_jitter_t *jb, size_t len, int64_t now_us)
+{
+    uint32_t media_us = (uint32_t)((uint64_t)len * 1000000 / jb->bytes_per_sec);
+
+    if (jb->last_arrival_us != 0 && now_us - jb->last_arrival_us < JITTER_RESTART_GAP_US) {
+        /* deviation of the inter-arrival time from the media time the previous packet carried */
+        int64_t d = (now_us - jb->last_arrival_us) - (int64_t)jb->last_media_us;
+        uint32_t abs_d = (uint32_t)((d < 0) ? -d : d);
+        // RFC 3550 平滑抖动，峰值缓慢衰减
+        jb->jitter_us += ((int32_t)abs_d - (int32_t)jb->jitter_us) / 16;
+        jb->peak_us -= jb->peak_us >> 8;
+        if (abs_d > jb->peak_us) {
+            jb->peak_us = abs_d;
+        }
+    }
+    jb->last_arrival_us = now_us;
+    jb->last_media_us = media_us;
+
+    /* let the underflow margin decay while the link stays clean */
+    if (now_us - jb->last_decay_us >= 1000000) {
+        uint32_t since = (uint32_t)(now_us / 1000) - atomic_load(&jb->last_underflow_ms);
+        if (since >= 1000) {
+            audio_jitter_boost_sub(jb, JITTER_BOOST_DECAY_MS);
+        }
+        jb->last_decay_us = now_us;
+    }
+
+    audio_jitter_update_target(jb);
+}
+
+// 决定是否接收数据包
+bool audio_jitter_admit(audio_jitter_t *jb, size_t fill, size_t len)
+{
+    size_t target = audio_jitter_target_bytes(jb);
+    size_t high = target * 2;
+    uint8_t mode = atomic_load(&jb->mode);
+
+    /* hysteresis band must hold a few packets even at low sample rates */
+    if (high < target + 4 * len) {
+        high = target + 4 * len;
+    }
+
+    if (mode == AUDIO_JITTER_MODE_DROPPING) {
+        // 水位回落到目标后恢复接收
+        if (fill > target) {
+            return false;
+        }
+        atomic_compare_exchange_strong(&jb->mode, &mode, AUDIO_JITTER_MODE_PROCESSING);
+        return true;
+    }
+
+    if (fill + len > jb->capacity) {
+        /* a real overflow: the target was too ambitious, trim the underflow margin */
+        audio_jitter_boost_sub(jb, JITTER_OVERFLOW_STEP_MS);
+        atomic_fetch_add(&jb->overflows, 1);
+        audio_jitter_update_target(jb);
+        atomic_compare_exchange_strong(&jb->mode, &mode, AUDIO_JITTER_MODE_DROPPING);
+        return false;
+    }
+
+    if (mode == AUDIO_JITTER_MODE_PROCESSING && fill + len > high) {
+        atomic_compare_exchange_strong(&jb->mode, &mode, AUDIO_JITTER_MODE_DROPPING);
+        return false;
+    }
+
+    return true;
+}
+
+// 检查预取是否完成
+bool audio_jitter_prefetch_done(audio_jitter_t *jb, size_t fill)
+{
+    uint8_t mode = AUDIO_JITTER_MODE_PREFETCHING;
+
+    if (fill < audio_jitter_target_bytes(jb)) {
+        return false;
+    }
+    return atomic_compare_exchange_strong(&jb->mode, &mode, AUDIO_JITTER_MODE_PROCESSING);
+}
+
+// 记录欠载
+void audio_jitter_on_underflow(audio_jitter_t *jb, int64_t now_us)
+{
+    uint8_t mode = AUDIO_JITTER_MODE_PROCESSING;
+
+    atomic_fetch_add(&jb->underflows, 1);
+    atomic_store(&jb->last_underflow_ms, (uint32_t)(now_us / 1000));
+    if (atomic_load(&jb->boost_ms) + JITTER_UNDERFLOW_STEP_MS <= jb->max_ms) {
+        atomic_fetch_add(&jb->boost_ms, JITTER_UNDERFLOW_STEP_MS);
+    }
+    /* the target is refreshed by the producer on the next packet */
+    atomic_compare_exchange_strong(&jb->mode, &mode, AUDIO_JITTER_MODE_PREFETCHING);
+}
+
+// 根据RSSI调整缓冲余量
+void audio_jitter_set_rssi_delta(audio_jitter_t *jb, int8_t rssi_delta)
+{
+    atomic_store(&jb->rssi_ms, (rssi_delta <= JITTER_RSSI_WEAK_DB) ? JITTER_RSSI_MARGIN_MS : 0);
+}
+
+// 毫秒换算为字节
+size_t audio_jitter_ms_to_bytes(const audio_jitter_t *jb, uint32_t ms)
+{
+    size_t bytes = (size_t)((uint64_t)ms * jb->bytes_per_sec / 1000) & ~(size_t)3;
+    /* keep room for the dropping high-water mark (twice the target) inside the ring */
+    if (bytes > jb->capacity / 2) {
+        bytes = jb->capacity / 2;
+    }
+    return bytes;
+}
+
+// 当前缓冲目标
+size_t audio_jitter_target_bytes(const audio_jitter_t *jb)
+{
+    return audio_jitter_ms_to_bytes(jb, atomic_load(&jb->target_ms));
+}
@@ -0,0 +1,154 @@
+#ifndef __AUDIO_JITTER_H__
+#define __AUDIO_JITTER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* ringbuffer modes, shared between the BT (producer) and I2S (consumer) tasks */
+typedef enum {
+    AUDIO_JITTER_MODE_PROCESSING,    /* ringbuffer is buffering incoming audio data, I2S is working */
+    AUDIO_JITTER_MODE_PREFETCHING,   /* ringbuffer is buffering incoming audio data, I2S is waiting */
+    AUDIO_JITTER_MODE_DROPPING       /* ringbuffer is not buffering (dropping) incoming audio data, I2S is working */
+} audio_jitter_mode_t;
+
+/**
+ * 自适应抖动缓冲区
+ *
+ * 缓冲目标以毫秒表示，根据协商的采样率和声道数换算成字节。
+ * 目标 = 最小值 + 到达抖动峰值 + 欠载补偿 + 弱信号补偿，限制在 [min_ms, max_ms] 内。
+ * 链路干净时保持低延迟，只有实际观测到抖动或欠载时才加大缓冲。
+ *
+ * 模式切换使用原子比较交换，并带有滞回：
+ *   PREFETCHING -> PROCESSING  水位达到目标
+ *   PROCESSING  -> DROPPING    水位超过高水位（目标的两倍）或溢出
+ *   DROPPING    -> PROCESSING  水位回落到目标
+ *   PROCESSING  -> PREFETCHING 欠载
+ */
+typedef struct {
+    /* written by the configuration path only */
+    uint32_t         bytes_per_sec;     /*!< PCM byte rate of the negotiated stream */    // 字节率
+    size_t           capacity;          /*!< ring capacity in bytes */                    // 环形缓冲区容量
+    uint32_t         min_ms;            /*!< lowest buffer target */                      // 最小缓冲目标
+    uint32_t         max_ms;            /*!< highest buffer target */                     // 最大缓冲目标
+
+    /* written by the producer only */
+    int64_t          last_arrival_us;   /*!< arrival time of the previous packet */       // 上一个包到达时间
+    int64_t          last_decay_us;     /*!< last time the underflow margin decayed */    // 上一次补偿衰减时间
+    uint32_t         last_media_us;     /*!< media duration of the previous packet */     // 上一个包的播放时长
+    uint32_t         jitter_us;         /*!< smoothed inter-arrival jitter (RFC 3550) */  // 平滑抖动
+    uint32_t         peak_us;           /*!< decaying peak of inter-arrival jitter */     // 抖动峰值
+
+    /* shared between producer, consumer and control paths */
+    _Atomic uint32_t boost_ms;          /*!< margin added after underflows */             // 欠载补偿
+    _Atomic uint32_t rssi_ms;           /*!< margin added on a weak link */               // 弱信号补偿
+    _Atomic uint32_t target_ms;         /*!< current buffer target */                     // 当前缓冲目标
+    _Atomic uint32_t underflows;        /*!< underflow count */                           // 欠载次数
+    _Atomic uint32_t overflows;         /*!< overflow count */                            // 溢出次数
+    _Atomic uint32_t last_underflow_ms; /*!< time of the last underflow */                // 最近一次欠载时间
+    _Atomic uint8_t  mode;              /*!< audio_jitter_mode_t */                       // ringbuffer模式
+} audio_jitter_t;
+
+/**
+ * @brief  初始化抖动缓冲区
+ *
+ * @param [out] jb        抖动缓冲区
+ * @param [in]  capacity  环形缓冲区容量（字节）
+ * @param [in]  min_ms    最小缓冲目标（毫秒）
+ * @param [in]  max_ms    最大缓冲目标（毫秒）
+ */
+void audio_jitter_init(audio_jitter_t *jb, size_t capacity, uint32_t min_ms, uint32_t max_ms);
+
+/**
+ * @brief  根据协商的采样率和声道数重新配置，并重置抖动统计
+ *
+ * @param [in] jb           抖动缓冲区
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_jitter_configure(audio_jitter_t *jb, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  生产者：记录一个数据包的到达，更新抖动估计和缓冲目标
+ *
+ * @param [in] jb      抖动缓冲区
+ * @param [in] len     数据包长度（字节）
+ * @param [in] now_us  到达时间（微秒）
+ */
+void audio_jitter_on_packet(audio_jitter_t *jb, size_t len, int64_t now_us);
+
+/**
+ * @brief  生产者：根据写入前的水位决定是否接收数据包
+ *
+ * @param [in] jb    抖动缓冲区
+ * @param [in] fill  当前水位（字节）
+ * @param [in] len   数据包长度（字节）
+ *
+ * @return  true if the packet should be written, false if it should be dropped
+ */
+bool audio_jitter_admit(audio_jitter_t *jb, size_t fill, size_t len);
+
+/**
+ * @brief  生产者：写入后检查预取是否完成
+ *
+ * @param [in] jb    抖动缓冲区
+ * @param [in] fill  当前水位（字节）
+ *
+ * @return  true if this call switched PREFETCHING to PROCESSING（需要唤醒I2S任务）
+ */
+bool audio_jitter_prefetch_done(audio_jitter_t *jb, size_t fill);
+
+/**
+ * @brief  消费者：记录一次欠载，切换到预取模式并加大缓冲目标
+ *
+ * @param [in] jb      抖动缓冲区
+ * @param [in] now_us  欠载时间（微秒）
+ */
+void audio_jitter_on_underflow(audio_jitter_t *jb, int64_t now_us);
+
+/**
+ * @brief  根据链路RSSI偏差（相对于黄金接收功率范围）调整缓冲余量
+ *
+ * @param [in] jb          抖动缓冲区
+ * @param [in] rssi_delta  RSSI偏差（dB）
+ */
+void audio_jitter_set_rssi_delta(audio_jitter_t *jb, int8_t rssi_delta);
+
+/**
+ * @brief  将毫秒数换算为当前流格式下的字节数（按4字节对齐）
+ *
+ * @param [in] jb  抖动缓冲区
+ * @param [in] ms  毫秒数
+ */
+size_t audio_jitter_ms_to_bytes(const audio_jitter_t *jb, uint32_t ms);
+
+/**
+ * @brief  当前缓冲目标（字节）
+ *
+ * @param [in] jb  抖动缓冲区
+ */
+size_t audio_jitter_target_bytes(const audio_jitter_t *jb);
+
+/**
+ * @brief  当前ringbuffer模式
+ *
+ * @param [in] jb  抖动缓冲区
+ */
+static inline audio_jitter_mode_t audio_jitter_get_mode(audio_jitter_t *jb)
+{
+    return (audio_jitter_mode_t)atomic_load(&jb->mode);
+}
+
+/**
+ * @brief  强制设置ringbuffer模式（用于启动/关闭I2S任务）
+ *
+ * @param [in] jb    抖动缓冲区
+ * @param [in] mode  ringbuffer模式
+ */
+static inline void audio_jitter_set_mode(audio_jitter_t *jb, audio_jitter_mode_t mode)
+{
+    atomic_store(&jb->mode, (uint8_t)mode);
+}
+
+#endif /* __AUDIO_JITTER_H__ */
@@ -0,0 +1,159 @@
+#include <string.h>
+#include "audio_limiter.h"
+
+/* Q30 gain of the Q15 value */
+#define AUDIO_LIMITER_Q30(g)        ((int32_t)(g) << 15)
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 累计一次增益决策，窗口满后发布快照
+static void audio_limiter_account(audio_limiter_t *lim, int32_t gain)
+{
+    audio_limiter_stats_t *st = &lim->stats;
+
+    lim->gain_sum += gain;
+    if (gain < AUDIO_LIMITER_UNITY) {
+        st->active++;
+    }
+    if (gain < st->gain_min) {
+        st->gain_min = gain;
+    }
+    if (++st->blocks < AUDIO_LIMITER_REPORT_BLOCKS) {
+        return;
+    }
+
+    /* a snapshot the reporter has not logged yet is simply replaced on the next round */
+    if (!atomic_load(&lim->report_ready)) {
+        st->gain_avg = (int32_t)(lim->gain_sum / st->blocks);
+        st->ceiling = atomic_load(&lim->ceiling);
+        lim->report = *st;
+        atomic_store(&lim->report_ready, true);
+    }
+    memset(st, 0, sizeof(audio_limiter_stats_t));
+    st->gain_min = AUDIO_LIMITER_UNITY;
+    lim->gain_sum = 0;
+}
+
+// 一块收满：求出它所需的增益，并为即将输出的块设定斜坡
+static void audio_limiter_decide(audio_limiter_t *lim)
+{
+    int32_t ceiling = atomic_load(&lim->ceiling);
+    int32_t req = AUDIO_LIMITER_UNITY;
+    int32_t target;
+
+    if (lim->peak > ceiling) {
+        req = (int32_t)(((int64_t)ceiling << 15) / lim->peak);
+    }
+
+    /* the block about to be output must not exceed its own limit nor rise above the next one */
+    target = (req < lim->req_next) ? req : lim->req_next;
+    target = AUDIO_LIMITER_Q30(target);
+    lim->gain = lim->target;
+    if (target > lim->gain + lim->release) {
+        target = lim->gain + lim->release;
+    }
+    lim->target = target;
+    // 向下取整，斜坡终点不会高于目标
+    lim->step = target - lim->gain;
+    if (lim->step < 0) {
+        lim->step = -((-lim->step + AUDIO_LIMITER_BLOCK_FRAMES - 1) / AUDIO_LIMITER_BLOCK_FRAMES);
+    } else {
+        lim->step /= AUDIO_LIMITER_BLOCK_FRAMES;
+    }
+
+    lim->req_next = req;
+    lim->peak = 0;
+    audio_limiter_account(lim, target >> 15);
+}
+
+// 处理链适配
+static void audio_limiter_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_limiter_process((audio_limiter_t *)ctx, pcm, frames);
+}
+
+static void audio_limiter_stage_configure(void *ctx, uint32_t sample_rate, uint8_t ch_count)
+{
+    audio_limiter_configure((audio_limiter_t *)ctx, sample_rate, ch_count);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 重置
+void audio_limiter_configure(audio_limiter_t *lim, uint32_t sample_rate, uint8_t ch_count)
+{
+    uint32_t release_blocks = (sample_rate / 1000 * AUDIO_LIMITER_RELEASE_MS) / AUDIO_LIMITER_BLOCK_FRAMES;
+
+    memset(lim->delay, 0, sizeof(lim->delay));
+    lim->pos = 0;
+    lim->ch_count = (ch_count > AUDIO_LIMITER_MAX_CH) ? AUDIO_LIMITER_MAX_CH : ch_count;
+    lim->peak = 0;
+    lim->req_next = AUDIO_LIMITER_UNITY;
+    lim->gain = AUDIO_LIMITER_Q30(AUDIO_LIMITER_UNITY);
+    lim->target = lim->gain;
+    lim->step = 0;
+    lim->release = AUDIO_LIMITER_Q30(AUDIO_LIMITER_UNITY) / (int32_t)(release_blocks ? release_blocks : 1);
+    memset(&lim->stats, 0, sizeof(audio_limiter_stats_t));
+    lim->stats.gain_min = AUDIO_LIMITER_UNITY;
+    lim->gain_sum = 0;
+}
+
+// 设置门限
+void audio_limiter_set_ceiling(audio_limiter_t *lim, int32_t ceiling)
+{
+    if (ceiling < 1) {
+        ceiling = 1;
+    } else if (ceiling > AUDIO_LIMITER_UNITY) {
+        ceiling = AUDIO_LIMITER_UNITY;
+    }
+    atomic_store(&lim->ceiling, ceiling);
+}
+
+// 限幅
+void audio_limiter_process(audio_limiter_t *lim, int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = lim->ch_count;
+    uint32_t pos = lim->pos;
+    int32_t peak = lim->peak;
+
+    for (size_t i = 0; i < frames; i++, pcm += ch) {
+        int16_t *d = &lim->delay[pos * ch];
+        int32_t g = lim->gain >> 15;
+
+        // 输出最早的一帧，新的一帧写入它的位置
+        for (int c = 0; c < ch; c++) {
+            int32_t x = pcm[c];
+            int32_t a = (x < 0) ? -x : x;
+            if (a > peak) {
+                peak = a;
+            }
+            pcm[c] = (int16_t)((d[c] * g) >> 15);
+            d[c] = (int16_t)x;
+        }
+        lim->gain += lim->step;
+
+        if (++pos % AUDIO_LIMITER_BLOCK_FRAMES == 0) {
+            if (pos == 2 * AUDIO_LIMITER_BLOCK_FRAMES) {
+                pos = 0;
+            }
+            lim->peak = peak;
+            audio_limiter_decide(lim);
+            peak = 0;
+        }
+    }
+
+    lim->pos = pos;
+    lim->peak = peak;
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_limiter_stage = {
+    .name = "limiter",
+    .process = audio_limiter_stage_process,
+    .configure = audio_limiter_stage_configure,
+    .latency = 2 * AUDIO_LIMITER_BLOCK_FRAMES,
+};
@@ -0,0 +1,87 @@
+#ifndef __AUDIO_LIMITER_H__
+#define __AUDIO_LIMITER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "audio_chain.h"
+
+/* maximum channels */
+#define AUDIO_LIMITER_MAX_CH        (2)
+/* unity gain and full scale ceiling, Q15 */
+#define AUDIO_LIMITER_UNITY         (32768)
+/* frames per gain decision, also the look-ahead; the delay is twice this */
+#define AUDIO_LIMITER_BLOCK_FRAMES  (32)
+/* time to recover from full reduction to unity */
+#define AUDIO_LIMITER_RELEASE_MS    (80)
+/* statistics are published every this many gain decisions (about 6 s at 44.1 kHz) */
+#define AUDIO_LIMITER_REPORT_BLOCKS (8192)
+
+/* gain reduction statistics of one report window */
+typedef struct {
+    uint32_t blocks;            /*!< gain decisions */                          // 增益决策次数
+    uint32_t active;            /*!< decisions below unity */                   // 发生压缩的次数
+    int32_t  gain_avg;          /*!< average gain, Q15 */                       // 平均增益（Q15）
+    int32_t  gain_min;          /*!< deepest gain, Q15 */                       // 最小增益（Q15）
+    int32_t  ceiling;           /*!< ceiling at the end of the window, Q15 */   // 当前限幅门限（Q15）
+} audio_limiter_stats_t;
+
+/**
+ * 前视峰值限幅器
+ *
+ * 输出延迟两个决策块（64帧，44.1 kHz 下约 1.5 ms）。每收满一块就求出它的峰值和所需增益，
+ * 待输出的块在自身和下一块所需增益的较小值之间做线性斜坡，所以增益总是在峰值到达之前降下来，
+ * 输出不会超过门限；恢复按 AUDIO_LIMITER_RELEASE_MS 限速。每帧只有取绝对值、比较和一次乘法，
+ * 每块一次除法，全部为定点运算，可在DMA回调中运行。
+ * 门限由电池监测任务通过原子变量写入，处理路径每块读取一次，不需要加锁。
+ */
+typedef struct {
+    int16_t             delay[2 * AUDIO_LIMITER_BLOCK_FRAMES * AUDIO_LIMITER_MAX_CH];   /*!< look-ahead delay */  // 前视延迟线
+    uint32_t            pos;                /*!< oldest frame in the delay */           // 延迟线中最早的一帧
+    uint8_t             ch_count;           /*!< channels of the stream */              // 声道数
+    int32_t             peak;               /*!< peak of the block being received */    // 正在接收的块的峰值
+    int32_t             req_next;           /*!< gain the next output block needs, Q15 */   // 下一输出块所需增益
+    int32_t             gain;               /*!< current gain, Q30 */                   // 当前增益（Q30）
+    int32_t             target;             /*!< gain at the end of this block, Q30 */  // 本块结束时的增益
+    int32_t             step;               /*!< gain change per frame, Q30 */          // 每帧增益变化
+    int32_t             release;            /*!< largest rise per block, Q30 */         // 每块最大恢复量
+    _Atomic int32_t     ceiling;            /*!< output ceiling, Q15, written by the battery monitor */   // 限幅门限
+    audio_limiter_stats_t stats;            /*!< window being accumulated */            // 累计中的统计
+    uint64_t            gain_sum;           /*!< gains of the window, summed */         // 增益累计
+    audio_limiter_stats_t report;           /*!< snapshot handed to the reporter */     // 待输出的统计快照
+    atomic_bool         report_ready;       /*!< a snapshot waits to be logged */       // 统计待输出
+} audio_limiter_t;
+
+/**
+ * @brief  按采样率和声道数重置延迟线与增益，门限保持不变（输出停止时调用）
+ *
+ * @param [in] lim          限幅器
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_limiter_configure(audio_limiter_t *lim, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  设置限幅门限，可在任意任务中调用
+ *
+ * @param [in] lim      限幅器
+ * @param [in] ceiling  门限（Q15，AUDIO_LIMITER_UNITY 为满幅）
+ */
+void audio_limiter_set_ceiling(audio_limiter_t *lim, int32_t ceiling);
+
+/**
+ * @brief  对一个PCM块原地限幅，输出比输入延迟 2 * AUDIO_LIMITER_BLOCK_FRAMES 帧
+ *
+ * @param [in]     lim     限幅器
+ * @param [in,out] pcm     16位交织PCM
+ * @param [in]     frames  帧数
+ */
+void audio_limiter_process(audio_limiter_t *lim, int16_t *pcm, size_t frames);
+
+/**
+ * 处理链中的限幅级，ctx 为 audio_limiter_t
+ */
+extern const audio_chain_stage_desc_t audio_limiter_stage;
+
+#endif /* __AUDIO_LIMITER_H__ */
@@ -0,0 +1,273 @@
+#include <string.h>
+#include <math.h>
+#include "audio_loudness.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 系数量化为 Q3.29
+static int32_t audio_loudness_quantise(double v)
+{
+    return (int32_t)lrint(v * (double)(1 << AUDIO_EQ_COEF_SHIFT));
+}
+
+// 按 BS.1770 的模拟原型在给定采样率下设计K计权的两节（高架预滤波、RLB高通）
+static void audio_loudness_design(audio_loudness_t *meter, uint32_t rate)
+{
+    /* stage 1, shelf: +4 dB above about 1.7 kHz, models the head */
+    double k = tan(M_PI * 1681.974450955533 / rate);
+    double q = 0.7071752369554196;
+    double vh = pow(10.0, 3.999843853973347 / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    meter->kw[0].b0 = audio_loudness_quantise((vh + vb * k / q + k * k) / a0);
+    meter->kw[0].b1 = audio_loudness_quantise(2.0 * (k * k - vh) / a0);
+    meter->kw[0].b2 = audio_loudness_quantise((vh - vb * k / q + k * k) / a0);
+    meter->kw[0].a1 = audio_loudness_quantise(2.0 * (k * k - 1.0) / a0);
+    meter->kw[0].a2 = audio_loudness_quantise((1.0 - k / q + k * k) / a0);
+
+    /* stage 2, RLB high pass at 38 Hz */
+    k = tan(M_PI * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    meter->kw[1].b0 = audio_loudness_quantise(1.0);
+    meter->kw[1].b1 = audio_loudness_quantise(-2.0);
+    meter->kw[1].b2 = audio_loudness_quantise(1.0);
+    meter->kw[1].a1 = audio_loudness_quantise(2.0 * (k * k - 1.0) / a0);
+    meter->kw[1].a2 = audio_loudness_quantise((1.0 - k / q + k * k) / a0);
+}
+
+// 清空测量窗口
+static void audio_loudness_clear(audio_loudness_t *meter)
+{
+    memset(meter->ring, 0, sizeof(meter->ring));
+    meter->ring_pos = 0;
+    meter->windows = 0;
+    meter->win_n = 0;
+    meter->win_energy = 0;
+}
+
+// 一个 100 ms 窗口结束：存入环形窗口并发布 3 s 短期读数
+static void audio_loudness_close_window(audio_loudness_t *meter)
+{
+    uint32_t used;
+    uint64_t total = 0;
+
+    meter->ring[meter->ring_pos] = meter->win_energy;
+    meter->ring_pos = (meter->ring_pos + 1) % AUDIO_LOUDNESS_WINDOWS;
+    meter->windows++;
+    meter->seq++;
+    meter->win_energy = 0;
+    meter->win_n = 0;
+
+    /* a snapshot the control path has not read yet is simply replaced by the next window */
+    if (atomic_load(&meter->report_ready)) {
+        return;
+    }
+    // 复位后窗口未满时，只平均已有的窗口（其余为0）
+    used = (meter->windows < AUDIO_LOUDNESS_WINDOWS) ? meter->windows : AUDIO_LOUDNESS_WINDOWS;
+    for (int i = 0; i < AUDIO_LOUDNESS_WINDOWS; i++) {
+        total += meter->ring[i];
+    }
+    meter->report.mean_square = total / ((uint64_t)used * meter->win_len);
+    meter->report.windows = meter->windows;
+    meter->report.seq = meter->seq;
+    atomic_store(&meter->report_ready, true);
+}
+
+// 测量：抽取、K计权、累计均方
+static void audio_loudness_measure(audio_loudness_t *meter, const int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = meter->ch_count;
+    const uint8_t factor = 1 << meter->decim_log2;
+    const int32_t scale = 1 << (AUDIO_EQ_STATE_SHIFT - meter->decim_log2);
+
+    while (frames > 0) {
+        size_t n = 0;
+
+        // 盒式平均抽取，结果带 AUDIO_EQ_STATE_SHIFT 位小数
+        while (frames > 0 && n < AUDIO_LOUDNESS_CHUNK) {
+            for (int c = 0; c < ch; c++) {
+                meter->decim_acc[c] += pcm[c];
+            }
+            pcm += ch;
+            frames--;
+            if (++meter->decim_n == factor) {
+                for (int c = 0; c < ch; c++) {
+                    meter->work[c][n] = meter->decim_acc[c] * scale;
+                    meter->decim_acc[c] = 0;
+                }
+                meter->decim_n = 0;
+                n++;
+            }
+        }
+
+        for (int c = 0; c < ch; c++) {
+            audio_eq_section(&meter->kw[0], &meter->state[0][c], meter->work[c], n, 1);
+            audio_eq_section(&meter->kw[1], &meter->state[1][c], meter->work[c], n, 1);
+        }
+
+        /* K-weighted samples stay below 2^24, the squares are scaled back to 8 fraction bits */
+        for (size_t j = 0; j < n; j++) {
+            for (int c = 0; c < ch; c++) {
+                int32_t y = meter->work[c][j];
+                meter->win_energy += (uint64_t)((int64_t)y * y) >> AUDIO_EQ_STATE_SHIFT;
+            }
+            if (++meter->win_n == meter->win_len) {
+                audio_loudness_close_window(meter);
+            }
+        }
+    }
+}
+
+// 施加归一化增益，块内线性斜坡并饱和
+static void audio_loudness_apply(audio_loudness_t *meter, int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = meter->ch_count;
+    int32_t target = atomic_load(&meter->gain_target);
+    /* 16 extra fraction bits over the Q12 gain, so the ramp lands on the target */
+    int32_t acc = meter->gain << 16;
+    int32_t step;
+
+    if (frames == 0 || (target == AUDIO_LOUDNESS_UNITY && meter->gain == AUDIO_LOUDNESS_UNITY)) {
+        return;
+    }
+
+    step = ((target - meter->gain) * 65536) / (int32_t)frames;
+    for (size_t i = 0; i < frames; i++, pcm += ch) {
+        acc += step;
+        int32_t g = acc >> 16;
+        for (int c = 0; c < ch; c++) {
+            int32_t y = (pcm[c] * g) >> 12;
+            if (y > INT16_MAX) {
+                y = INT16_MAX;
+            } else if (y < INT16_MIN) {
+                y = INT16_MIN;
+            }
+            pcm[c] = (int16_t)y;
+        }
+    }
+    meter->gain = target;
+}
+
+// 处理链适配
+static void audio_loudness_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_loudness_process((audio_loudness_t *)ctx, pcm, frames);
+}
+
+static void audio_loudness_stage_configure(void *ctx, uint32_t sample_rate, uint8_t ch_count)
+{
+    audio_loudness_configure((audio_loudness_t *)ctx, sample_rate, ch_count);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_loudness_init(audio_loudness_t *meter, int16_t target_lufs, int16_t max_boost_db, int16_t max_cut_db)
+{
+    memset(meter, 0, sizeof(audio_loudness_t));
+    meter->target_lufs = target_lufs;
+    meter->max_boost_db = max_boost_db;
+    meter->max_cut_db = max_cut_db;
+    meter->gain = AUDIO_LOUDNESS_UNITY;
+    atomic_init(&meter->gain_target, AUDIO_LOUDNESS_UNITY);
+    atomic_init(&meter->gain_db10, 0);
+    atomic_init(&meter->lufs_x10, AUDIO_LOUDNESS_GATE_LUFS * 10);
+    atomic_init(&meter->reset_req, false);
+    atomic_init(&meter->report_ready, false);
+    audio_loudness_configure(meter, 44100, 2);
+}
+
+// 按采样率和声道数配置
+void audio_loudness_configure(audio_loudness_t *meter, uint32_t sample_rate, uint8_t ch_count)
+{
+    uint8_t decim_log2 = 0;
+
+    /* SBC rates are 16, 32, 44.1 and 48 kHz, a power of two factor keeps the box sum a shift */
+    while (decim_log2 < 2 && (sample_rate >> (decim_log2 + 1)) >= AUDIO_LOUDNESS_MIN_RATE) {
+        decim_log2++;
+    }
+    meter->decim_log2 = decim_log2;
+    meter->decim_n = 0;
+    meter->ch_count = (ch_count > AUDIO_LOUDNESS_MAX_CH) ? AUDIO_LOUDNESS_MAX_CH : ch_count;
+    memset(meter->decim_acc, 0, sizeof(meter->decim_acc));
+    memset(meter->state, 0, sizeof(meter->state));
+    meter->win_len = (sample_rate >> decim_log2) / 10;
+    audio_loudness_design(meter, sample_rate >> decim_log2);
+    audio_loudness_clear(meter);
+    atomic_store(&meter->reset_req, false);
+}
+
+// 请求复位
+void audio_loudness_reset(audio_loudness_t *meter)
+{
+    atomic_store(&meter->reset_req, true);
+}
+
+// 测量并施加归一化增益
+void audio_loudness_process(audio_loudness_t *meter, int16_t *pcm, size_t frames)
+{
+    /* the windows belong to this path, the control path only asks for the reset */
+    if (atomic_load(&meter->reset_req)) {
+        audio_loudness_clear(meter);
+        atomic_store(&meter->reset_req, false);
+    }
+    audio_loudness_measure(meter, pcm, frames);
+    audio_loudness_apply(meter, pcm, frames);
+}
+
+// 控制路径：读取快照并调整归一化增益
+bool audio_loudness_update(audio_loudness_t *meter)
+{
+    audio_loudness_reading_t r;
+    float lufs = -120.0f;
+    uint32_t elapsed;
+    int32_t gain_db10 = atomic_load(&meter->gain_db10);
+    int32_t want;
+    int32_t slew;
+
+    if (!atomic_load(&meter->report_ready)) {
+        return false;
+    }
+    r = meter->report;
+    atomic_store(&meter->report_ready, false);
+
+    if (r.mean_square > 0) {
+        lufs = -0.691f + 10.0f * log10f((float)r.mean_square / (256.0f * 32768.0f * 32768.0f));
+    }
+    atomic_store(&meter->lufs_x10, (int32_t)lrintf(lufs * 10.0f));
+    elapsed = r.seq - meter->last_seq;
+    meter->last_seq = r.seq;
+    if (r.windows < AUDIO_LOUDNESS_SETTLE_WINDOWS || lufs < AUDIO_LOUDNESS_GATE_LUFS) {
+        return true;
+    }
+
+    // 目标增益限幅，并按经过的窗口数限速
+    want = (int32_t)lrintf((meter->target_lufs - lufs) * 10.0f);
+    if (want > meter->max_boost_db * 10) {
+        want = meter->max_boost_db * 10;
+    } else if (want < -meter->max_cut_db * 10) {
+        want = -meter->max_cut_db * 10;
+    }
+    slew = AUDIO_LOUDNESS_SLEW_DB10 * (int32_t)elapsed;
+    if (want > gain_db10 + slew) {
+        want = gain_db10 + slew;
+    } else if (want < gain_db10 - slew) {
+        want = gain_db10 - slew;
+    }
+    atomic_store(&meter->gain_db10, want);
+    atomic_store(&meter->gain_target, (int32_t)lrintf(AUDIO_LOUDNESS_UNITY * powf(10.0f, want / 200.0f)));
+    return true;
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_loudness_stage = {
+    .name = "loudness",
+    .process = audio_loudness_stage_process,
+    .configure = audio_loudness_stage_configure,
+};
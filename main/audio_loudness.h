@@ -0,0 +1,123 @@
+#ifndef __AUDIO_LOUDNESS_H__
+#define __AUDIO_LOUDNESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "audio_eq.h"
+#include "audio_chain.h"
+
+/* maximum channels */
+#define AUDIO_LOUDNESS_MAX_CH           (2)
+/* the meter runs at the stream rate divided down to no less than this */
+#define AUDIO_LOUDNESS_MIN_RATE         (22050)
+/* 100 ms windows in the 3 s short-term integration */
+#define AUDIO_LOUDNESS_WINDOWS          (30)
+/* windows after a reset before the normaliser trusts the reading */
+#define AUDIO_LOUDNESS_SETTLE_WINDOWS   (10)
+/* decimated samples per channel filtered per pass */
+#define AUDIO_LOUDNESS_CHUNK            (256)
+/* unity normalisation gain, Q12 */
+#define AUDIO_LOUDNESS_UNITY            (4096)
+/* readings below this are pauses or fades and leave the gain alone, LUFS */
+#define AUDIO_LOUDNESS_GATE_LUFS        (-50)
+/* gain slew of the normaliser per 100 ms window, 0.1 dB */
+#define AUDIO_LOUDNESS_SLEW_DB10        (1)
+
+/* one short-term reading, published every 100 ms window */
+typedef struct {
+    uint64_t mean_square;       /*!< channel mean squares over the window, summed, Q8 of 16-bit units */   // 各声道均方和
+    uint32_t windows;           /*!< 100 ms windows since the last reset */     // 复位以来的窗口数
+    uint32_t seq;               /*!< windows since start, never reset */        // 窗口序号
+} audio_loudness_reading_t;
+
+/**
+ * 短期响度表（ITU-R BS.1770 K计权，3 s 窗口）与响度归一化
+ *
+ * 处理路径：44.1/48 kHz 的流先按 2 倍抽取（盒式平均）到 22 kHz 左右，再用两节定点双二阶（与均衡器共用内核）做K计权，
+ * 累计每 100 ms 的均方，30 个窗口构成 3 s 短期响度，每个窗口发布一次快照；归一化增益在块内做斜坡后施加。
+ * 每帧只有抽取时的加法，滤波和平方按抽取后的样本计，开销减半。抽取会低估 10 kHz 以上的能量：
+ * 正弦和低频为主的信号读数与全速率一致，粉红噪声约低 1 LU，对归一化足够。
+ * 控制路径（任务上下文）：读取快照换算为 LUFS，按目标响度以每窗口 0.1 dB 的速度调整归一化增益，
+ * 低于门限的读数（暂停、淡出）不调整增益。切换曲目时复位测量窗口。
+ */
+typedef struct {
+    audio_eq_coef_t     kw[2];              /*!< K-weighting: shelf, high pass */       // K计权系数
+    audio_eq_state_t    state[2][AUDIO_LOUDNESS_MAX_CH];   /*!< filter history */    // 滤波器状态
+    int32_t             work[AUDIO_LOUDNESS_MAX_CH][AUDIO_LOUDNESS_CHUNK];   /*!< decimated samples */  // 抽取后的样本
+    uint8_t             ch_count;           /*!< channels of the stream */              // 声道数
+    uint8_t             decim_log2;         /*!< decimation factor, log2 */             // 抽取倍数（log2）
+    uint8_t             decim_n;            /*!< frames in the running box sum */       // 抽取累加的帧数
+    int32_t             decim_acc[AUDIO_LOUDNESS_MAX_CH];   /*!< running box sum */     // 抽取累加值
+    uint32_t            win_len;            /*!< decimated samples per window */        // 每窗口样本数
+    uint32_t            win_n;              /*!< samples in the current window */       // 当前窗口样本数
+    uint64_t            win_energy;         /*!< energy of the current window */        // 当前窗口能量
+    uint64_t            ring[AUDIO_LOUDNESS_WINDOWS];   /*!< energies of the last windows */   // 最近各窗口能量
+    uint32_t            ring_pos;           /*!< next slot of the ring */               // 下一个窗口位置
+    uint32_t            windows;            /*!< windows since the last reset */        // 复位以来的窗口数
+    uint32_t            seq;                /*!< windows since start */                 // 窗口序号
+    atomic_bool         reset_req;          /*!< the control path asks for a reset */   // 复位请求
+    audio_loudness_reading_t report;        /*!< snapshot handed to the control path */ // 待读取的快照
+    atomic_bool         report_ready;       /*!< a snapshot waits to be read */         // 快照待读取
+    _Atomic int32_t     gain_target;        /*!< normalisation gain, Q12, set by the control path */   // 目标归一化增益
+    int32_t             gain;               /*!< gain reached at the end of the last block, Q12 */    // 当前归一化增益
+    /* control path only */
+    int16_t             target_lufs;        /*!< level the normaliser aims at */        // 目标响度
+    int16_t             max_boost_db;       /*!< largest boost */                       // 最大提升
+    int16_t             max_cut_db;         /*!< largest cut */                         // 最大衰减
+    uint32_t            last_seq;           /*!< last window the control path saw */    // 上次读取的窗口序号
+    _Atomic int32_t     gain_db10;          /*!< normalisation gain, 0.1 dB, for the display */   // 归一化增益（0.1 dB）
+    _Atomic int32_t     lufs_x10;           /*!< last short-term loudness, 0.1 LU, for the display */   // 最近的短期响度
+} audio_loudness_t;
+
+/**
+ * @brief  初始化，归一化增益为单位增益
+ *
+ * @param [out] meter         响度表
+ * @param [in]  target_lufs   目标响度（LUFS）
+ * @param [in]  max_boost_db  最大提升（dB）
+ * @param [in]  max_cut_db    最大衰减（dB）
+ */
+void audio_loudness_init(audio_loudness_t *meter, int16_t target_lufs, int16_t max_boost_db, int16_t max_cut_db);
+
+/**
+ * @brief  按采样率和声道数设计K计权并复位测量（输出停止时调用）
+ *
+ * @param [in] meter        响度表
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_loudness_configure(audio_loudness_t *meter, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  请求复位测量窗口（切换曲目时），可在任意任务中调用
+ *
+ * @param [in] meter  响度表
+ */
+void audio_loudness_reset(audio_loudness_t *meter);
+
+/**
+ * @brief  测量一个PCM块，然后原地施加归一化增益（可在DMA回调中调用）
+ *
+ * @param [in]     meter   响度表
+ * @param [in,out] pcm     16位交织PCM
+ * @param [in]     frames  帧数
+ */
+void audio_loudness_process(audio_loudness_t *meter, int16_t *pcm, size_t frames);
+
+/**
+ * @brief  控制路径：读取最新快照并调整归一化增益（任务上下文）
+ *
+ * @param [in] meter  响度表
+ *
+ * @return  true if a new reading was taken（有新读数）
+ */
+bool audio_loudness_update(audio_loudness_t *meter);
+
+/**
+ * 处理链中的响度测量与归一化级，ctx 为 audio_loudness_t
+ */
+extern const audio_chain_stage_desc_t audio_loudness_stage;
+
+#endif /* __AUDIO_LOUDNESS_H__ */
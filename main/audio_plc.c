@@ -0,0 +1,146 @@
+#include <string.h>
+#include "audio_plc.h"
+#include "audio_gain.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 帧顺序倒转，同一帧内的声道顺序不变
+static void audio_plc_reverse(int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    for (size_t i = 0, j = frames - 1; i < j; i++, j--) {
+        for (uint8_t c = 0; c < ch_count; c++) {
+            int16_t t = pcm[i * ch_count + c];
+            pcm[i * ch_count + c] = pcm[j * ch_count + c];
+            pcm[j * ch_count + c] = t;
+        }
+    }
+}
+
+// 淡出没放完的部分叠加到淡入块上，饱和到16位
+static void audio_plc_crossfade(audio_plc_t *plc, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    const int16_t *tail = plc->last + plc->fade_pos * ch_count;
+    size_t n = plc->fade_frames - plc->fade_pos;
+
+    if (n > frames) {
+        n = frames;
+    }
+    for (size_t i = 0; i < n * ch_count; i++) {
+        int32_t y = pcm[i] + tail[i];
+        pcm[i] = (int16_t)((y > INT16_MAX) ? INT16_MAX : (y < INT16_MIN) ? INT16_MIN : y);
+    }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_plc_init(audio_plc_t *plc)
+{
+    memset(plc->last, 0, sizeof(plc->last));
+    plc->last_frames = 0;
+    plc->fade_frames = 0;
+    plc->fade_pos = 0;
+    plc->fade_ch = 0;
+    plc->muted = true;
+    atomic_store(&plc->fade_out_req, false);
+    atomic_store(&plc->stopping, false);
+    atomic_store(&plc->gaps, 0);
+    atomic_store(&plc->fade_ins, 0);
+    atomic_store(&plc->fade_outs, 0);
+}
+
+// 处理正常块
+void audio_plc_process(audio_plc_t *plc, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    if (frames == 0) {
+        return;
+    }
+
+    if (atomic_exchange(&plc->fade_out_req, false)) {
+        // 控制路径请求淡出：本块淡出，之后的块重新淡入
+        audio_gain_ramp(pcm, frames, ch_count, AUDIO_GAIN_UNITY, 0);
+        plc->muted = true;
+        plc->last_frames = 0;
+        plc->fade_frames = 0;
+        plc->fade_pos = 0;
+        atomic_fetch_add(&plc->fade_outs, 1);
+        return;
+    }
+
+    if (plc->muted) {
+        audio_gain_ramp(pcm, frames, ch_count, 0, AUDIO_GAIN_UNITY);
+        // 淡出还没放完数据就恢复了：交叉淡化，不从淡出的中途跳到淡入的起点
+        if (plc->fade_pos < plc->fade_frames && plc->fade_ch == ch_count) {
+            audio_plc_crossfade(plc, pcm, frames, ch_count);
+        }
+        plc->fade_frames = 0;
+        plc->fade_pos = 0;
+        plc->muted = false;
+        atomic_fetch_add(&plc->fade_ins, 1);
+    }
+
+    /* keep the block so an underflow right after it can be faded out smoothly */
+    if (frames > AUDIO_PLC_MAX_FRAMES) {
+        pcm += (frames - AUDIO_PLC_MAX_FRAMES) * ch_count;
+        frames = AUDIO_PLC_MAX_FRAMES;
+    }
+    memcpy(plc->last, pcm, frames * ch_count * sizeof(int16_t));
+    plc->last_frames = frames;
+}
+
+// 产生隐藏块
+int16_t *audio_plc_conceal(audio_plc_t *plc, uint8_t ch_count, size_t max_frames, size_t *frames)
+{
+    size_t n;
+
+    /* a fade-out of another channel layout cannot continue */
+    if (plc->fade_pos < plc->fade_frames && plc->fade_ch != ch_count) {
+        plc->fade_frames = 0;
+        plc->fade_pos = 0;
+    }
+    if (plc->fade_pos >= plc->fade_frames) {
+        if (plc->muted || plc->last_frames == 0) {
+            // 已经静音，DMA的自动清零负责输出静音
+            *frames = 0;
+            return plc->last;
+        }
+
+        /* play the last good block backwards from where playback stopped, fading it out to silence */
+        audio_plc_reverse(plc->last, plc->last_frames, ch_count);
+        audio_gain_ramp(plc->last, plc->last_frames, ch_count, AUDIO_GAIN_UNITY, 0);
+        plc->fade_frames = plc->last_frames;
+        plc->fade_pos = 0;
+        plc->fade_ch = ch_count;
+        plc->last_frames = 0;
+        plc->muted = true;
+        atomic_fetch_add(&plc->fade_outs, 1);
+        if (!atomic_load(&plc->stopping)) {
+            atomic_fetch_add(&plc->gaps, 1);
+        }
+    }
+
+    // 放不下的部分留到下一次
+    n = plc->fade_frames - plc->fade_pos;
+    if (n > max_frames) {
+        n = max_frames;
+    }
+    *frames = n;
+    plc->fade_pos += n;
+    return plc->last + (plc->fade_pos - n) * ch_count;
+}
+
+// 请求淡出
+void audio_plc_request_fade_out(audio_plc_t *plc)
+{
+    atomic_store(&plc->fade_out_req, true);
+}
+
+// 标记流停止/开始
+void audio_plc_set_stopping(audio_plc_t *plc, bool stopping)
+{
+    atomic_store(&plc->stopping, stopping);
+}
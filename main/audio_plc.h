@@ -0,0 +1,82 @@
+#ifndef __AUDIO_PLC_H__
+#define __AUDIO_PLC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* largest block kept for concealment, in frames */
+#define AUDIO_PLC_MAX_FRAMES    (512)
+/* largest channel count */
+#define AUDIO_PLC_MAX_CH        (2)
+
+/**
+ * 丢包隐藏与淡入淡出
+ *
+ * 每个正常输出的块都保留一份拷贝。ringbuffer欠载时，用最后一个正常块做一次淡出后再进入静音，
+ * 而不是直接停止写入、由DMA输出硬静音；数据恢复后的第一个块做淡入。
+ * 淡出从播放停下的位置开始：把最后一块倒序播放，第一个样本就是刚输出的最后一个样本，波形不跳变。
+ * 输出一次放不下的部分留到下一次（拉模式下一个DMA描述符）；淡出没放完数据就恢复时，剩下的部分叠加到淡入块上交叉淡化。
+ * 流开始时同样淡入；流停止、编码重配置时由控制路径请求淡出，下一个输出块淡出到静音。
+ */
+typedef struct {
+    int16_t          last[AUDIO_PLC_MAX_FRAMES * AUDIO_PLC_MAX_CH];   /*!< copy of the last good block */  // 最后一个正常块
+    size_t           last_frames;       /*!< frames in `last`, 0 if none */                  // 最后一个正常块的帧数
+    size_t           fade_frames;       /*!< frames of the fade-out prepared in `last` */    // 准备好的淡出帧数
+    size_t           fade_pos;          /*!< fade-out frames already handed out */           // 已输出的淡出帧数
+    uint8_t          fade_ch;           /*!< channels of the fade-out */                     // 淡出的声道数
+    bool             muted;             /*!< output has faded to silence */                  // 已淡出到静音
+    _Atomic bool     fade_out_req;      /*!< control path asks for a fade-out */             // 淡出请求
+    _Atomic bool     stopping;          /*!< stream is suspending, a drain is not a gap */   // 流正在停止
+    _Atomic uint32_t gaps;              /*!< gaps concealed */                               // 隐藏的数据缺口数
+    _Atomic uint32_t fade_ins;          /*!< fade-ins applied */                             // 淡入次数
+    _Atomic uint32_t fade_outs;         /*!< fade-outs applied */                            // 淡出次数
+} audio_plc_t;
+
+/**
+ * @brief  初始化，初始状态为静音，第一个块会淡入
+ *
+ * @param [out] plc  丢包隐藏器
+ */
+void audio_plc_init(audio_plc_t *plc);
+
+/**
+ * @brief  处理一个正常块：按需淡入/淡出，并保留拷贝用于隐藏
+ *
+ * @param [in]     plc       丢包隐藏器
+ * @param [in,out] pcm       16位交织PCM
+ * @param [in]     frames    帧数
+ * @param [in]     ch_count  声道数
+ */
+void audio_plc_process(audio_plc_t *plc, int16_t *pcm, size_t frames, uint8_t ch_count);
+
+/**
+ * @brief  欠载时产生隐藏块：最后一个正常块倒序淡出到静音，之后不再输出；
+ *         超过 max_frames 的部分在下一次调用时继续输出
+ *
+ * @param [in]  plc         丢包隐藏器
+ * @param [in]  ch_count    声道数
+ * @param [in]  max_frames  本次最多输出的帧数
+ * @param [out] frames      隐藏块帧数，0表示无需输出
+ *
+ * @return  concealment block, valid until the next call（隐藏块）
+ */
+int16_t *audio_plc_conceal(audio_plc_t *plc, uint8_t ch_count, size_t max_frames, size_t *frames);
+
+/**
+ * @brief  请求下一个输出块淡出到静音（流停止、编码重配置前调用）
+ *
+ * @param [in] plc  丢包隐藏器
+ */
+void audio_plc_request_fade_out(audio_plc_t *plc);
+
+/**
+ * @brief  标记流正在停止或重新开始，停止时的数据耗尽不计为数据缺口
+ *
+ * @param [in] plc       丢包隐藏器
+ * @param [in] stopping  true 为停止，false 为开始
+ */
+void audio_plc_set_stopping(audio_plc_t *plc, bool stopping);
+
+#endif /* __AUDIO_PLC_H__ */
@@ -0,0 +1,430 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+#include "audio_sink.h"
+
+#define AUDIO_SINK_TAG              "AUDIO_SINK"
+
+/* initial format until the codec is configured */
+#define AUDIO_SINK_DEFAULT_RATE     (44100)
+/* the SBC sample rates, their I2S clocks are built at install */
+static const uint32_t s_sink_rates[AUDIO_SINK_RATE_NUM] = { 16000, 32000, 44100, 48000 };
+/* DAC DMA layout, the descriptor payload is `buf_size` bytes of 8-bit samples */
+#define AUDIO_SINK_DAC_DESC_NUM     (8)
+#define AUDIO_SINK_DAC_BUF_SIZE     (2048)
+
+#if CONFIG_EXAMPLE_I2S_DATA_BITS_32
+#define AUDIO_SINK_I2S_FMT          AUDIO_SINK_FMT_S32
+#define AUDIO_SINK_I2S_BIT_WIDTH    I2S_DATA_BIT_WIDTH_32BIT
+#else
+#define AUDIO_SINK_I2S_FMT          AUDIO_SINK_FMT_S16
+#define AUDIO_SINK_I2S_BIT_WIDTH    I2S_DATA_BIT_WIDTH_16BIT
+#endif
+
+/* sample conversions, one per output format; the DSP chain runs on 16-bit PCM before them,
+   so the 32-bit slots carry the same full-scale stream and add no headroom */
+#define AUDIO_SINK_TO_S16(x)        ((int16_t)(x))
+#define AUDIO_SINK_TO_S32(x)        ((int32_t)(x) * 65536)
+#define AUDIO_SINK_TO_U8(x)         ((uint8_t)(((int32_t)(x) + 32768) >> 8))
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+/**
+ * Conversion kernels, specialised per output format and channel layout at compile time
+ * so the inner loops carry no per-sample branches.
+ */
+#define AUDIO_SINK_COPY_KERNELS(name, out_t, conv)                                          \
+    static void audio_sink_##name##_mono(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)      \
+    {                                                                                       \
+        out_t *d = (out_t *)dst;                                                            \
+        for (size_t i = 0; i < frames; i++) {                                               \
+            d[i] = conv(src[i]);                                                            \
+        }                                                                                   \
+    }                                                                                       \
+    static void audio_sink_##name##_stereo(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)    \
+    {                                                                                       \
+        out_t *d = (out_t *)dst;                                                            \
+        for (size_t i = 0; i < frames * 2; i += 2) {                                        \
+            d[i] = conv(src[i]);                                                            \
+            d[i + 1] = conv(src[i + 1]);                                                    \
+        }                                                                                   \
+    }
+
+#define AUDIO_SINK_UPMIX_KERNEL(name, out_t, conv)                                          \
+    static void audio_sink_##name##_upmix(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)     \
+    {                                                                                       \
+        out_t *d = (out_t *)dst;                                                            \
+        for (size_t i = 0; i < frames; i++) {                                               \
+            d[2 * i] = d[2 * i + 1] = conv(src[i]);                                         \
+        }                                                                                   \
+    }
+
+#define AUDIO_SINK_DOWNMIX_KERNEL(name, out_t, conv)                                        \
+    static void audio_sink_##name##_downmix(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)   \
+    {                                                                                       \
+        out_t *d = (out_t *)dst;                                                            \
+        for (size_t i = 0; i < frames; i++) {                                               \
+            d[i] = conv((src[2 * i] + src[2 * i + 1]) >> 1);                                \
+        }                                                                                   \
+    }
+
+AUDIO_SINK_DOWNMIX_KERNEL(s16, int16_t, AUDIO_SINK_TO_S16)
+AUDIO_SINK_UPMIX_KERNEL(s16, int16_t, AUDIO_SINK_TO_S16)
+AUDIO_SINK_COPY_KERNELS(s32, int32_t, AUDIO_SINK_TO_S32)
+AUDIO_SINK_DOWNMIX_KERNEL(s32, int32_t, AUDIO_SINK_TO_S32)
+AUDIO_SINK_UPMIX_KERNEL(s32, int32_t, AUDIO_SINK_TO_S32)
+#if CONFIG_EXAMPLE_A2DP_SINK_DAC_DITHER
+/**
+ * 8-bit kernels with noise-shaped dither, the quantiser keeps per-channel state in the sink.
+ * Their cost is measured per call and checked against AUDIO_DITHER_CYCLES_BUDGET by the reporter.
+ */
+static void audio_sink_u8_mono(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    for (size_t i = 0; i < frames; i++) {
+        d[i] = audio_dither_sample(&sink->dither, 0, src[i]);
+    }
+    audio_dither_account(&sink->dither, esp_cpu_get_cycle_count() - cycles, frames);
+}
+
+static void audio_sink_u8_stereo(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    for (size_t i = 0; i < frames * 2; i += 2) {
+        d[i] = audio_dither_sample(&sink->dither, 0, src[i]);
+        d[i + 1] = audio_dither_sample(&sink->dither, 1, src[i + 1]);
+    }
+    audio_dither_account(&sink->dither, esp_cpu_get_cycle_count() - cycles, frames * 2);
+}
+
+static void audio_sink_u8_downmix(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    for (size_t i = 0; i < frames; i++) {
+        d[i] = audio_dither_sample(&sink->dither, 0, (src[2 * i] + src[2 * i + 1]) >> 1);
+    }
+    audio_dither_account(&sink->dither, esp_cpu_get_cycle_count() - cycles, frames);
+}
+
+static void audio_sink_u8_upmix(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    for (size_t i = 0; i < frames; i++) {
+        d[2 * i] = d[2 * i + 1] = audio_dither_sample(&sink->dither, 0, src[i]);
+    }
+    audio_dither_account(&sink->dither, esp_cpu_get_cycle_count() - cycles, frames);
+}
+#else
+AUDIO_SINK_COPY_KERNELS(u8, uint8_t, AUDIO_SINK_TO_U8)
+AUDIO_SINK_DOWNMIX_KERNEL(u8, uint8_t, AUDIO_SINK_TO_U8)
+AUDIO_SINK_UPMIX_KERNEL(u8, uint8_t, AUDIO_SINK_TO_U8)
+#endif
+
+/* kernel table: [format][mono copy, stereo copy, stereo to mono, mono to stereo], NULL means plain copy */
+static const audio_sink_convert_t s_kernels[AUDIO_SINK_FMT_MAX][4] = {
+    [AUDIO_SINK_FMT_S16] = { NULL,                  NULL,                    audio_sink_s16_downmix,  audio_sink_s16_upmix },
+    [AUDIO_SINK_FMT_S32] = { audio_sink_s32_mono,   audio_sink_s32_stereo,   audio_sink_s32_downmix,  audio_sink_s32_upmix },
+    [AUDIO_SINK_FMT_U8]  = { audio_sink_u8_mono,    audio_sink_u8_stereo,    audio_sink_u8_downmix,   audio_sink_u8_upmix },
+};
+
+// 每个输出样本的字节数
+static size_t audio_sink_sample_bytes(audio_sink_fmt_t fmt)
+{
+    switch (fmt) {
+    case AUDIO_SINK_FMT_S32:
+        return sizeof(int32_t);
+    case AUDIO_SINK_FMT_U8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(int16_t);
+    }
+}
+
+// 按流的声道数选出输出声道数和转换内核
+static void audio_sink_select_kernel(audio_sink_t *sink, uint8_t ch_count)
+{
+    sink->in_ch = ch_count;
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MONO
+    sink->out_ch = 1;
+#else
+    // DAC的声道模式在创建时确定，单声道流复制到两个声道
+    sink->out_ch = (sink->type == AUDIO_SINK_DAC) ? 2 : ch_count;
+#endif
+    sink->frame_bytes = sink->out_ch * audio_sink_sample_bytes(sink->fmt);
+    if (sink->in_ch == sink->out_ch) {
+        sink->convert = s_kernels[sink->fmt][sink->in_ch - 1];
+    } else {
+        sink->convert = s_kernels[sink->fmt][(sink->out_ch == 1) ? 2 : 3];
+    }
+    audio_dither_init(&sink->dither);
+}
+
+// I2S描述符发送完成回调
+// 刚发送完的描述符在DMA环中转一圈后再次发送，直接在其中填充下一段音频
+static bool audio_sink_i2s_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    audio_sink_t *sink = (audio_sink_t *)user_ctx;
+
+    return sink->refill(event->dma_buf, event->size / sink->frame_bytes);
+}
+
+// I2S配置
+static void audio_sink_i2s_config(audio_sink_t *sink, uint32_t sample_rate, i2s_std_config_t *std_cfg)
+{
+    i2s_std_config_t cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate),
+        .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(AUDIO_SINK_I2S_BIT_WIDTH, sink->out_ch),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = CONFIG_EXAMPLE_I2S_BCK_PIN,
+            .ws = CONFIG_EXAMPLE_I2S_LRCK_PIN,
+            .dout = CONFIG_EXAMPLE_I2S_DATA_PIN,
+            .din = I2S_GPIO_UNUSED,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
+    };
+    *std_cfg = cfg;
+}
+
+// 预先建好各SBC采样率的时钟配置和各声道数的时隙配置，重配置时原地切换
+static void audio_sink_i2s_prepare(audio_sink_t *sink)
+{
+    for (int i = 0; i < AUDIO_SINK_RATE_NUM; i++) {
+        i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(s_sink_rates[i]);
+        sink->clk_cfg[i] = clk_cfg;
+    }
+    for (int i = 0; i < 2; i++) {
+        i2s_std_slot_config_t slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(AUDIO_SINK_I2S_BIT_WIDTH, i + 1);
+        sink->slot_cfg[i] = slot_cfg;
+    }
+}
+
+// 切换I2S时钟，采样率不在表中时现算
+static void audio_sink_i2s_reclock(audio_sink_t *sink, uint32_t sample_rate)
+{
+    for (int i = 0; i < AUDIO_SINK_RATE_NUM; i++) {
+        if (s_sink_rates[i] == sample_rate) {
+            i2s_channel_reconfig_std_clock(sink->i2s, &sink->clk_cfg[i]);
+            return;
+        }
+    }
+    i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
+    i2s_channel_reconfig_std_clock(sink->i2s, &clk_cfg);
+}
+
+// 安装I2S通道
+static void audio_sink_i2s_install(audio_sink_t *sink)
+{
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    i2s_std_config_t std_cfg;
+
+    // 拉取模式下回调已写满整个描述符，不能再被自动清零
+    chan_cfg.auto_clear = (sink->refill == NULL);
+    sink->dma_frames = chan_cfg.dma_desc_num * chan_cfg.dma_frame_num;
+    audio_sink_i2s_prepare(sink);
+    audio_sink_i2s_config(sink, AUDIO_SINK_DEFAULT_RATE, &std_cfg);
+    /* enable I2S */
+    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &sink->i2s, NULL));
+    ESP_ERROR_CHECK(i2s_channel_init_std_mode(sink->i2s, &std_cfg));
+    if (sink->refill) {
+        i2s_event_callbacks_t cbs = {
+            .on_sent = audio_sink_i2s_on_sent,
+        };
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(sink->i2s, &cbs, sink));
+    }
+    ESP_ERROR_CHECK(i2s_channel_enable(sink->i2s));
+}
+
+#if SOC_DAC_SUPPORTED
+// DAC缓冲区转换完成回调
+static bool audio_sink_dac_on_convert_done(dac_continuous_handle_t handle, const dac_event_data_t *event, void *user_data)
+{
+    audio_sink_t *sink = (audio_sink_t *)user_data;
+#if CONFIG_DAC_DMA_AUTO_16BIT_ALIGN
+    /* every byte is expanded to a 16-bit DMA slot */
+    size_t size = event->buf_size / 2;
+#else
+    size_t size = event->buf_size;
+#endif
+    size_t frames = ((size < sizeof(sink->stage)) ? size : sizeof(sink->stage)) / sink->frame_bytes;
+    size_t loaded = 0;
+    bool woken = sink->refill(sink->stage, frames);
+
+    dac_continuous_write_asynchronously(handle, event->buf, event->buf_size, (const uint8_t *)sink->stage,
+                                        frames * sink->frame_bytes, &loaded);
+    return woken;
+}
+
+// 创建DAC通道，声道模式由编译期的输出声道数决定，之后不再改变
+static void audio_sink_dac_create(audio_sink_t *sink, uint32_t sample_rate)
+{
+    dac_continuous_config_t cont_cfg = {
+        .chan_mask = DAC_CHANNEL_MASK_ALL,
+        .desc_num = AUDIO_SINK_DAC_DESC_NUM,
+        .buf_size = AUDIO_SINK_DAC_BUF_SIZE,
+        .freq_hz = sample_rate,
+        .offset = 0,                           // samples are already offset binary
+        .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,   // Using APLL as clock source to get a wider frequency range
+        .chan_mode = (sink->out_ch == 1) ? DAC_CHANNEL_MODE_SIMUL : DAC_CHANNEL_MODE_ALTER,
+    };
+    /* Allocate continuous channels */
+    ESP_ERROR_CHECK(dac_continuous_new_channels(&cont_cfg, &sink->dac));
+#if CONFIG_DAC_DMA_AUTO_16BIT_ALIGN
+    sink->dma_frames = AUDIO_SINK_DAC_DESC_NUM * (AUDIO_SINK_DAC_BUF_SIZE / 2) / sink->frame_bytes;
+#else
+    sink->dma_frames = AUDIO_SINK_DAC_DESC_NUM * AUDIO_SINK_DAC_BUF_SIZE / sink->frame_bytes;
+#endif
+    if (sink->refill) {
+        dac_event_callbacks_t cbs = {
+            .on_convert_done = audio_sink_dac_on_convert_done,
+        };
+        ESP_ERROR_CHECK(dac_continuous_register_event_callback(sink->dac, &cbs, sink));
+    }
+}
+
+// 启用DAC通道
+static void audio_sink_dac_enable(audio_sink_t *sink)
+{
+    /* Enable the continuous channels */
+    ESP_ERROR_CHECK(dac_continuous_enable(sink->dac));
+    if (sink->refill) {
+        ESP_ERROR_CHECK(dac_continuous_start_async_writing(sink->dac));
+    }
+}
+
+// 停用DAC通道，返回后不再有DMA回调
+static void audio_sink_dac_disable(audio_sink_t *sink)
+{
+    if (sink->refill) {
+        ESP_ERROR_CHECK(dac_continuous_stop_async_writing(sink->dac));
+    }
+    ESP_ERROR_CHECK(dac_continuous_disable(sink->dac));
+}
+#endif
+
+// 写入输出通道
+static void audio_sink_write_raw(audio_sink_t *sink, const void *data, size_t size)
+{
+    size_t bytes_written = 0;
+
+#if SOC_DAC_SUPPORTED
+    if (sink->type == AUDIO_SINK_DAC) {
+        dac_continuous_write(sink->dac, (uint8_t *)data, size, &bytes_written, -1);
+        return;
+    }
+#endif
+    i2s_channel_write(sink->i2s, data, size, &bytes_written, portMAX_DELAY);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 安装输出设备
+void audio_sink_install(audio_sink_t *sink, audio_sink_type_t type, audio_sink_refill_t refill)
+{
+#if !SOC_DAC_SUPPORTED
+    if (type == AUDIO_SINK_DAC) {
+        ESP_LOGW(AUDIO_SINK_TAG, "no internal DAC on this chip, using I2S");
+        type = AUDIO_SINK_I2S;
+    }
+#endif
+    sink->type = type;
+    sink->refill = refill;
+    sink->sample_rate = AUDIO_SINK_DEFAULT_RATE;
+    sink->fmt = (type == AUDIO_SINK_DAC) ? AUDIO_SINK_FMT_U8 : AUDIO_SINK_I2S_FMT;
+    audio_sink_select_kernel(sink, 2);
+
+#if SOC_DAC_SUPPORTED
+    if (type == AUDIO_SINK_DAC) {
+        audio_sink_dac_create(sink, AUDIO_SINK_DEFAULT_RATE);
+        audio_sink_dac_enable(sink);
+    } else
+#endif
+    {
+        audio_sink_i2s_install(sink);
+    }
+    sink->running = true;
+    ESP_LOGI(AUDIO_SINK_TAG, "%s sink installed, %s mode, %u bytes per frame",
+             (type == AUDIO_SINK_DAC) ? "DAC" : "I2S", refill ? "pull" : "push", (unsigned)sink->frame_bytes);
+}
+
+// 停止输出
+void audio_sink_stop(audio_sink_t *sink)
+{
+    sink->running = false;
+#if SOC_DAC_SUPPORTED
+    if (sink->type == AUDIO_SINK_DAC) {
+        audio_sink_dac_disable(sink);
+        return;
+    }
+#endif
+    i2s_channel_disable(sink->i2s);
+}
+
+// 重配置并启动输出
+void audio_sink_start(audio_sink_t *sink, uint32_t sample_rate, uint8_t ch_count)
+{
+    uint32_t prev_rate = sink->sample_rate;
+    uint8_t prev_out_ch = sink->out_ch;
+
+    audio_sink_select_kernel(sink, ch_count);
+    sink->sample_rate = sample_rate;
+    sink->running = true;
+
+#if SOC_DAC_SUPPORTED
+    if (sink->type == AUDIO_SINK_DAC) {
+        // 声道布局固定，只有采样率变化时才重建：DAC驱动没有修改频率的接口
+        if (sample_rate != prev_rate) {
+            ESP_ERROR_CHECK(dac_continuous_del_channels(sink->dac));
+            audio_sink_dac_create(sink, sample_rate);
+        }
+        audio_sink_dac_enable(sink);
+        return;
+    }
+#endif
+    /* the channel keeps its DMA buffers, only what changed is switched from the prepared configs */
+    if (sample_rate != prev_rate) {
+        audio_sink_i2s_reclock(sink, sample_rate);
+    }
+    if (sink->out_ch != prev_out_ch) {
+        i2s_channel_reconfig_std_slot(sink->i2s, &sink->slot_cfg[sink->out_ch - 1]);
+    }
+    i2s_channel_enable(sink->i2s);
+}
+
+// 推送模式写入
+void audio_sink_write(audio_sink_t *sink, const int16_t *pcm, size_t frames)
+{
+    size_t chunk_max = sizeof(sink->stage) / sink->frame_bytes;
+
+    if (sink->convert == NULL) {
+        audio_sink_write_raw(sink, pcm, frames * sink->frame_bytes);
+        return;
+    }
+
+    // 分块转换进暂存区后写入
+    while (frames > 0) {
+        size_t chunk = (frames < chunk_max) ? frames : chunk_max;
+        sink->convert(sink, sink->stage, pcm, chunk);
+        audio_sink_write_raw(sink, sink->stage, chunk * sink->frame_bytes);
+        pcm += chunk * sink->in_ch;
+        frames -= chunk;
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef __AUDIO_SINK_H__
+#define __AUDIO_SINK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "soc/soc_caps.h"
+#include "driver/i2s_std.h"
+#if SOC_DAC_SUPPORTED
+#include "driver/dac_continuous.h"
+#endif
+#include "audio_dither.h"
+
+/* staging buffer for converted samples, in bytes */
+#define AUDIO_SINK_STAGE_BYTES      (2048)
+/* sample rates the I2S clock is prepared for at install */
+#define AUDIO_SINK_RATE_NUM         (4)
+
+/* output device */
+typedef enum {
+    AUDIO_SINK_I2S,         /* external I2S codec */                // 外部I2S编解码器
+    AUDIO_SINK_DAC,         /* internal 8-bit DAC */                // 内部8位DAC
+} audio_sink_type_t;
+
+/* sample format on the output DMA */
+typedef enum {
+    AUDIO_SINK_FMT_S16,     /* 16-bit signed */                     // 16位有符号
+    AUDIO_SINK_FMT_S32,     /* 32-bit signed, the 16-bit stream in the top half */   // 32位有符号，16位流放在高16位
+    AUDIO_SINK_FMT_U8,      /* 8-bit offset binary */               // 8位偏移二进制
+    AUDIO_SINK_FMT_MAX,
+} audio_sink_fmt_t;
+
+typedef struct audio_sink_s audio_sink_t;
+
+/* conversion kernel: `frames` frames of 16-bit PCM to sink samples */
+typedef void (*audio_sink_convert_t)(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames);
+
+/* pull mode refill: fill `frames` frames of sink samples at `dst`, runs in the DMA callback,
+   returns true if it woke a task that should run as soon as the interrupt returns */
+typedef bool (*audio_sink_refill_t)(void *dst, size_t frames);
+
+/**
+ * 输出设备接口
+ *
+ * 使用外部I2S还是内部DAC由Kconfig在编译期选定，第一次连接时安装，运行中不切换。
+ * 每种输出格式和声道布局都有一个编译期特化的转换内核，在重配置时按流的格式选出，
+ * 转换和从ringbuffer拷贝合并为一步，每个样本只读写一次。
+ * 16位同声道数时不需要转换，推送模式下直接写入ringbuffer中的数据。
+ * 内部DAC可选噪声整形抖动，代替直接截断到8位。
+ * 设备安装后在多次连接之间保持运行，格式不变时无需停止输出。
+ * I2S在安装时预先建好各SBC采样率的时钟和各声道数的时隙配置，重配置时原地切换；
+ * DAC的声道布局固定，单声道流复制到两个声道，只有采样率变化时才重建通道。
+ */
+struct audio_sink_s {
+    audio_sink_type_t       type;           /*!< installed device */                     // 输出设备
+    audio_sink_fmt_t        fmt;            /*!< sample format on the DMA */             // 输出格式
+    uint8_t                 in_ch;          /*!< channels of the stream */               // 流的声道数
+    uint8_t                 out_ch;         /*!< channels on the DMA */                  // 输出声道数
+    size_t                  frame_bytes;    /*!< bytes per output frame */               // 每帧输出字节数
+    size_t                  dma_frames;     /*!< frames queued on the DMA when it is full */   // DMA队列满时的帧数
+    uint32_t                sample_rate;    /*!< rate the output is clocked at */        // 当前采样率
+    bool                    running;        /*!< started, not stopped for a reconfiguration */   // 正在输出
+    audio_sink_convert_t    convert;        /*!< NULL if the PCM is written as is */     // 转换内核
+    audio_sink_refill_t     refill;         /*!< NULL in push mode */                    // 拉取模式填充函数
+    i2s_chan_handle_t       i2s;            /*!< I2S channel */                          // I2S通道
+    i2s_std_clk_config_t    clk_cfg[AUDIO_SINK_RATE_NUM];   /*!< I2S clock per SBC rate */       // 各采样率的时钟配置
+    i2s_std_slot_config_t   slot_cfg[2];    /*!< I2S slots per output channel count */   // 各声道数的时隙配置
+#if SOC_DAC_SUPPORTED
+    dac_continuous_handle_t dac;            /*!< DAC channels */                         // DAC通道
+#endif
+    audio_dither_t          dither;         /*!< noise shaper of the 8-bit DAC path */   // 8位DAC的噪声整形
+    uint32_t                stage[AUDIO_SINK_STAGE_BYTES / sizeof(uint32_t)];   /*!< converted samples */  // 转换暂存区
+};
+
+/**
+ * @brief  安装并启动输出设备，初始为 44.1 kHz 双声道
+ *
+ * @param [out] sink    输出设备
+ * @param [in]  type    设备类型
+ * @param [in]  refill  拉取模式的填充函数，NULL 为推送模式
+ */
+void audio_sink_install(audio_sink_t *sink, audio_sink_type_t type, audio_sink_refill_t refill);
+
+/**
+ * @brief  停止输出（重配置前调用），返回后不再有DMA回调；推送模式下调用者须先让写入任务停下
+ *
+ * @param [in] sink  输出设备
+ */
+void audio_sink_stop(audio_sink_t *sink);
+
+/**
+ * @brief  按新的采样率和声道数重配置，选出转换内核并重新启动输出
+ *
+ * @param [in] sink         输出设备
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     流的声道数
+ */
+void audio_sink_start(audio_sink_t *sink, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  输出是否已按给定的格式运行（此时重配置可以跳过）
+ *
+ * @param [in] sink         输出设备
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     流的声道数
+ */
+static inline bool audio_sink_running_as(const audio_sink_t *sink, uint32_t sample_rate, uint8_t ch_count)
+{
+    return sink->running && sink->sample_rate == sample_rate && sink->in_ch == ch_count;
+}
+
+/**
+ * @brief  推送模式：转换并阻塞写入
+ *
+ * @param [in] sink    输出设备
+ * @param [in] pcm     16位交织PCM
+ * @param [in] frames  帧数
+ */
+void audio_sink_write(audio_sink_t *sink, const int16_t *pcm, size_t frames);
+
+/**
+ * @brief  转换：16位PCM转为输出格式
+ *
+ * @param [in]  sink    输出设备
+ * @param [out] dst     输出样本
+ * @param [in]  src     16位交织PCM
+ * @param [in]  frames  帧数
+ */
+static inline void audio_sink_convert(audio_sink_t *sink, void *dst, const int16_t *src, size_t frames)
+{
+    if (sink->convert == NULL) {
+        memcpy(dst, src, frames * sink->frame_bytes);
+    } else {
+        sink->convert(sink, dst, src, frames);
+    }
+}
+
+/**
+ * @brief  以输出格式的静音填充
+ *
+ * @param [in]  sink    输出设备
+ * @param [out] dst     输出样本
+ * @param [in]  frames  帧数
+ */
+static inline void audio_sink_silence(const audio_sink_t *sink, void *dst, size_t frames)
+{
+    /* offset binary puts zero at mid-scale */
+    memset(dst, (sink->fmt == AUDIO_SINK_FMT_U8) ? 0x80 : 0, frames * sink->frame_bytes);
+}
+
+#endif /* __AUDIO_SINK_H__ */
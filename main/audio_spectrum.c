@@ -0,0 +1,215 @@
+#include <string.h>
+#include <math.h>
+#include "audio_spectrum.h"
+
+/* highest rate analysed, the stream is decimated by two above it */
+#define AUDIO_SPECTRUM_MAX_RATE     (24000)
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 按帧的采样率划分各条的频点：从 AUDIO_SPECTRUM_LOW_HZ 到奈奎斯特频率按对数等分，每条至少一个频点
+static void audio_spectrum_place_edges(audio_spectrum_t *sp, uint32_t rate)
+{
+    const uint16_t last = AUDIO_SPECTRUM_FFT_SIZE / 2;
+    double ratio = (rate / 2.0) / AUDIO_SPECTRUM_LOW_HZ;
+
+    for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+        double hz = AUDIO_SPECTRUM_LOW_HZ * pow(ratio, (double)b / AUDIO_SPECTRUM_BARS);
+        long bin = lrint(hz * AUDIO_SPECTRUM_FFT_SIZE / rate);
+        uint16_t lo = (b == 0) ? 1 : sp->edges[b - 1] + 1;
+
+        sp->edges[b] = (bin < lo) ? lo : (uint16_t)bin;
+    }
+    sp->edges[AUDIO_SPECTRUM_BARS] = last;
+    sp->edges_rate = rate;
+}
+
+// 处理链适配
+static void audio_spectrum_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_spectrum_feed((audio_spectrum_t *)ctx, pcm, frames);
+}
+
+static void audio_spectrum_stage_configure(void *ctx, uint32_t sample_rate, uint8_t ch_count)
+{
+    audio_spectrum_configure((audio_spectrum_t *)ctx, sample_rate, ch_count);
+}
+
+static bool audio_spectrum_stage_bypassed(void *ctx)
+{
+    audio_spectrum_t *sp = (audio_spectrum_t *)ctx;
+
+    return !atomic_load(&sp->want) || atomic_load(&sp->ready);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_spectrum_init(audio_spectrum_t *sp)
+{
+    memset(sp, 0, sizeof(audio_spectrum_t));
+    atomic_init(&sp->want, false);
+    atomic_init(&sp->ready, false);
+    for (int i = 0; i < AUDIO_SPECTRUM_FFT_SIZE; i++) {
+        sp->window[i] = (int16_t)lrint((0.5 - 0.5 * cos(2.0 * M_PI * i / AUDIO_SPECTRUM_FFT_SIZE)) * 32767.0);
+    }
+    for (int k = 0; k < AUDIO_SPECTRUM_FFT_SIZE / 2; k++) {
+        sp->cos_tab[k] = (int16_t)lrint(cos(2.0 * M_PI * k / AUDIO_SPECTRUM_FFT_SIZE) * 32767.0);
+        sp->sin_tab[k] = (int16_t)lrint(sin(2.0 * M_PI * k / AUDIO_SPECTRUM_FFT_SIZE) * 32767.0);
+    }
+    audio_spectrum_configure(sp, 44100, 2);
+}
+
+// 按采样率和声道数配置
+void audio_spectrum_configure(audio_spectrum_t *sp, uint32_t sample_rate, uint8_t ch_count)
+{
+    /* a frame already handed over keeps its own rate, only the one being captured is restarted */
+    sp->sample_rate = sample_rate;
+    sp->ch_count = (ch_count > 2) ? 2 : ch_count;
+    sp->decim_log2 = (sample_rate > AUDIO_SPECTRUM_MAX_RATE) ? 1 : 0;
+    sp->decim_acc = 0;
+    sp->decim_n = 0;
+    sp->frame_n = 0;
+}
+
+// 采集一段PCM
+void audio_spectrum_feed(audio_spectrum_t *sp, const int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = sp->ch_count;
+    const uint8_t factor = 1 << sp->decim_log2;
+    const uint8_t shift = sp->decim_log2 + ((ch == 2) ? 1 : 0);
+
+    if (!atomic_load(&sp->want) || atomic_load(&sp->ready)) {
+        return;
+    }
+
+    // 盒式平均：声道和抽取一起求平均
+    for (size_t i = 0; i < frames; i++, pcm += ch) {
+        for (int c = 0; c < ch; c++) {
+            sp->decim_acc += pcm[c];
+        }
+        if (++sp->decim_n < factor) {
+            continue;
+        }
+        sp->frame[sp->frame_n++] = (int16_t)(sp->decim_acc >> shift);
+        sp->decim_acc = 0;
+        sp->decim_n = 0;
+        if (sp->frame_n == AUDIO_SPECTRUM_FFT_SIZE) {
+            sp->frame_n = 0;
+            sp->frame_rate = sp->sample_rate >> sp->decim_log2;
+            atomic_store(&sp->want, false);
+            atomic_store(&sp->ready, true);
+            return;
+        }
+    }
+}
+
+// 基2按时间抽取FFT
+void audio_spectrum_fft(const audio_spectrum_t *sp, int16_t *re, int16_t *im)
+{
+    const int n = AUDIO_SPECTRUM_FFT_SIZE;
+
+    // 位反转重排
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            int16_t t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    /* every stage halves its outputs, so a magnitude within Q15 stays within Q15 */
+    for (int len = 2, step = n / 2; len <= n; len <<= 1, step >>= 1) {
+        const int half = len >> 1;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < half; k++) {
+                const int32_t wr = sp->cos_tab[k * step];
+                const int32_t wi = sp->sin_tab[k * step];
+                const int a = i + k;
+                const int b = a + half;
+                // 乘以 W = cos - j sin
+                int32_t tr = (re[b] * wr + im[b] * wi) >> 15;
+                int32_t ti = (im[b] * wr - re[b] * wi) >> 15;
+                re[b] = (int16_t)((re[a] - tr) >> 1);
+                im[b] = (int16_t)((im[a] - ti) >> 1);
+                re[a] = (int16_t)((re[a] + tr) >> 1);
+                im[a] = (int16_t)((im[a] + ti) >> 1);
+            }
+        }
+    }
+}
+
+// 分析新帧并更新条高
+bool audio_spectrum_update(audio_spectrum_t *sp, uint8_t fall)
+{
+    /* a full-scale sine after the Hann window (gain 1/2) and the 1/N scaling of the FFT */
+    const float full_scale = (32768.0f / 4) * (32768.0f / 4);
+    uint32_t rate;
+
+    if (!atomic_load(&sp->ready)) {
+        for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+            sp->levels[b] = (sp->levels[b] > fall) ? sp->levels[b] - fall : 0;
+        }
+        sp->dropped++;
+        atomic_store(&sp->want, true);
+        return false;
+    }
+
+    // 加窗拷出后立即交还帧缓冲，处理路径可以开始采集下一帧
+    rate = sp->frame_rate;
+    for (int i = 0; i < AUDIO_SPECTRUM_FFT_SIZE; i++) {
+        sp->re[i] = (int16_t)((sp->frame[i] * sp->window[i]) >> 15);
+        sp->im[i] = 0;
+    }
+    atomic_store(&sp->ready, false);
+    atomic_store(&sp->want, true);
+
+    if (rate != sp->edges_rate) {
+        audio_spectrum_place_edges(sp, rate);
+    }
+    audio_spectrum_fft(sp, sp->re, sp->im);
+
+    for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+        uint64_t power = 0;
+        float db;
+        int32_t level;
+
+        for (int k = sp->edges[b]; k < sp->edges[b + 1]; k++) {
+            power += (uint64_t)((int32_t)sp->re[k] * sp->re[k] + (int32_t)sp->im[k] * sp->im[k]);
+        }
+        db = (power > 0) ? 10.0f * log10f((float)power / full_scale) : -AUDIO_SPECTRUM_RANGE_DB;
+        level = (int32_t)lrintf((db + AUDIO_SPECTRUM_RANGE_DB) * AUDIO_SPECTRUM_LEVEL_MAX / AUDIO_SPECTRUM_RANGE_DB);
+        if (level > AUDIO_SPECTRUM_LEVEL_MAX) {
+            level = AUDIO_SPECTRUM_LEVEL_MAX;
+        } else if (level < 0) {
+            level = 0;
+        }
+        // 上升立即跟随，下降限速
+        if (level < sp->levels[b] - fall) {
+            level = sp->levels[b] - fall;
+        }
+        sp->levels[b] = (uint8_t)level;
+    }
+    sp->frames++;
+    return true;
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_spectrum_stage = {
+    .name = "spectrum",
+    .process = audio_spectrum_stage_process,
+    .configure = audio_spectrum_stage_configure,
+    .bypassed = audio_spectrum_stage_bypassed,
+};
@@ -0,0 +1,110 @@
+#ifndef __AUDIO_SPECTRUM_H__
+#define __AUDIO_SPECTRUM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "audio_chain.h"
+
+/* FFT length, as a power of two */
+#define AUDIO_SPECTRUM_FFT_LOG2     (9)
+#define AUDIO_SPECTRUM_FFT_SIZE     (1 << AUDIO_SPECTRUM_FFT_LOG2)
+/* bars on the display */
+#define AUDIO_SPECTRUM_BARS         (8)
+/* lower edge of the first bar */
+#define AUDIO_SPECTRUM_LOW_HZ       (50)
+/* level range shown by a bar, below full scale */
+#define AUDIO_SPECTRUM_RANGE_DB     (60)
+/* full bar */
+#define AUDIO_SPECTRUM_LEVEL_MAX    (100)
+
+/**
+ * 频谱分析（可视化）
+ *
+ * 输出路径上的只读分析点：读取方需要一帧时置位请求，处理路径把声道和抽取到不超过 24 kHz 后写入帧缓冲，
+ * 写满后交给读取方并停止采集；没有请求时直接返回，不消耗CPU，也不计入处理链耗时。
+ * 处理路径从不等待读取方，读取方来不及取走的帧不会被采集，读取时没有新帧则本次显示跳过（丢帧）。
+ * 分析在读取方的低优先级任务中进行：加汉宁窗，定点基2 FFT（每级右移一位防止溢出），
+ * 功率谱按对数间隔合并成若干条，换算成dB后映射到 0~100，上升立即跟随、下降按给定速度回落。
+ */
+typedef struct {
+    /* written by the audio path while `want` is set and `ready` is clear */
+    int16_t          frame[AUDIO_SPECTRUM_FFT_SIZE];    /*!< decimated mono samples */      // 抽取后的单声道样本
+    uint16_t         frame_n;           /*!< samples captured so far */                     // 已采集的样本数
+    uint32_t         frame_rate;        /*!< rate of the captured frame */                  // 帧的采样率
+    int32_t          decim_acc;         /*!< box sum of the current output sample */        // 抽取累加
+    uint8_t          decim_n;           /*!< frames in the box sum */                       // 已累加的帧数
+
+    /* written by the configuration path only */
+    uint32_t         sample_rate;       /*!< rate of the stream */                          // 流的采样率
+    uint8_t          ch_count;          /*!< channels of the stream */                      // 声道数
+    uint8_t          decim_log2;        /*!< decimation factor, as a shift */               // 抽取倍数（移位）
+
+    /* handshake between the audio path and the reader */
+    atomic_bool      want;              /*!< the reader asks for a frame */                 // 读取方请求一帧
+    atomic_bool      ready;             /*!< a complete frame waits */                      // 一帧已采集完成
+
+    /* reader side */
+    int16_t          re[AUDIO_SPECTRUM_FFT_SIZE];       /*!< FFT work, real part */         // FFT实部
+    int16_t          im[AUDIO_SPECTRUM_FFT_SIZE];       /*!< FFT work, imaginary part */    // FFT虚部
+    int16_t          window[AUDIO_SPECTRUM_FFT_SIZE];   /*!< Hann window, Q15 */            // 汉宁窗
+    int16_t          cos_tab[AUDIO_SPECTRUM_FFT_SIZE / 2];   /*!< twiddles, Q15 */          // 旋转因子
+    int16_t          sin_tab[AUDIO_SPECTRUM_FFT_SIZE / 2];
+    uint16_t         edges[AUDIO_SPECTRUM_BARS + 1];    /*!< first FFT bin of every bar */  // 每条的起始频点
+    uint32_t         edges_rate;        /*!< rate the edges were placed for */              // 频点划分对应的采样率
+    uint8_t          levels[AUDIO_SPECTRUM_BARS];       /*!< smoothed bar levels */         // 平滑后的条高
+    uint32_t         frames;            /*!< frames analysed */                             // 已分析的帧数
+    uint32_t         dropped;           /*!< updates without a new frame */                 // 没有新帧的次数
+} audio_spectrum_t;
+
+/**
+ * @brief  初始化（窗函数和旋转因子表）
+ *
+ * @param [out] sp  频谱分析
+ */
+void audio_spectrum_init(audio_spectrum_t *sp);
+
+/**
+ * @brief  按流的采样率和声道数配置抽取，丢弃正在采集的帧
+ *
+ * @param [in] sp           频谱分析
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_spectrum_configure(audio_spectrum_t *sp, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  处理路径：有请求时采集一段PCM（不修改PCM，可在DMA回调中调用）
+ *
+ * @param [in] sp      频谱分析
+ * @param [in] pcm     16位交织PCM
+ * @param [in] frames  帧数
+ */
+void audio_spectrum_feed(audio_spectrum_t *sp, const int16_t *pcm, size_t frames);
+
+/**
+ * @brief  原地定点FFT，输入输出均为Q15，结果缩小 AUDIO_SPECTRUM_FFT_SIZE 倍
+ *
+ * @param [in]     sp  频谱分析（旋转因子表）
+ * @param [in,out] re  实部，按自然顺序
+ * @param [in,out] im  虚部，按自然顺序
+ */
+void audio_spectrum_fft(const audio_spectrum_t *sp, int16_t *re, int16_t *im);
+
+/**
+ * @brief  读取方：有新帧时分析并更新条高，否则条高回落；然后请求下一帧（低优先级任务中调用）
+ *
+ * @param [in] sp    频谱分析
+ * @param [in] fall  本次最多回落的高度
+ *
+ * @return  true if a new frame was analysed, false if this update was dropped（有新帧返回true）
+ */
+bool audio_spectrum_update(audio_spectrum_t *sp, uint8_t fall);
+
+/**
+ * 处理链中的频谱分析点，ctx 为 audio_spectrum_t，没有请求时跳过
+ */
+extern const audio_chain_stage_desc_t audio_spectrum_stage;
+
+#endif /* __AUDIO_SPECTRUM_H__ */
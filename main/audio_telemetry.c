@@ -0,0 +1,201 @@
+#include <string.h>
+#include "audio_telemetry.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 时间分档：第一档不足一个单位，之后每档翻倍，最后一档不封顶
+static uint8_t audio_telemetry_time_bin(uint32_t us)
+{
+    uint32_t units = us / AUDIO_TELEMETRY_TIME_UNIT_US;
+    uint8_t bin = (units == 0) ? 0 : (uint8_t)(32 - __builtin_clz(units));
+
+    return (bin < AUDIO_TELEMETRY_TIME_BINS) ? bin : AUDIO_TELEMETRY_TIME_BINS - 1;
+}
+
+// 单一写入方更新最大值，不需要比较交换
+static void audio_telemetry_raise(_Atomic uint32_t *max, uint32_t v)
+{
+    if (v > atomic_load_explicit(max, memory_order_relaxed)) {
+        atomic_store_explicit(max, v, memory_order_relaxed);
+    }
+}
+
+// 更新本窗口的最大值；报告方会随时清零，用比较交换，清零之后到达的值不会丢失
+static void audio_telemetry_raise_window(_Atomic uint32_t *max, uint32_t v)
+{
+    uint32_t cur = atomic_load_explicit(max, memory_order_relaxed);
+
+    while (v > cur && !atomic_compare_exchange_weak_explicit(max, &cur, v, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// 一个字节中只能选中一个选项，返回其位号（从高位的 first 往低数 n 位），否则返回 -1
+static int audio_telemetry_one_of(uint8_t octet, int first, int n)
+{
+    int found = -1;
+
+    for (int i = 0; i < n; i++) {
+        if (octet & (1 << (first - i))) {
+            if (found >= 0) {
+                return -1;
+            }
+            found = i;
+        }
+    }
+    return found;
+}
+
+// 逐个读取一组原子计数
+static void audio_telemetry_copy(_Atomic uint32_t *src, uint32_t *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = atomic_load_explicit(&src[i], memory_order_relaxed);
+    }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 记录数据包到达
+void audio_telemetry_on_arrival(audio_telemetry_t *tm, size_t fill, uint32_t jitter_us, int64_t now_us)
+{
+    size_t bin = (tm->capacity > 0) ? fill * AUDIO_TELEMETRY_FILL_BINS / tm->capacity : 0;
+
+    if (bin >= AUDIO_TELEMETRY_FILL_BINS) {
+        bin = AUDIO_TELEMETRY_FILL_BINS - 1;
+    }
+    atomic_fetch_add_explicit(&tm->fill_hist[bin], 1, memory_order_relaxed);
+
+    /* the first packet after boot has no previous one to measure against */
+    if (tm->last_arrival_us != 0) {
+        uint32_t gap_us = (uint32_t)(now_us - tm->last_arrival_us);
+        atomic_fetch_add_explicit(&tm->arrival_hist[audio_telemetry_time_bin(gap_us)], 1, memory_order_relaxed);
+        audio_telemetry_raise(&tm->arrival_max_us, gap_us);
+        audio_telemetry_raise_window(&tm->arrival_window_us, gap_us);
+    }
+    tm->last_arrival_us = now_us;
+    atomic_store_explicit(&tm->jitter_us, jitter_us, memory_order_relaxed);
+}
+
+// 记录一次输出
+void audio_telemetry_on_output(audio_telemetry_t *tm, size_t bytes, uint32_t write_us)
+{
+    atomic_fetch_add_explicit(&tm->blocks_out, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tm->bytes_out, (uint32_t)bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tm->write_hist[audio_telemetry_time_bin(write_us)], 1, memory_order_relaxed);
+    audio_telemetry_raise(&tm->write_max_us, write_us);
+    audio_telemetry_raise_window(&tm->write_window_us, write_us);
+}
+
+// 保存SBC参数
+void audio_telemetry_set_sbc(audio_telemetry_t *tm, const uint8_t cie[4])
+{
+    uint32_t packed = cie[0] | (cie[1] << 8) | (cie[2] << 16) | ((uint32_t)cie[3] << 24);
+
+    atomic_store(&tm->sbc_cie, packed);
+}
+
+// 解码SBC参数（A2DP 规范 4.3.2），码率按 A2DP 规范 12.9 的帧长公式
+bool audio_telemetry_decode_sbc(const uint8_t cie[4], audio_telemetry_sbc_t *sbc)
+{
+    static const uint32_t rates[] = { 16000, 32000, 44100, 48000 };
+    static const uint8_t blocks[] = { 4, 8, 12, 16 };
+    /* channel mode bits run mono, dual, stereo, joint from bit 3 down */
+    int rate = audio_telemetry_one_of(cie[0], 7, 4);
+    int mode = audio_telemetry_one_of(cie[0], 3, 4);
+    int block = audio_telemetry_one_of(cie[1], 7, 4);
+    int sub = audio_telemetry_one_of(cie[1], 3, 2);
+    int alloc = audio_telemetry_one_of(cie[1], 1, 2);
+    uint32_t ch;
+    uint32_t frame_len;
+
+    memset(sbc, 0, sizeof(audio_telemetry_sbc_t));
+    if (rate < 0 || mode < 0 || block < 0 || sub < 0 || alloc < 0 || cie[2] > cie[3]) {
+        return false;
+    }
+    sbc->sample_rate = rates[rate];
+    sbc->mode = (uint8_t)mode;
+    sbc->block_len = blocks[block];
+    sbc->subbands = (sub == 0) ? 4 : 8;
+    sbc->loudness = (alloc == 1);
+    sbc->bitpool_min = cie[2];
+    sbc->bitpool_max = cie[3];
+
+    ch = (mode == AUDIO_TELEMETRY_SBC_MONO) ? 1 : 2;
+    frame_len = 4 + (4 * sbc->subbands * ch) / 8;
+    if (mode == AUDIO_TELEMETRY_SBC_MONO || mode == AUDIO_TELEMETRY_SBC_DUAL) {
+        frame_len += (sbc->block_len * ch * sbc->bitpool_max + 7) / 8;
+    } else {
+        uint32_t join = (mode == AUDIO_TELEMETRY_SBC_JOINT) ? sbc->subbands : 0;
+        frame_len += (join + sbc->block_len * sbc->bitpool_max + 7) / 8;
+    }
+    sbc->bitrate_max = (uint32_t)((uint64_t)8 * frame_len * sbc->sample_rate / (sbc->subbands * sbc->block_len));
+    return true;
+}
+
+// 取快照
+void audio_telemetry_snapshot(audio_telemetry_t *tm, int64_t now_us, audio_telemetry_snapshot_t *snap)
+{
+    uint32_t packed = atomic_load(&tm->sbc_cie);
+    uint8_t cie[4] = { packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff, packed >> 24 };
+
+    snap->time_us = now_us;
+    snap->packets_in = atomic_load_explicit(&tm->packets_in, memory_order_relaxed);
+    snap->bytes_in = atomic_load_explicit(&tm->bytes_in, memory_order_relaxed);
+    snap->packets_dropped = atomic_load_explicit(&tm->packets_dropped, memory_order_relaxed);
+    snap->bytes_dropped = atomic_load_explicit(&tm->bytes_dropped, memory_order_relaxed);
+    snap->drop_runs = atomic_load_explicit(&tm->drop_runs, memory_order_relaxed);
+    snap->prefetches = atomic_load_explicit(&tm->prefetches, memory_order_relaxed);
+    snap->jitter_us = atomic_load_explicit(&tm->jitter_us, memory_order_relaxed);
+    snap->arrival_max_us = atomic_load_explicit(&tm->arrival_max_us, memory_order_relaxed);
+    audio_telemetry_copy(tm->fill_hist, snap->fill_hist, AUDIO_TELEMETRY_FILL_BINS);
+    audio_telemetry_copy(tm->arrival_hist, snap->arrival_hist, AUDIO_TELEMETRY_TIME_BINS);
+    snap->blocks_out = atomic_load_explicit(&tm->blocks_out, memory_order_relaxed);
+    snap->bytes_out = atomic_load_explicit(&tm->bytes_out, memory_order_relaxed);
+    snap->underflows = atomic_load_explicit(&tm->underflows, memory_order_relaxed);
+    snap->write_max_us = atomic_load_explicit(&tm->write_max_us, memory_order_relaxed);
+    audio_telemetry_copy(tm->write_hist, snap->write_hist, AUDIO_TELEMETRY_TIME_BINS);
+    audio_telemetry_decode_sbc(cie, &snap->sbc);
+}
+
+// 取出并清零本窗口的最大值
+void audio_telemetry_take_window_max(audio_telemetry_t *tm, uint32_t *arrival_max_us, uint32_t *write_max_us)
+{
+    *arrival_max_us = atomic_exchange_explicit(&tm->arrival_window_us, 0, memory_order_relaxed);
+    *write_max_us = atomic_exchange_explicit(&tm->write_window_us, 0, memory_order_relaxed);
+}
+
+// 两次快照之差
+void audio_telemetry_delta(const audio_telemetry_snapshot_t *now, const audio_telemetry_snapshot_t *prev,
+                           audio_telemetry_snapshot_t *delta)
+{
+    *delta = *now;
+    delta->time_us = now->time_us - prev->time_us;
+    delta->packets_in -= prev->packets_in;
+    delta->bytes_in -= prev->bytes_in;
+    delta->packets_dropped -= prev->packets_dropped;
+    delta->bytes_dropped -= prev->bytes_dropped;
+    delta->drop_runs -= prev->drop_runs;
+    delta->prefetches -= prev->prefetches;
+    delta->blocks_out -= prev->blocks_out;
+    delta->bytes_out -= prev->bytes_out;
+    delta->underflows -= prev->underflows;
+    for (int i = 0; i < AUDIO_TELEMETRY_FILL_BINS; i++) {
+        delta->fill_hist[i] -= prev->fill_hist[i];
+    }
+    for (int i = 0; i < AUDIO_TELEMETRY_TIME_BINS; i++) {
+        delta->arrival_hist[i] -= prev->arrival_hist[i];
+        delta->write_hist[i] -= prev->write_hist[i];
+    }
+}
+
+// SBC声道模式名称
+const char *audio_telemetry_sbc_mode_name(uint8_t mode)
+{
+    static const char *names[] = { "mono", "dual channel", "stereo", "joint stereo" };
+
+    return (mode < sizeof(names) / sizeof(names[0])) ? names[mode] : "unknown";
+}
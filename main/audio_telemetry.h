@@ -0,0 +1,199 @@
+#ifndef __AUDIO_TELEMETRY_H__
+#define __AUDIO_TELEMETRY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* bins of the fill histogram, equal shares of the ring */
+#define AUDIO_TELEMETRY_FILL_BINS   (8)
+/* bins of the time histograms: below one unit, then one per power of two, the last one open */
+#define AUDIO_TELEMETRY_TIME_BINS   (10)
+/* width of the first time bin, the last bin starts at 2^(TIME_BINS - 2) units (64 ms) */
+#define AUDIO_TELEMETRY_TIME_UNIT_US    (250)
+
+/* SBC channel modes, in the bit order of the codec information element */
+typedef enum {
+    AUDIO_TELEMETRY_SBC_MONO,
+    AUDIO_TELEMETRY_SBC_DUAL,
+    AUDIO_TELEMETRY_SBC_STEREO,
+    AUDIO_TELEMETRY_SBC_JOINT,
+} audio_telemetry_sbc_mode_t;
+
+/* negotiated SBC parameters, decoded from the four octets of `mcc.cie.sbc[]` */
+typedef struct {
+    uint32_t sample_rate;       /*!< Hz, 0 before the codec is configured */    // 采样率
+    uint8_t  mode;              /*!< audio_telemetry_sbc_mode_t */              // 声道模式
+    uint8_t  block_len;         /*!< 4, 8, 12 or 16 */                          // 块长度
+    uint8_t  subbands;          /*!< 4 or 8 */                                  // 子带数
+    bool     loudness;          /*!< loudness allocation, SNR otherwise */      // 比特分配方式
+    uint8_t  bitpool_min;       /*!< lowest bitpool the source may use */       // 最小比特池
+    uint8_t  bitpool_max;       /*!< highest bitpool the source may use */      // 最大比特池
+    uint32_t bitrate_max;       /*!< bit/s at the highest bitpool */            // 最大比特池对应的码率
+} audio_telemetry_sbc_t;
+
+/* a copy of the counters, all totals since boot */
+typedef struct {
+    int64_t  time_us;                               /*!< when the copy was taken */         // 快照时间
+    uint32_t packets_in;                            /*!< packets handed to the ring */      // 收到的数据包
+    uint32_t bytes_in;                                                                      // 收到的字节数
+    uint32_t packets_dropped;                       /*!< packets refused above high water */   // 丢弃的数据包
+    uint32_t bytes_dropped;                                                                 // 丢弃的字节数
+    uint32_t drop_runs;                             /*!< entries into dropping */           // 进入丢弃模式的次数
+    uint32_t prefetches;                            /*!< prefetches completed */            // 预取完成次数
+    uint32_t jitter_us;                             /*!< inter-arrival jitter (RFC 3550) */ // 到达抖动
+    uint32_t arrival_max_us;                        /*!< longest gap between packets, since boot */     // 开机以来最长到达间隔
+    uint32_t blocks_out;                            /*!< writes or DMA refills */           // 输出的块数
+    uint32_t bytes_out;                             /*!< 16-bit PCM handed to the sink */   // 输出的字节数
+    uint32_t underflows;                            /*!< ring ran dry */                    // 欠载次数
+    uint32_t write_max_us;                          /*!< slowest output write, since boot */            // 开机以来最长输出耗时
+    uint32_t fill_hist[AUDIO_TELEMETRY_FILL_BINS];  /*!< ring fill at packet arrival */     // 数据包到达时的水位分布
+    uint32_t arrival_hist[AUDIO_TELEMETRY_TIME_BINS];   /*!< gap between packets */         // 到达间隔分布
+    uint32_t write_hist[AUDIO_TELEMETRY_TIME_BINS];     /*!< output write time */           // 输出耗时分布
+    audio_telemetry_sbc_t sbc;                      /*!< negotiated codec */                // 协商的编码参数
+} audio_telemetry_snapshot_t;
+
+/**
+ * 音频路径遥测计数
+ *
+ * 代替热路径上的日志：BT任务（生产者）和输出路径（I2S任务或DMA回调）各自只写属于自己的计数，
+ * 每个计数只有一个写入方，用宽松原子操作累加，不加锁、不等待，可在DMA回调中调用。
+ * 计数从开机起单调累加（32位，回绕后差值仍然正确），读取方取两次快照之差得到一段时间内的统计，
+ * 任意任务都可随时取快照（显示、控制台、日志），互不影响；每个计数单独是精确的，
+ * 不同计数之间最多相差快照期间正在进行的一个数据包或一个块。
+ * 最长值不能相减，快照中是开机以来的最长值；定期报告另外用 audio_telemetry_take_window_max 取出并清零本窗口的最长值。
+ * 时间分布按 2 的幂分档，水位分布按环形缓冲区容量等分。编码参数以原始的四个字节原子保存，快照时解码。
+ * 静态定义时给出容量即可使用，其余字段为零。
+ */
+typedef struct {
+    /* written by the configuration path only */
+    size_t           capacity;          /*!< ring capacity in bytes */                    // 环形缓冲区容量
+
+    /* written by the producer only */
+    int64_t          last_arrival_us;   /*!< arrival time of the previous packet */       // 上一个包到达时间
+    _Atomic uint32_t packets_in;
+    _Atomic uint32_t bytes_in;
+    _Atomic uint32_t packets_dropped;
+    _Atomic uint32_t bytes_dropped;
+    _Atomic uint32_t drop_runs;
+    _Atomic uint32_t prefetches;
+    _Atomic uint32_t jitter_us;
+    _Atomic uint32_t arrival_max_us;
+    _Atomic uint32_t arrival_window_us; /*!< longest gap since the reporter took it */    // 本窗口最长到达间隔
+    _Atomic uint32_t fill_hist[AUDIO_TELEMETRY_FILL_BINS];
+    _Atomic uint32_t arrival_hist[AUDIO_TELEMETRY_TIME_BINS];
+
+    /* written by the output path only; in the pipeline the worker counts underflows */
+    _Atomic uint32_t blocks_out;
+    _Atomic uint32_t bytes_out;
+    _Atomic uint32_t underflows;
+    _Atomic uint32_t write_max_us;
+    _Atomic uint32_t write_window_us;   /*!< slowest write since the reporter took it */  // 本窗口最长输出耗时
+    _Atomic uint32_t write_hist[AUDIO_TELEMETRY_TIME_BINS];
+
+    /* written by the control path */
+    _Atomic uint32_t sbc_cie;           /*!< `mcc.cie.sbc[0..3]`, little endian */        // 编码参数原始字节
+} audio_telemetry_t;
+
+/**
+ * @brief  生产者：记录一个数据包的到达（写入之前，丢弃的包也记录）
+ *
+ * @param [in] tm         遥测计数
+ * @param [in] fill       到达时的水位（字节）
+ * @param [in] jitter_us  当前的到达抖动估计
+ * @param [in] now_us     到达时间（微秒）
+ */
+void audio_telemetry_on_arrival(audio_telemetry_t *tm, size_t fill, uint32_t jitter_us, int64_t now_us);
+
+/**
+ * @brief  生产者：记录写入或丢弃的数据包
+ *
+ * @param [in] tm       遥测计数
+ * @param [in] len      数据包长度（字节）
+ * @param [in] written  是否写入了ringbuffer
+ */
+static inline void audio_telemetry_on_packet(audio_telemetry_t *tm, size_t len, bool written)
+{
+    if (written) {
+        atomic_fetch_add_explicit(&tm->packets_in, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&tm->bytes_in, (uint32_t)len, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&tm->packets_dropped, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&tm->bytes_dropped, (uint32_t)len, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief  记录一次计数事件（进入丢弃模式、预取完成、欠载），由该计数的写入方调用
+ *
+ * @param [in] counter  tm->drop_runs、tm->prefetches 或 tm->underflows
+ */
+static inline void audio_telemetry_count(_Atomic uint32_t *counter)
+{
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief  输出路径：记录一次写入（推模式为一次阻塞写，拉模式为一次DMA描述符填充）
+ *
+ * @param [in] tm        遥测计数
+ * @param [in] bytes     交给输出设备的16位PCM字节数
+ * @param [in] write_us  写入耗时（微秒）
+ */
+void audio_telemetry_on_output(audio_telemetry_t *tm, size_t bytes, uint32_t write_us);
+
+/**
+ * @brief  控制路径：保存协商的SBC参数
+ *
+ * @param [in] tm   遥测计数
+ * @param [in] cie  `mcc.cie.sbc` 的四个字节
+ */
+void audio_telemetry_set_sbc(audio_telemetry_t *tm, const uint8_t cie[4]);
+
+/**
+ * @brief  解码SBC参数，并按最大比特池计算码率
+ *
+ * @param [in]  cie  `mcc.cie.sbc` 的四个字节
+ * @param [out] sbc  解码结果
+ *
+ * @return  false if an octet does not select exactly one option（参数无效）
+ */
+bool audio_telemetry_decode_sbc(const uint8_t cie[4], audio_telemetry_sbc_t *sbc);
+
+/**
+ * @brief  取快照（任意任务中调用，不影响写入方）
+ *
+ * @param [in]  tm      遥测计数
+ * @param [in]  now_us  当前时间（微秒）
+ * @param [out] snap    快照
+ */
+void audio_telemetry_snapshot(audio_telemetry_t *tm, int64_t now_us, audio_telemetry_snapshot_t *snap);
+
+/**
+ * @brief  取出本窗口的最长到达间隔和最长输出耗时并清零（只由一个定期报告方调用）
+ *
+ * @param [in]  tm              遥测计数
+ * @param [out] arrival_max_us  上次取出以来的最长到达间隔
+ * @param [out] write_max_us    上次取出以来的最长输出耗时
+ */
+void audio_telemetry_take_window_max(audio_telemetry_t *tm, uint32_t *arrival_max_us, uint32_t *write_max_us);
+
+/**
+ * @brief  两次快照之差（分布逐档相减），time_us 为经过的时间，最长值（开机以来）和抖动取新快照的值
+ *
+ * @param [in]  now    新快照
+ * @param [in]  prev   旧快照
+ * @param [out] delta  差值
+ */
+void audio_telemetry_delta(const audio_telemetry_snapshot_t *now, const audio_telemetry_snapshot_t *prev,
+                           audio_telemetry_snapshot_t *delta);
+
+/**
+ * @brief  SBC声道模式名称
+ *
+ * @param [in] mode  audio_telemetry_sbc_mode_t
+ */
+const char *audio_telemetry_sbc_mode_name(uint8_t mode);
+
+#endif /* __AUDIO_TELEMETRY_H__ */
@@ -0,0 +1,141 @@
+#include <string.h>
+#include "audio_vbass.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 清空滤波器状态
+static void audio_vbass_clear(audio_vbass_t *vb)
+{
+    memset(vb->lp_state, 0, sizeof(vb->lp_state));
+    memset(vb->hb_state, 0, sizeof(vb->hb_state));
+    memset(vb->hp_state, 0, sizeof(vb->hp_state));
+}
+
+// 处理链适配
+static void audio_vbass_stage_process(void *ctx, int16_t *pcm, size_t frames, uint8_t ch_count)
+{
+    audio_vbass_process((audio_vbass_t *)ctx, pcm, frames);
+}
+
+static void audio_vbass_stage_configure(void *ctx, uint32_t sample_rate, uint8_t ch_count)
+{
+    audio_vbass_configure((audio_vbass_t *)ctx, sample_rate, ch_count);
+}
+
+static bool audio_vbass_stage_bypassed(void *ctx)
+{
+    return !audio_vbass_active((const audio_vbass_t *)ctx);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void audio_vbass_init(audio_vbass_t *vb, uint16_t cutoff_hz, uint16_t gain_pct, bool enabled)
+{
+    vb->cutoff_hz = cutoff_hz;
+    vb->gain = gain_pct * AUDIO_VBASS_GAIN_UNITY / 100;
+    atomic_init(&vb->enabled, enabled);
+    vb->mix = enabled ? AUDIO_VBASS_MIX_UNITY : 0;
+    audio_vbass_configure(vb, 44100, 2);
+}
+
+// 按采样率重新设计
+void audio_vbass_configure(audio_vbass_t *vb, uint32_t sample_rate, uint8_t ch_count)
+{
+    /* Butterworth sections; two in cascade give the 4th order split of the sub band */
+    audio_eq_design_section(&vb->lp[0], AUDIO_EQ_LOW_PASS, vb->cutoff_hz, 0, 71, sample_rate, 1.0);
+    audio_eq_design_section(&vb->lp[1], AUDIO_EQ_LOW_PASS, vb->cutoff_hz, 0, 71, sample_rate, 1.0);
+    audio_eq_design_section(&vb->hb[0], AUDIO_EQ_HIGH_PASS, vb->cutoff_hz, 0, 71, sample_rate, 1.0);
+    audio_eq_design_section(&vb->hb[1], AUDIO_EQ_LOW_PASS, vb->cutoff_hz * AUDIO_VBASS_HARMONIC_SPAN, 0, 71,
+                            sample_rate, 1.0);
+    audio_eq_design_section(&vb->hp, AUDIO_EQ_HIGH_PASS, vb->cutoff_hz, 0, 71, sample_rate, 1.0);
+    vb->ch_count = (ch_count > AUDIO_VBASS_MAX_CH) ? AUDIO_VBASS_MAX_CH : ch_count;
+    audio_vbass_clear(vb);
+}
+
+// A/B 开关
+void audio_vbass_set_enabled(audio_vbass_t *vb, bool enabled)
+{
+    atomic_store(&vb->enabled, enabled);
+}
+
+// 块处理
+void audio_vbass_process(audio_vbass_t *vb, int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = vb->ch_count;
+    int32_t target = atomic_load(&vb->enabled) ? AUDIO_VBASS_MIX_UNITY : 0;
+    /* 15 extra fraction bits over the Q15 mix, so the crossfade lands on the target */
+    int32_t acc = vb->mix << 15;
+    int32_t step;
+
+    if (frames == 0 || (target == 0 && vb->mix == 0)) {
+        return;
+    }
+    // 从直通打开时，滤波器状态已经过时
+    if (vb->mix == 0) {
+        audio_vbass_clear(vb);
+    }
+    step = (int32_t)(((int64_t)(target - vb->mix) * 32768) / (int32_t)frames);
+
+    while (frames > 0) {
+        size_t n = (frames > AUDIO_VBASS_BLOCK_FRAMES) ? AUDIO_VBASS_BLOCK_FRAMES : frames;
+
+        // 展宽到 AUDIO_EQ_STATE_SHIFT 位小数，同时求声道平均
+        for (size_t i = 0; i < n; i++) {
+            int32_t sum = 0;
+            for (int c = 0; c < ch; c++) {
+                vb->work[c][i] = pcm[i * ch + c] * (1 << AUDIO_EQ_STATE_SHIFT);
+                sum += pcm[i * ch + c];
+            }
+            vb->lo[i] = (ch == 2) ? sum * (1 << (AUDIO_EQ_STATE_SHIFT - 1)) : sum * (1 << AUDIO_EQ_STATE_SHIFT);
+        }
+
+        // 低频段 -> 全波整流 -> 谐波带通
+        audio_eq_section(&vb->lp[0], &vb->lp_state[0], vb->lo, n, 1);
+        audio_eq_section(&vb->lp[1], &vb->lp_state[1], vb->lo, n, 1);
+        for (size_t i = 0; i < n; i++) {
+            vb->lo[i] = (vb->lo[i] < 0) ? -vb->lo[i] : vb->lo[i];
+        }
+        audio_eq_section(&vb->hb[0], &vb->hb_state[0], vb->lo, n, 1);
+        audio_eq_section(&vb->hb[1], &vb->hb_state[1], vb->lo, n, 1);
+        for (int c = 0; c < ch; c++) {
+            audio_eq_section(&vb->hp, &vb->hp_state[c], vb->work[c], n, 1);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            int32_t h = (int32_t)(((int64_t)vb->lo[i] * vb->gain) >> 12);
+            acc += step;
+            int32_t m = acc >> 15;
+            for (int c = 0; c < ch; c++) {
+                int32_t x = pcm[i * ch + c] * (1 << AUDIO_EQ_STATE_SHIFT);
+                int32_t y = vb->work[c][i] + h;
+                if (m != AUDIO_VBASS_MIX_UNITY) {
+                    y = x + (int32_t)(((int64_t)(y - x) * m) >> 15);
+                }
+                y = (y + (1 << (AUDIO_EQ_STATE_SHIFT - 1))) >> AUDIO_EQ_STATE_SHIFT;
+                if (y > INT16_MAX) {
+                    y = INT16_MAX;
+                } else if (y < INT16_MIN) {
+                    y = INT16_MIN;
+                }
+                pcm[i * ch + c] = (int16_t)y;
+            }
+        }
+
+        pcm += n * ch;
+        frames -= n;
+    }
+    vb->mix = target;
+}
+
+// 处理链中的一级
+const audio_chain_stage_desc_t audio_vbass_stage = {
+    .name = "vbass",
+    .process = audio_vbass_stage_process,
+    .configure = audio_vbass_stage_configure,
+    .bypassed = audio_vbass_stage_bypassed,
+};
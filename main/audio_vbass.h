@@ -0,0 +1,98 @@
+#ifndef __AUDIO_VBASS_H__
+#define __AUDIO_VBASS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "audio_eq.h"
+
+/* maximum channels */
+#define AUDIO_VBASS_MAX_CH          (2)
+/* frames filtered per pass of the block kernel */
+#define AUDIO_VBASS_BLOCK_FRAMES    (256)
+/* harmonics are kept up to this multiple of the cutoff */
+#define AUDIO_VBASS_HARMONIC_SPAN   (4)
+/* unity harmonic gain, Q12 */
+#define AUDIO_VBASS_GAIN_UNITY      (4096)
+/* unity wet/dry mix, Q15 */
+#define AUDIO_VBASS_MIX_UNITY       (32768)
+
+/**
+ * 心理声学低音增强（虚拟低音）
+ *
+ * 小喇叭放不出截止频率以下的低音，用均衡提升只会白白消耗功放电流。这里把截止频率以下的频段从输出中滤除，
+ * 改为输出它的谐波：声道和经四阶低通取出低频段，全波整流产生偶次谐波（幅度与输入成正比），
+ * 再带通到截止频率的 1~4 倍后按增益加回各声道；主通路经二阶高通去掉喇叭放不出的部分。
+ * 听觉会从谐波推断出基频（缺失基频效应），低音感仍在而能量大幅减少。
+ * 全部为定点块处理，与均衡器共用双二阶内核；截止频率相关的系数只在采样率变化时重新计算。
+ * 运行时可开关（A/B 对比），切换时在一个块内交叉淡化，关闭后不再消耗CPU。
+ */
+typedef struct {
+    audio_eq_coef_t     lp[2];              /*!< sub band of the mono sum, 4th order */     // 低频段提取（四阶低通）
+    audio_eq_coef_t     hb[2];              /*!< harmonic band: high pass, low pass */      // 谐波带通
+    audio_eq_coef_t     hp;                 /*!< main path high pass */                     // 主通路高通
+    audio_eq_state_t    lp_state[2];        /*!< filter history */                          // 滤波器状态
+    audio_eq_state_t    hb_state[2];
+    audio_eq_state_t    hp_state[AUDIO_VBASS_MAX_CH];
+    int32_t             lo[AUDIO_VBASS_BLOCK_FRAMES];   /*!< sub band, then harmonics */     // 低频段/谐波
+    int32_t             work[AUDIO_VBASS_MAX_CH][AUDIO_VBASS_BLOCK_FRAMES];   /*!< main path */  // 主通路
+    uint8_t             ch_count;           /*!< channels of the stream */                  // 声道数
+    uint16_t            cutoff_hz;          /*!< lowest frequency the speaker plays */      // 截止频率
+    int32_t             gain;               /*!< harmonic gain, Q12 */                      // 谐波增益
+    atomic_bool         enabled;            /*!< A/B switch, written by the control path */ // 开关
+    int32_t             mix;                /*!< wet share reached at the end of the last block, Q15 */   // 当前湿声比例
+} audio_vbass_t;
+
+/**
+ * @brief  初始化
+ *
+ * @param [out] vb         虚拟低音
+ * @param [in]  cutoff_hz  截止频率
+ * @param [in]  gain_pct   谐波增益（百分比）
+ * @param [in]  enabled    初始开关
+ */
+void audio_vbass_init(audio_vbass_t *vb, uint16_t cutoff_hz, uint16_t gain_pct, bool enabled);
+
+/**
+ * @brief  按采样率和声道数重新设计滤波器并清空状态（输出停止时调用）
+ *
+ * @param [in] vb           虚拟低音
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void audio_vbass_configure(audio_vbass_t *vb, uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  A/B 开关，可在任意任务中调用，下一块生效
+ *
+ * @param [in] vb       虚拟低音
+ * @param [in] enabled  是否打开
+ */
+void audio_vbass_set_enabled(audio_vbass_t *vb, bool enabled);
+
+/**
+ * @brief  是否需要处理（打开，或关闭后的淡出尚未完成）
+ *
+ * @param [in] vb  虚拟低音
+ */
+static inline bool audio_vbass_active(const audio_vbass_t *vb)
+{
+    return atomic_load(&vb->enabled) || vb->mix != 0;
+}
+
+/**
+ * @brief  对一个PCM块原地处理
+ *
+ * @param [in]     vb      虚拟低音
+ * @param [in,out] pcm     16位交织PCM
+ * @param [in]     frames  帧数
+ */
+void audio_vbass_process(audio_vbass_t *vb, int16_t *pcm, size_t frames);
+
+/**
+ * 处理链中的虚拟低音级，ctx 为 audio_vbass_t，关闭且淡出完成后跳过
+ */
+extern const audio_chain_stage_desc_t audio_vbass_stage;
+
+#endif /* __AUDIO_VBASS_H__ */
@@ -4,9 +4,15 @@
 #include <string.h>
 #include <inttypes.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
 
 #include "bt_app_core.h"
 #include "bt_app_av.h"
+#include "track_meta.h"
+#include "peer_list.h"
+#include "link_power.h"
+#include "myuart.h"
 #include "esp_bt_main.h"
 #include "esp_bt_device.h"
 #include "esp_gap_bt_api.h"
@@ -16,12 +22,6 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC     // 选择DAC输出（这里不用）
-#include "driver/dac_continuous.h"
-#else
-#include "driver/i2s_std.h"
-#endif
-
 #include "sys/lock.h"
 
 /* AVRCP used transaction labels */         // AVRCP的事务标签定义
@@ -31,8 +31,39 @@
 #define APP_RC_CT_TL_RN_PLAYBACK_CHANGE  (3)
 #define APP_RC_CT_TL_RN_PLAY_POS_CHANGE  (4)
 
-/* Application layer causes delay value */  // 应用层导致的延迟
-#define APP_DELAY_VALUE                  50  // 5ms
+/* player application setting selecting the EQ preset, from the range left to extensions */
+#define APP_PS_EQ_PRESET                 (0x80)
+/* player application setting switching the virtual bass, values as the Equalizer setting */
+#define APP_PS_VBASS                     (0x81)
+
+/* a measured delay this far from the reported one is reported again, 1/10 ms */
+#define APP_DELAY_THRESHOLD              (100)  // 10ms
+/* shortest interval between two delay reports */
+#define APP_DELAY_INTERVAL_US            (2 * 1000 * 1000)
+
+/* metadata attributes shown on the display */
+#define APP_META_ATTR_MASK               (ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST | \
+                                          ESP_AVRC_MD_ATTR_ALBUM | ESP_AVRC_MD_ATTR_GENRE)
+/* attributes still missing this long after the request are shown empty */
+#define APP_META_WAIT_US                 (500 * 1000)
+
+/* recent sources in NVS */
+#define APP_PEER_NVS_NAMESPACE           "bt_sink"
+#define APP_PEER_NVS_KEY                 "peers"
+/* wait before the second attempt at a source, doubled for each further one */
+#define APP_RECONNECT_BACKOFF_US         (1000 * 1000)
+/* an attempt the stack has not answered by then counts as failed */
+#define APP_RECONNECT_GUARD_US           (15 * 1000 * 1000)
+/* bonded devices read at once, the stack keeps up to 15 link keys */
+#define APP_BOND_MAX                     (16)
+
+/* steps of a handoff to another source */
+#define APP_HANDOFF_IDLE                 (0)
+#define APP_HANDOFF_TEARDOWN             (1)    /* waiting for the active source to disconnect */
+#define APP_HANDOFF_CONNECTING           (2)    /* connecting to the new source */
+
+/* poll interval asked for while the audio stays suspended, slots of 0.625 ms (1 s) */
+#define APP_TPOLL_SLOW                   (0x0640)
 
 /*******************************
  * STATIC FUNCTION DECLARATIONS
@@ -42,6 +73,10 @@
 
 /* allocate new meta buffer */
 static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param);    // 分配新的元数据缓冲区
+/* allocate new player application setting buffer */
+static void bt_app_alloc_app_value_buffer(esp_avrc_tg_cb_param_t *param);   // 分配新的播放器设置缓冲区
+/* handler for player application settings */
+static void bt_av_app_value_set(uint8_t num_val, const esp_avrc_set_app_value_param_t *p_vals);   // 播放器设置处理函数
 /* handler for new track is loaded */
 static void bt_av_new_track(void);      // 新track装载的处理函数
 /* handler for track status change */
@@ -50,10 +85,6 @@ static void bt_av_playback_changed(void);       // track状态转换的处理函
 static void bt_av_play_pos_changed(void);       // track播放位置变换的处理函数
 /* notification event handler */
 static void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *event_parameter);   // 通知事件处理函数
-/* installation for i2s */
-static void bt_i2s_driver_install(void);        // I2S驱动安装
-/* uninstallation for i2s */
-static void bt_i2s_driver_uninstall(void);      // I2S驱动卸载
 /* set volume by remote controller */
 static void volume_set_by_controller(uint8_t volume);   // 远程控制器进行音量设置
 /* set volume by local host */
@@ -66,6 +97,34 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param);   // A2DP事件处
 static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param);   // AVRC控制器事件处理函数
 /* avrc target event handler */
 static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param);   // AVRC目标事件处理函数
+/* delay report update */
+static void bt_av_delay_update(uint16_t event, void *p_param);      // 延迟上报更新
+/* display field of an AVRCP metadata attribute */
+static track_meta_field_t bt_av_meta_field(uint8_t attr_id);        // 元数据属性对应的字段
+/* wait for missing attributes ended */
+static void bt_av_meta_timeout(void *arg);                          // 元数据等待超时
+/* push the collected metadata to the display */
+static void bt_av_meta_push(uint16_t event, void *p_param);         // 元数据发送到屏幕
+/* remember a connected source */
+static void bt_av_peer_connected(const uint8_t *bda);               // 记录连接的音源
+/* whether a device is bonded */
+static bool bt_av_is_bonded(const uint8_t *bda);                    // 是否已配对
+/* another source opened a link while one is connected */
+static void bt_av_handoff_request(uint16_t event, void *p_param);   // 连接期间另一个音源建立了链路
+/* connection state change during a handoff */
+static void bt_av_handoff_state(esp_a2d_connection_state_t state, const uint8_t *bda);  // 切换期间的连接状态变化
+/* apply the link power policy and arm the timer */
+static void bt_av_link_apply(void);                                 // 应用链路功耗设置
+/* link power timeout, application task */
+static void bt_av_link_tick(uint16_t event, void *p_param);         // 链路功耗超时
+/* link mode changed, application task */
+static void bt_av_link_mode(uint16_t event, void *p_param);         // 链路模式变化
+/* discoverable again on request, application task */
+static void bt_av_link_discover(uint16_t event, void *p_param);     // 重新可被发现
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+/* next reconnect attempt, application task */
+static void bt_av_reconnect_step(uint16_t event, void *p_param);    // 下一次重连尝试
+#endif
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
@@ -84,12 +143,30 @@ static _lock_t s_volume_lock;
 static TaskHandle_t s_vcs_task_hdl = NULL;    /* handle for volume change simulation task */    // 模拟音量变化任务
 static uint8_t s_volume = 0;                 /* local volume value */       // 本地主机音量
 static bool s_volume_notify;                 /* notify volume change or not */      // 通知音量是否改变
-
-// 选择输出方式的处理函数
-#ifndef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-i2s_chan_handle_t tx_chan = NULL;
-#else
-dac_continuous_handle_t tx_chan;
+static esp_bd_addr_t s_peer_bda = {0};       /* address of the connected A2DP source */    // 已连接音源的地址
+static bool s_delay_rpt = false;             /* source takes delay reports */              // 音源支持延迟上报
+static uint16_t s_delay_stack = 0;           /* stack default, 0 until it is read */       // 协议栈默认延迟
+static uint16_t s_delay_reported = 0;        /* last reported delay, 1/10 ms */            // 最近一次上报的延迟
+static int64_t s_delay_report_us = 0;        /* time of the last report */                 // 最近一次上报时间
+static track_meta_t s_track_meta;            /* shown and incoming track metadata */       // 曲目元数据
+static esp_timer_handle_t s_meta_timer = NULL;   /* ends the wait for missing attributes */  // 元数据等待定时器
+static const char *const s_meta_obj[TRACK_META_FIELDS] = { "title", "artist", "album", "genre" };   // 屏幕控件名
+static esp_a2d_connection_state_t s_conn_state = ESP_A2D_CONNECTION_STATE_DISCONNECTED;   /* A2DP link state */   // A2DP连接状态
+static bool s_boot_connected = false;        /* first connection since boot logged */    // 开机后的第一次连接已记录
+static peer_list_t s_peers;                  /* recent bonded sources, most recent first */   // 最近连接过的已配对音源
+static uint8_t s_handoff_step = APP_HANDOFF_IDLE;    /* handoff in progress */          // 切换音源的进度
+static esp_bd_addr_t s_handoff_from = {0};   /* source being replaced */                 // 被替换的音源
+static esp_bd_addr_t s_handoff_to = {0};     /* source taking over */                    // 接替的音源
+static link_power_t s_link_power;            /* link power state machine */              // 链路功耗管理
+static link_power_policy_t s_link_policy;    /* settings applied to the stack */         // 已应用的无线设置
+static uint8_t s_link_state = LINK_POWER_STATES;     /* state last applied */           // 上一次应用的状态
+static esp_timer_handle_t s_link_timer = NULL;   /* timeouts and connectable windows */  // 链路功耗定时器
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+static esp_timer_handle_t s_reconnect_timer = NULL;   /* backoff and attempt guard */   // 重连定时器
+static bool s_reconnecting = false;          /* boot reconnect in progress */            // 正在重连
+static uint8_t s_reconnect_peer = 0;         /* source being tried */                    // 正在尝试的音源
+static uint8_t s_reconnect_try = 0;          /* attempts at that source */               // 对该音源的尝试次数
+static uint16_t s_reconnect_total = 0;       /* attempts since boot */                   // 开机后的尝试次数
 #endif
 
 /********************************
@@ -98,31 +175,113 @@ dac_continuous_handle_t tx_chan;
 
 // 分配新的元数据缓冲区
 // 元数据是关于数据的数据，用于描述音频文件的属性和特征（作家等信息）
+// 从消息池取槽位，过长的文本在UTF-8字符边界截断
 static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param)
 {
     // 传参
     esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(param);
+    int len = rc->meta_rsp.attr_length;
     // 分配内存
-    uint8_t *attr_text = (uint8_t *) malloc (rc->meta_rsp.attr_length + 1);
-    // 复制数据
-    memcpy(attr_text, rc->meta_rsp.attr_text, rc->meta_rsp.attr_length);
-    // 设置终止字符
-    attr_text[rc->meta_rsp.attr_length] = 0;
+    uint8_t *attr_text;
+
+    if (len > BT_APP_BLOB_SIZE - 1) {
+        len = BT_APP_BLOB_SIZE - 1;
+        while (len > 0 && (rc->meta_rsp.attr_text[len] & 0xc0) == 0x80) {
+            len--;
+        }
+    }
+    if ((attr_text = (uint8_t *)bt_app_pool_alloc(len + 1)) == NULL) {
+        len = 0;
+    } else {
+        // 复制数据
+        memcpy(attr_text, rc->meta_rsp.attr_text, len);
+        // 设置终止字符
+        attr_text[len] = 0;
+    }
     // 更新指针
     rc->meta_rsp.attr_text = attr_text;
+    rc->meta_rsp.attr_length = len;
+}
+
+// 分配新的播放器设置缓冲区
+// 回调返回后协议栈会释放设置值数组，派发前先复制一份
+static void bt_app_alloc_app_value_buffer(esp_avrc_tg_cb_param_t *param)
+{
+    esp_avrc_tg_cb_param_t *rc = (esp_avrc_tg_cb_param_t *)(param);
+    size_t len = rc->set_app_value.num_val * sizeof(esp_avrc_set_app_value_param_t);
+    esp_avrc_set_app_value_param_t *p_vals = (esp_avrc_set_app_value_param_t *)bt_app_pool_alloc(len);
+
+    if (p_vals == NULL) {
+        rc->set_app_value.num_val = 0;
+    } else {
+        memcpy(p_vals, rc->set_app_value.p_vals, len);
+    }
+    rc->set_app_value.p_vals = p_vals;
+}
+
+// AVRCP属性对应的字段，不显示的属性返回 TRACK_META_FIELDS
+static track_meta_field_t bt_av_meta_field(uint8_t attr_id)
+{
+    switch (attr_id) {
+    case ESP_AVRC_MD_ATTR_TITLE:
+        return TRACK_META_TITLE;
+    case ESP_AVRC_MD_ATTR_ARTIST:
+        return TRACK_META_ARTIST;
+    case ESP_AVRC_MD_ATTR_ALBUM:
+        return TRACK_META_ALBUM;
+    case ESP_AVRC_MD_ATTR_GENRE:
+        return TRACK_META_GENRE;
+    default:
+        return TRACK_META_FIELDS;
+    }
+}
+
+// 等待超时（esp_timer任务中），交给应用任务提交已收到的属性
+static void bt_av_meta_timeout(void *arg)
+{
+    bt_app_work_dispatch_prio(bt_av_meta_push, 0, NULL, 0, NULL, BT_APP_PRIO_LOW, BT_APP_COALESCE_NONE);
+}
+
+// 提交收集到的属性，只把变化的字段发送到屏幕（应用任务中运行）
+static void bt_av_meta_push(uint16_t event, void *p_param)
+{
+    uint8_t changed = track_meta_commit(&s_track_meta);
+
+    if (changed == 0) {
+        return;
+    }
+    for (int f = 0; f < TRACK_META_FIELDS; f++) {
+        if (changed & (1 << f)) {
+            uart_send_txt(s_meta_obj[f], track_meta_get(&s_track_meta, f));
+        }
+    }
+    ESP_LOGI(BT_RC_CT_TAG, "track: %s - %s (%s, %s), changed 0x%x", track_meta_get(&s_track_meta, TRACK_META_TITLE),
+             track_meta_get(&s_track_meta, TRACK_META_ARTIST), track_meta_get(&s_track_meta, TRACK_META_ALBUM),
+             track_meta_get(&s_track_meta, TRACK_META_GENRE), changed);
 }
 
 // 新track装载的处理函数
 static void bt_av_new_track(void)
 {
     /* request metadata */  //请求元数据（歌曲标题、艺术家、专辑和流派）
-    uint8_t attr_mask = ESP_AVRC_MD_ATTR_TITLE |
-                        ESP_AVRC_MD_ATTR_ARTIST |
-                        ESP_AVRC_MD_ATTR_ALBUM |
-                        ESP_AVRC_MD_ATTR_GENRE;
+    uint8_t attr_mask = APP_META_ATTR_MASK;
     // 发送请求命令函数
     esp_avrc_ct_send_metadata_cmd(APP_RC_CT_TL_GET_META_DATA, attr_mask);
 
+    // 开始收集新曲目的属性，音源不提供的属性等待超时后显示为空
+    track_meta_begin(&s_track_meta, (1 << TRACK_META_FIELDS) - 1);
+    if (s_meta_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = bt_av_meta_timeout,
+            .name = "meta_wait",
+        };
+        esp_timer_create(&args, &s_meta_timer);
+    }
+    if (s_meta_timer != NULL) {
+        esp_timer_stop(s_meta_timer);
+        esp_timer_start_once(s_meta_timer, APP_META_WAIT_US);
+    }
+
     /* register notification if peer support the event_id */    // 注册通知
     // 检查对端设备是否支持特定的通知事件
     if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST, &s_avrc_peer_rn_cap,
@@ -168,6 +327,8 @@ static void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *even
     /* when new track is loaded, this event comes */
     // 加载新曲目
     case ESP_AVRC_RN_TRACK_CHANGE:
+        // 新曲目重新测量响度
+        bt_i2s_loudness_reset();
         bt_av_new_track();
         break;
     /* when track status changed, this event comes */
@@ -190,62 +351,29 @@ static void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *even
     }
 }
 
-// I2S驱动安装
-void bt_i2s_driver_install(void)
+// 播放器设置处理函数
+// 均衡器开关使用标准的 Equalizer 设置，预设使用扩展设置 APP_PS_EQ_PRESET（取值为预设序号加一）
+// 虚拟低音开关使用扩展设置 APP_PS_VBASS，取值与 Equalizer 相同
+static void bt_av_app_value_set(uint8_t num_val, const esp_avrc_set_app_value_param_t *p_vals)
 {
-// 选择DAC输出（不用）
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-    dac_continuous_config_t cont_cfg = {
-        .chan_mask = DAC_CHANNEL_MASK_ALL,
-        .desc_num = 8,
-        .buf_size = 2048,
-        .freq_hz = 44100,
-        .offset = 127,
-        .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,   // Using APLL as clock source to get a wider frequency range
-        .chan_mode = DAC_CHANNEL_MODE_ALTER,
-    };
-    /* Allocate continuous channels */
-    ESP_ERROR_CHECK(dac_continuous_new_channels(&cont_cfg, &tx_chan));
-    /* Enable the continuous channels */
-    ESP_ERROR_CHECK(dac_continuous_enable(tx_chan));
-#else   // I2S输出
-    // 初始化配置
-    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    chan_cfg.auto_clear = true;
-    // 设置I2S配置
-    i2s_std_config_t std_cfg = {
-        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(44100),
-        .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
-        .gpio_cfg = {
-            .mclk = I2S_GPIO_UNUSED,
-            .bclk = CONFIG_EXAMPLE_I2S_BCK_PIN,
-            .ws = CONFIG_EXAMPLE_I2S_LRCK_PIN,
-            .dout = CONFIG_EXAMPLE_I2S_DATA_PIN,
-            .din = I2S_GPIO_UNUSED,
-            .invert_flags = {
-                .mclk_inv = false,
-                .bclk_inv = false,
-                .ws_inv = false,
-            },
-        },
-    };
-    /* enable I2S */
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_chan, NULL));
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_chan, &std_cfg));
-    ESP_ERROR_CHECK(i2s_channel_enable(tx_chan));
-#endif
-}
-
-// I2S驱动卸载
-void bt_i2s_driver_uninstall(void)
-{
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-    ESP_ERROR_CHECK(dac_continuous_disable(tx_chan));
-    ESP_ERROR_CHECK(dac_continuous_del_channels(tx_chan));
-#else
-    ESP_ERROR_CHECK(i2s_channel_disable(tx_chan));
-    ESP_ERROR_CHECK(i2s_del_channel(tx_chan));
-#endif
+    for (int i = 0; i < num_val; i++) {
+        ESP_LOGI(BT_RC_TG_TAG, "AVRC set player app value: attribute 0x%x, value 0x%x", p_vals[i].attr_id, p_vals[i].attr_val);
+        switch (p_vals[i].attr_id) {
+        case ESP_AVRC_PS_EQUALIZER:
+            bt_i2s_set_eq_enabled(p_vals[i].attr_val == ESP_AVRC_PS_EQUALIZER_ON);
+            break;
+        case APP_PS_VBASS:
+            bt_i2s_set_vbass_enabled(p_vals[i].attr_val == ESP_AVRC_PS_EQUALIZER_ON);
+            break;
+        case APP_PS_EQ_PRESET:
+            if (p_vals[i].attr_val == 0 || !bt_i2s_set_eq_preset(p_vals[i].attr_val - 1)) {
+                ESP_LOGW(BT_RC_TG_TAG, "unknown EQ preset value 0x%x", p_vals[i].attr_val);
+            }
+            break;
+        default:
+            break;
+        }
+    }
 }
 
 // 远程控制器进行音量设置
@@ -257,6 +385,8 @@ static void volume_set_by_controller(uint8_t volume)
     _lock_acquire(&s_volume_lock);
     s_volume = volume;
     _lock_release(&s_volume_lock);
+    // 音量交给I2S任务的增益引擎
+    bt_i2s_set_volume(volume);
 }
 
 // 本地主机进行音量设置
@@ -268,6 +398,7 @@ static void volume_set_by_local_host(uint8_t volume)
     _lock_acquire(&s_volume_lock);
     s_volume = volume;
     _lock_release(&s_volume_lock);
+    bt_i2s_set_volume(volume);
 
     /* send notification response to remote AVRCP controller */     // 发送通知给ARVCP控制器
     if (s_volume_notify) {
@@ -291,6 +422,342 @@ static void volume_change_simulation(void *arg)
     }
 }
 
+// 按实际缓冲状态更新上报给音源的延迟（应用任务中运行）
+// 变化超过门限且距上次上报足够久才重新上报，避免音源不停地调整音画同步
+static void bt_av_delay_update(uint16_t event, void *p_param)
+{
+    uint32_t measured = s_delay_stack + bt_i2s_get_delay_us() / 100;
+    uint32_t diff;
+    int64_t now_us = esp_timer_get_time();
+
+    // 先限幅再比较，否则超出上报范围的测量值每次都被当成变化
+    if (measured > UINT16_MAX) {
+        measured = UINT16_MAX;
+    }
+    diff = (measured > s_delay_reported) ? measured - s_delay_reported : s_delay_reported - measured;
+    ESP_LOGI(BT_AV_TAG, "delay: measured %"PRIu32".%"PRIu32" ms, reported %u.%u ms",
+             measured / 10, measured % 10, s_delay_reported / 10, s_delay_reported % 10);
+    // 协议栈默认值读取之前不上报
+    if (!s_delay_rpt || s_delay_stack == 0 || diff < APP_DELAY_THRESHOLD ||
+        now_us - s_delay_report_us < APP_DELAY_INTERVAL_US) {
+        return;
+    }
+    if (esp_a2d_sink_set_delay_value((uint16_t)measured) == ESP_OK) {
+        s_delay_reported = (uint16_t)measured;
+        s_delay_report_us = now_us;
+    }
+}
+
+// 读取最近连接过的音源
+static void bt_av_peers_load(void)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(peer_list_t);
+
+    peer_list_clear(&s_peers);
+    if (nvs_open(APP_PEER_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_blob(nvs, APP_PEER_NVS_KEY, &s_peers, &len) != ESP_OK || len != sizeof(peer_list_t) ||
+        !peer_list_valid(&s_peers)) {
+        peer_list_clear(&s_peers);
+    }
+    nvs_close(nvs);
+}
+
+// 保存最近连接过的音源，只在顺序变化时调用，减少闪存写入
+static void bt_av_peers_save(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err;
+
+    if ((err = nvs_open(APP_PEER_NVS_NAMESPACE, NVS_READWRITE, &nvs)) != ESP_OK) {
+        ESP_LOGW(BT_AV_TAG, "recent sources not saved: %s", esp_err_to_name(err));
+        return;
+    }
+    if ((err = nvs_set_blob(nvs, APP_PEER_NVS_KEY, &s_peers, sizeof(peer_list_t))) == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(BT_AV_TAG, "recent sources not saved: %s", esp_err_to_name(err));
+    }
+    nvs_close(nvs);
+}
+
+// 去掉已取消配对的音源，补上没有连接记录的已配对设备
+static void bt_av_peers_sync_bonds(void)
+{
+    esp_bd_addr_t bonded[APP_BOND_MAX];
+    int count = APP_BOND_MAX;
+
+    if (esp_bt_gap_get_bond_device_list(&count, bonded) != ESP_OK) {
+        return;
+    }
+    if (peer_list_sync_bonds(&s_peers, (const uint8_t (*)[PEER_ADDR_LEN])bonded, count)) {
+        bt_av_peers_save();
+    }
+}
+
+// 是否已配对
+static bool bt_av_is_bonded(const uint8_t *bda)
+{
+    esp_bd_addr_t bonded[APP_BOND_MAX];
+    int count = APP_BOND_MAX;
+
+    if (esp_bt_gap_get_bond_device_list(&count, bonded) != ESP_OK) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (memcmp(bonded[i], bda, ESP_BD_ADDR_LEN) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+// 定时器到期（esp_timer任务中），交给应用任务
+static void bt_av_reconnect_timeout(void *arg)
+{
+    bt_app_work_dispatch(bt_av_reconnect_step, 0, NULL, 0, NULL);
+}
+
+// 重新设置定时器
+static void bt_av_reconnect_arm(uint64_t delay_us)
+{
+    if (s_reconnect_timer != NULL) {
+        esp_timer_stop(s_reconnect_timer);
+        esp_timer_start_once(s_reconnect_timer, delay_us);
+    }
+}
+
+// 结束重连
+static void bt_av_reconnect_stop(void)
+{
+    s_reconnecting = false;
+    if (s_reconnect_timer != NULL) {
+        esp_timer_stop(s_reconnect_timer);
+    }
+}
+
+// 下一次重连尝试：每个音源最多尝试 RECONNECT_TRIES 次，之后换下一个，全部失败后等待手机连接
+static void bt_av_reconnect_step(uint16_t event, void *p_param)
+{
+    uint8_t *bda;
+
+    if (!s_reconnecting) {
+        return;
+    }
+    // 已经连上（可能是手机主动连接），或者协议栈还在寻呼
+    if (s_conn_state == ESP_A2D_CONNECTION_STATE_CONNECTED) {
+        bt_av_reconnect_stop();
+        return;
+    }
+    if (s_conn_state != ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
+        bt_av_reconnect_arm(APP_RECONNECT_GUARD_US);
+        return;
+    }
+    if (s_reconnect_try >= CONFIG_EXAMPLE_A2DP_SINK_RECONNECT_TRIES) {
+        s_reconnect_peer++;
+        s_reconnect_try = 0;
+    }
+    if (s_reconnect_peer >= s_peers.count) {
+        ESP_LOGI(BT_AV_TAG, "reconnect: no source answered after %u attempts, waiting to be connected", s_reconnect_total);
+        bt_av_reconnect_stop();
+        return;
+    }
+
+    bda = s_peers.addr[s_reconnect_peer];
+    s_reconnect_try++;
+    s_reconnect_total++;
+    ESP_LOGI(BT_AV_TAG, "reconnect: [%02x:%02x:%02x:%02x:%02x:%02x] attempt %u of %d", bda[0], bda[1], bda[2], bda[3],
+             bda[4], bda[5], s_reconnect_try, CONFIG_EXAMPLE_A2DP_SINK_RECONNECT_TRIES);
+    // 结果由连接状态事件给出，协议栈没有回应时由定时器兜底
+    bt_av_reconnect_arm((esp_a2d_sink_connect(bda) == ESP_OK) ? APP_RECONNECT_GUARD_US : APP_RECONNECT_BACKOFF_US);
+}
+
+// 一次尝试失败，按次数加倍等待后再试
+static void bt_av_reconnect_failed(void)
+{
+    if (s_reconnecting) {
+        bt_av_reconnect_arm((uint64_t)APP_RECONNECT_BACKOFF_US << ((s_reconnect_try > 0) ? s_reconnect_try - 1 : 0));
+    }
+}
+#endif
+
+// 记录连接的音源，开机后的第一次连接输出开机到连接的耗时
+static void bt_av_peer_connected(const uint8_t *bda)
+{
+    if (!s_boot_connected) {
+        s_boot_connected = true;
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+        ESP_LOGI(BT_AV_TAG, "boot to connected: %"PRId64" ms, %u reconnect attempts", esp_timer_get_time() / 1000,
+                 s_reconnect_total);
+#else
+        ESP_LOGI(BT_AV_TAG, "boot to connected: %"PRId64" ms", esp_timer_get_time() / 1000);
+#endif
+    }
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+    bt_av_reconnect_stop();
+#endif
+    if (peer_list_touch(&s_peers, bda)) {
+        bt_av_peers_save();
+    }
+}
+
+// 连接期间另一个音源建立了链路（应用任务中）：只有已配对的音源可以接替，按配置抢占或拒绝
+static void bt_av_handoff_request(uint16_t event, void *p_param)
+{
+    uint8_t *bda = (uint8_t *)p_param;
+    uint8_t *active = s_peer_bda;
+
+    if (s_conn_state != ESP_A2D_CONNECTION_STATE_CONNECTED || s_handoff_step != APP_HANDOFF_IDLE ||
+        memcmp(bda, active, ESP_BD_ADDR_LEN) == 0) {
+        return;
+    }
+    if (!bt_av_is_bonded(bda)) {
+        ESP_LOGI(BT_AV_TAG, "handoff: [%02x:%02x:%02x:%02x:%02x:%02x] is not bonded, ignored",
+                 bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+        return;
+    }
+#if CONFIG_EXAMPLE_A2DP_SINK_HANDOFF_REJECT
+    ESP_LOGI(BT_AV_TAG, "handoff: [%02x:%02x:%02x:%02x:%02x:%02x] rejected, [%02x:%02x:%02x:%02x:%02x:%02x] keeps the sink",
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+             active[0], active[1], active[2], active[3], active[4], active[5]);
+#else
+    ESP_LOGI(BT_AV_TAG, "handoff: [%02x:%02x:%02x:%02x:%02x:%02x] preempts [%02x:%02x:%02x:%02x:%02x:%02x]",
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+             active[0], active[1], active[2], active[3], active[4], active[5]);
+    memcpy(s_handoff_from, active, ESP_BD_ADDR_LEN);
+    memcpy(s_handoff_to, bda, ESP_BD_ADDR_LEN);
+    if (esp_a2d_sink_disconnect(s_handoff_from) != ESP_OK) {
+        ESP_LOGW(BT_AV_TAG, "handoff: disconnect failed, active source kept");
+        return;
+    }
+    // 淡出并丢弃当前音源的数据，断开后再连接新音源
+    s_handoff_step = APP_HANDOFF_TEARDOWN;
+    bt_i2s_handoff_begin();
+#endif
+}
+
+// 切换期间的连接状态变化
+static void bt_av_handoff_state(esp_a2d_connection_state_t state, const uint8_t *bda)
+{
+    bool to = (memcmp(bda, s_handoff_to, ESP_BD_ADDR_LEN) == 0);
+
+    switch (s_handoff_step) {
+    case APP_HANDOFF_TEARDOWN:
+        // 上一个音源已断开，连接新音源
+        if (state == ESP_A2D_CONNECTION_STATE_DISCONNECTED && memcmp(bda, s_handoff_from, ESP_BD_ADDR_LEN) == 0) {
+            s_handoff_step = APP_HANDOFF_CONNECTING;
+            if (esp_a2d_sink_connect(s_handoff_to) != ESP_OK) {
+                to = true;
+                break;
+            }
+        }
+        return;
+    case APP_HANDOFF_CONNECTING:
+        // 连上的也可能是手机自己重连的上一个音源，切换都到此结束
+        if (state == ESP_A2D_CONNECTION_STATE_CONNECTED) {
+            s_handoff_step = APP_HANDOFF_IDLE;
+            return;
+        }
+        if (state == ESP_A2D_CONNECTION_STATE_DISCONNECTED && to) {
+            break;
+        }
+        return;
+    default:
+        return;
+    }
+
+    // 新音源没有连上，退回被替换的音源
+    bda = s_handoff_to;
+    ESP_LOGW(BT_AV_TAG, "handoff: [%02x:%02x:%02x:%02x:%02x:%02x] did not connect, back to the previous source",
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+    s_handoff_step = APP_HANDOFF_IDLE;
+    esp_a2d_sink_connect(s_handoff_from);
+}
+
+// 输出各状态的累计时间
+static void bt_av_link_report(uint8_t from, int64_t now_us)
+{
+    link_power_stats_t st;
+
+    link_power_get_stats(&s_link_power, now_us, &st);
+    ESP_LOGI(BT_AV_TAG, "link power: %s -> %s, time in discoverable %"PRIu32" s, windowed %"PRIu32" s, streaming %"PRIu32" s, "
+             "paused %"PRIu32" s, slow poll %"PRIu32" s, sniff %"PRIu32" s (%"PRIu32" times)",
+             link_power_state_name(from), link_power_state_name(s_link_power.state),
+             st.time_ms[LINK_POWER_DISCOVERABLE] / 1000, st.time_ms[LINK_POWER_WINDOWED] / 1000,
+             st.time_ms[LINK_POWER_STREAMING] / 1000, st.time_ms[LINK_POWER_PAUSED] / 1000,
+             st.time_ms[LINK_POWER_SLOW_POLL] / 1000, st.sniff_ms / 1000, st.sniffs);
+}
+
+// 应用链路功耗设置，只把变化的部分交给协议栈，并按下一次超时或可连接窗口边沿设置定时器
+static void bt_av_link_apply(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool first = (s_link_state == LINK_POWER_STATES);   /* nothing applied since the start */
+    link_power_policy_t policy;
+    uint32_t next_ms;
+
+    link_power_update(&s_link_power, now_us, &policy);
+    if (s_link_power.state != s_link_state) {
+        if (!first) {
+            bt_av_link_report(s_link_state, now_us);
+        }
+        s_link_state = s_link_power.state;
+    }
+    if (first || policy.connectable != s_link_policy.connectable || policy.discoverable != s_link_policy.discoverable) {
+        esp_bt_gap_set_scan_mode(policy.connectable ? ESP_BT_CONNECTABLE : ESP_BT_NON_CONNECTABLE,
+                                 policy.discoverable ? ESP_BT_GENERAL_DISCOVERABLE : ESP_BT_NON_DISCOVERABLE);
+    }
+    /* the window is made by switching the scan mode, the stack has no slower page scan to select */
+    // 暂停的链路请求更长的轮询间隔，恢复播放时改回默认值；是否进入sniff由协议栈决定
+    if (policy.slow_poll != s_link_policy.slow_poll && s_conn_state == ESP_A2D_CONNECTION_STATE_CONNECTED) {
+        esp_bt_gap_set_qos(s_peer_bda, policy.slow_poll ? APP_TPOLL_SLOW : ESP_BT_GAP_TPOLL_DFT);
+    }
+    s_link_policy = policy;
+
+    if (s_link_timer != NULL) {
+        esp_timer_stop(s_link_timer);
+        if ((next_ms = link_power_next_ms(&s_link_power, now_us)) != 0) {
+            esp_timer_start_once(s_link_timer, (uint64_t)next_ms * 1000);
+        }
+    }
+}
+
+// 定时器到期（esp_timer任务中），交给应用任务
+static void bt_av_link_timeout(void *arg)
+{
+    bt_app_work_dispatch_prio(bt_av_link_tick, 0, NULL, 0, NULL, BT_APP_PRIO_LOW, BT_APP_COALESCE_NONE);
+}
+
+// 链路功耗超时
+static void bt_av_link_tick(uint16_t event, void *p_param)
+{
+    bt_av_link_apply();
+}
+
+// 链路模式变化，只用于统计
+static void bt_av_link_mode(uint16_t event, void *p_param)
+{
+    uint8_t mode = *(uint8_t *)p_param;
+
+    ESP_LOGD(BT_AV_TAG, "link mode: %u", mode);
+    link_power_on_sniff(&s_link_power, mode == ESP_BT_PM_MD_SNIFF, esp_timer_get_time());
+}
+
+// 重新开始可被发现的时段
+static void bt_av_link_discover(uint16_t event, void *p_param)
+{
+    if (!link_power_make_discoverable(&s_link_power, esp_timer_get_time())) {
+        ESP_LOGI(BT_AV_TAG, "link power: connected, not discoverable");
+        return;
+    }
+    ESP_LOGI(BT_AV_TAG, "link power: discoverable for %u s", CONFIG_EXAMPLE_A2DP_SINK_DISCOVERABLE_S);
+    bt_av_link_apply();
+}
+
 // A2DP事件处理函数
 static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
 {
@@ -309,21 +776,33 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         uint8_t *bda = a2d->conn_stat.remote_bda;
         ESP_LOGI(BT_AV_TAG, "A2DP connection state: %s, [%02x:%02x:%02x:%02x:%02x:%02x]",
             s_a2d_conn_state_str[a2d->conn_stat.state], bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+        s_conn_state = a2d->conn_stat.state;
+        bt_av_handoff_state(a2d->conn_stat.state, bda);
+        if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED ||
+            a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
+            // 扫描模式由链路功耗管理决定：断开后先可被发现，连接期间不可被发现（允许抢占时仍可被连接）
+            link_power_on_connection(&s_link_power, a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED,
+                                     esp_timer_get_time());
+            bt_av_link_apply();
+        }
 
-        // 断开连接状态下，设置为可被发现，卸载I2S驱动和任务
+        // 断开连接状态下，输出设备和I2S任务保持运行，剩余数据放完后淡出，下一次连接直接复用
         if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
-            esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);
-            bt_i2s_driver_uninstall();
-            bt_i2s_task_shut_down();
+            bt_i2s_stream_state(false);
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+            // 开机重连中，这次尝试没有连上
+            bt_av_reconnect_failed();
+#endif
         } 
-        // 连接状态下，设置为不可被发现，启动I2S任务
+        // 连接状态下，启动I2S任务（重新连接时复用）
         else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED){
-            esp_bt_gap_set_scan_mode(ESP_BT_NON_CONNECTABLE, ESP_BT_NON_DISCOVERABLE);
+            memcpy(s_peer_bda, bda, ESP_BD_ADDR_LEN);
             bt_i2s_task_start_up();
+            bt_av_peer_connected(bda);
         } 
-        // 正在连接状态，安装I2S驱动
+        // 正在连接状态，安装输出设备（已安装时保持不变）
         else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTING) {
-            bt_i2s_driver_install();
+            bt_i2s_output_install();
         }
         break;
     }
@@ -337,6 +816,11 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         if (ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state) {
             s_pkt_cnt = 0;      // 重置包计数器
         }
+        // 停止时缓冲区耗尽后淡出，开始时第一个块淡入
+        bt_i2s_stream_state(ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state);
+        // 暂停一段时间后链路进入低功耗，恢复时立即退出
+        link_power_on_audio(&s_link_power, ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state, esp_timer_get_time());
+        bt_av_link_apply();
         break;
     }
     /* when audio codec is configured, this event comes */
@@ -349,6 +833,7 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         if (a2d->audio_cfg.mcc.type == ESP_A2D_MCT_SBC) {
             int sample_rate = 16000;        // 采样率
             int ch_count = 2;       // 声道数
+            audio_telemetry_sbc_t sbc;
             char oct0 = a2d->audio_cfg.mcc.cie.sbc[0];
             if (oct0 & (0x01 << 6)) {
                 sample_rate = 32000;
@@ -361,37 +846,22 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
             if (oct0 & (0x01 << 3)) {
                 ch_count = 1;
             }
-        #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-            dac_continuous_disable(tx_chan);
-            dac_continuous_del_channels(tx_chan);
-            dac_continuous_config_t cont_cfg = {
-                .chan_mask = DAC_CHANNEL_MASK_ALL,
-                .desc_num = 8,
-                .buf_size = 2048,
-                .freq_hz = sample_rate,
-                .offset = 127,
-                .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,   // Using APLL as clock source to get a wider frequency range
-                .chan_mode = (ch_count == 1) ? DAC_CHANNEL_MODE_SIMUL : DAC_CHANNEL_MODE_ALTER,
-            };
-            /* Allocate continuous channels */
-            dac_continuous_new_channels(&cont_cfg, &tx_chan);
-            /* Enable the continuous channels */
-            dac_continuous_enable(tx_chan);
-        #else   // I2S输出
-            // 配置并且启用I2S通道
-            i2s_channel_disable(tx_chan);
-            i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
-            i2s_std_slot_config_t slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, ch_count);
-            i2s_channel_reconfig_std_clock(tx_chan, &clk_cfg);
-            i2s_channel_reconfig_std_slot(tx_chan, &slot_cfg);
-            i2s_channel_enable(tx_chan);
-        #endif
-            // 日志输出配置信息
+            // 重配置前先淡出，避免输出被突然切断
+            bt_i2s_fade_out();
+            // 按新的采样率和声道数重配置输出设备和抖动缓冲目标
+            bt_i2s_audio_config(sample_rate, ch_count);
+            // 日志输出配置信息，解码后的参数进入遥测快照
             ESP_LOGI(BT_AV_TAG, "Configure audio player: %x-%x-%x-%x",
                      a2d->audio_cfg.mcc.cie.sbc[0],
                      a2d->audio_cfg.mcc.cie.sbc[1],
                      a2d->audio_cfg.mcc.cie.sbc[2],
                      a2d->audio_cfg.mcc.cie.sbc[3]);
+            bt_i2s_set_sbc_info(a2d->audio_cfg.mcc.cie.sbc);
+            if (audio_telemetry_decode_sbc(a2d->audio_cfg.mcc.cie.sbc, &sbc)) {
+                ESP_LOGI(BT_AV_TAG, "SBC: %s, %u blocks, %u subbands, %s allocation, bitpool %u..%u (up to %"PRIu32" kbit/s)",
+                         audio_telemetry_sbc_mode_name(sbc.mode), sbc.block_len, sbc.subbands,
+                         sbc.loudness ? "loudness" : "SNR", sbc.bitpool_min, sbc.bitpool_max, sbc.bitrate_max / 1000);
+            }
             ESP_LOGI(BT_AV_TAG, "Audio player configured, sample rate: %d", sample_rate);
         }
         break;
@@ -412,7 +882,8 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
     case ESP_A2D_SNK_PSC_CFG_EVT: {
         a2d = (esp_a2d_cb_param_t *)(p_param);
         ESP_LOGI(BT_AV_TAG, "protocol service capabilities configured: 0x%x ", a2d->a2d_psc_cfg_stat.psc_mask);
-        if (a2d->a2d_psc_cfg_stat.psc_mask & ESP_A2D_PSC_DELAY_RPT) {
+        s_delay_rpt = (a2d->a2d_psc_cfg_stat.psc_mask & ESP_A2D_PSC_DELAY_RPT) != 0;
+        if (s_delay_rpt) {
             ESP_LOGI(BT_AV_TAG, "Peer device support delay reporting");
         } else {
             ESP_LOGI(BT_AV_TAG, "Peer device unsupport delay reporting");
@@ -435,8 +906,12 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
     case ESP_A2D_SNK_GET_DELAY_VALUE_EVT: {
         a2d = (esp_a2d_cb_param_t *)(p_param);
         ESP_LOGI(BT_AV_TAG, "Get delay report value: delay_value: %u * 1/10 ms", a2d->a2d_get_delay_value_stat.delay_value);
-        /* Default delay value plus delay caused by application layer */
-        esp_a2d_sink_set_delay_value(a2d->a2d_get_delay_value_stat.delay_value + APP_DELAY_VALUE);
+        /* default delay value plus the delay of the application layer, measured from then on */
+        uint32_t delay = a2d->a2d_get_delay_value_stat.delay_value + bt_i2s_get_delay_us() / 100;
+        s_delay_stack = a2d->a2d_get_delay_value_stat.delay_value;
+        s_delay_reported = (delay > UINT16_MAX) ? UINT16_MAX : (uint16_t)delay;
+        s_delay_report_us = esp_timer_get_time();
+        esp_a2d_sink_set_delay_value(s_delay_reported);
         break;
     }
     /* others */
@@ -485,9 +960,21 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
     // 元数据响应事件
     case ESP_AVRC_CT_METADATA_RSP_EVT: {
         // 记录元数据的属性ID和文本内容
-        ESP_LOGI(BT_RC_CT_TAG, "AVRC metadata rsp: attribute id 0x%x, %s", rc->meta_rsp.attr_id, rc->meta_rsp.attr_text);
-        // 释放元数据文本的内存
-        free(rc->meta_rsp.attr_text);
+        if (rc->meta_rsp.attr_text == NULL) {
+            ESP_LOGW(BT_RC_CT_TAG, "AVRC metadata rsp: attribute id 0x%x dropped, message pool empty", rc->meta_rsp.attr_id);
+            break;
+        }
+        ESP_LOGD(BT_RC_CT_TAG, "AVRC metadata rsp: attribute id 0x%x, %s", rc->meta_rsp.attr_id, rc->meta_rsp.attr_text);
+        // 属性写入元数据记录，全部收到后立即发送到屏幕，不再等待超时
+        if (track_meta_set(&s_track_meta, bt_av_meta_field(rc->meta_rsp.attr_id), (const char *)rc->meta_rsp.attr_text,
+                           rc->meta_rsp.attr_length)) {
+            if (s_meta_timer != NULL) {
+                esp_timer_stop(s_meta_timer);
+            }
+            bt_av_meta_push(0, NULL);
+        }
+        // 元数据文本的槽位归还到池中
+        bt_app_pool_free(rc->meta_rsp.attr_text);
         break;
     }
     /* when notified, this event comes */
@@ -590,6 +1077,13 @@ static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param)
         ESP_LOGI(BT_RC_TG_TAG, "AVRC remote features: %"PRIx32", CT features: %x", rc->rmt_feats.feat_mask, rc->rmt_feats.ct_feat_flag);
         break;
     }
+    /* when player application settings changed by remote device, this event comes */
+    // 播放器设置事件
+    case ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT: {
+        bt_av_app_value_set(rc->set_app_value.num_val, rc->set_app_value.p_vals);
+        bt_app_pool_free(rc->set_app_value.p_vals);
+        break;
+    }
     /* others */
     default:
         ESP_LOGE(BT_RC_TG_TAG, "%s unhandled event: %d", __func__, event);
@@ -601,6 +1095,77 @@ static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param)
  * EXTERNAL FUNCTION DEFINITIONS
  *******************************/
 
+// 整理重连列表，开机重连：依次连接最近连接过的音源，期间仍可被发现和连接
+void bt_av_reconnect_start(void)
+{
+    // 重连列表只保留仍然配对的设备
+    bt_av_peers_load();
+    bt_av_peers_sync_bonds();
+#if CONFIG_EXAMPLE_A2DP_SINK_RECONNECT
+    if (s_peers.count == 0) {
+        ESP_LOGI(BT_AV_TAG, "reconnect: no recent source, waiting to be connected");
+        return;
+    }
+    if (s_reconnect_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = bt_av_reconnect_timeout,
+            .name = "reconnect",
+        };
+        esp_timer_create(&args, &s_reconnect_timer);
+    }
+    ESP_LOGI(BT_AV_TAG, "reconnect: %u recent sources, stack up at %"PRId64" ms", s_peers.count, esp_timer_get_time() / 1000);
+    s_reconnecting = true;
+    s_reconnect_peer = 0;
+    s_reconnect_try = 0;
+    bt_av_reconnect_step(0, NULL);
+#endif
+}
+
+// 开始链路功耗管理，开机时可被发现和连接
+void bt_av_link_power_start(void)
+{
+    const link_power_config_t cfg = {
+        .discoverable_ms = CONFIG_EXAMPLE_A2DP_SINK_DISCOVERABLE_S * 1000,
+        .window_ms = CONFIG_EXAMPLE_A2DP_SINK_CONNECTABLE_WINDOW_MS,
+        .period_ms = CONFIG_EXAMPLE_A2DP_SINK_CONNECTABLE_PERIOD_MS,
+        .slow_poll_ms = CONFIG_EXAMPLE_A2DP_SINK_SLOW_POLL_S * 1000,
+#if CONFIG_EXAMPLE_A2DP_SINK_HANDOFF_REJECT
+        .connectable_connected = false,
+#else
+        .connectable_connected = true,
+#endif
+    };
+
+    if (s_link_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = bt_av_link_timeout,
+            .name = "link_power",
+        };
+        esp_timer_create(&args, &s_link_timer);
+    }
+    link_power_init(&s_link_power, &cfg, esp_timer_get_time());
+    s_link_state = LINK_POWER_STATES;
+    bt_av_link_apply();
+}
+
+// 链路模式变化（GAP回调中），交给应用任务统计
+void bt_av_link_mode_changed(uint8_t mode)
+{
+    bt_app_work_dispatch_prio(bt_av_link_mode, 0, &mode, sizeof(mode), NULL, BT_APP_PRIO_LOW, BT_APP_COALESCE_NONE);
+}
+
+// 重新可被发现（任意任务中），交给应用任务
+void bt_av_link_discoverable(void)
+{
+    bt_app_work_dispatch_prio(bt_av_link_discover, 0, NULL, 0, NULL, BT_APP_PRIO_LOW, BT_APP_COALESCE_NONE);
+}
+
+// 链路建立（GAP回调中），交给应用任务判断是否切换音源
+void bt_av_acl_connected(const uint8_t *bda)
+{
+    bt_app_work_dispatch(bt_av_handoff_request, 0, (void *)bda, ESP_BD_ADDR_LEN, NULL);
+}
+
 /**
  * @brief  A2DP sink回调函数
  *
@@ -640,9 +1205,15 @@ void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len)
     // 将数据写入ringbuffer
     write_ringbuf(data, len);
 
-    /* log the number every 100 packets */  //每100个包进行一次日志打印
+    /* packet and byte counts go to the telemetry, only the periodic link work is left here */
+    // 每100个包读取一次RSSI并更新延迟上报，包数和字节数由遥测计数统计
     if (++s_pkt_cnt % 100 == 0) {
-        ESP_LOGI(BT_AV_TAG, "Audio packet count: %"PRIu32, s_pkt_cnt);
+    #if CONFIG_EXAMPLE_A2DP_SINK_JITTER_RSSI
+        /* the result comes back as ESP_BT_GAP_READ_RSSI_DELTA_EVT */
+        esp_bt_gap_read_rssi_delta(s_peer_bda);
+    #endif
+        // 延迟上报的状态只在应用任务中访问，尚未处理的更新不重复排队
+        bt_app_work_dispatch_prio(bt_av_delay_update, 0, NULL, 0, NULL, BT_APP_PRIO_LOW, BT_APP_COALESCE_DELAY);
     }
 }
 
@@ -664,8 +1235,15 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param
     case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
     case ESP_AVRC_CT_REMOTE_FEATURES_EVT:
     case ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT: {
-        // 如果是以上几种事件，将事件和处理函数派发到应用程序任务的工作队列中
-        bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), NULL);
+        // 如果是以上几种事件，将事件和处理函数派发到应用程序任务的低优先级队列中，播放位置只保留最新的一次
+        bool play_pos = (event == ESP_AVRC_CT_CHANGE_NOTIFY_EVT &&
+                         param->change_ntf.event_id == ESP_AVRC_RN_PLAY_POS_CHANGED);
+        // 没有入队时消息没有带走元数据文本，槽位在这里归还
+        if (!bt_app_work_dispatch_prio(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), NULL,
+                                       BT_APP_PRIO_LOW, play_pos ? BT_APP_COALESCE_PLAY_POS : BT_APP_COALESCE_NONE) &&
+            event == ESP_AVRC_CT_METADATA_RSP_EVT) {
+            bt_app_pool_free(param->meta_rsp.attr_text);
+        }
         break;
     }
     default:
@@ -684,14 +1262,22 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param
 void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event, esp_avrc_tg_cb_param_t *param)
 {
     switch (event) {
+    case ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT:
+        bt_app_alloc_app_value_buffer(param);
+        /* fall through */
     case ESP_AVRC_TG_CONNECTION_STATE_EVT:
     case ESP_AVRC_TG_REMOTE_FEATURES_EVT:
     case ESP_AVRC_TG_PASSTHROUGH_CMD_EVT:
     case ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT:
     case ESP_AVRC_TG_REGISTER_NOTIFICATION_EVT:
-    case ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT:
-        // 如果是以上几种事件，将事件和处理函数派发到应用程序任务的工作队列中
-        bt_app_work_dispatch(bt_av_hdl_avrc_tg_evt, event, param, sizeof(esp_avrc_tg_cb_param_t), NULL);
+        // 如果是以上几种事件，将事件和处理函数派发到应用程序任务的低优先级队列中，绝对音量只保留最新的一次
+        // 没有入队时消息没有带走设置值数组，槽位在这里归还
+        if (!bt_app_work_dispatch_prio(bt_av_hdl_avrc_tg_evt, event, param, sizeof(esp_avrc_tg_cb_param_t), NULL,
+                                       BT_APP_PRIO_LOW, (event == ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT)
+                                                        ? BT_APP_COALESCE_VOLUME : BT_APP_COALESCE_NONE) &&
+            event == ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT) {
+            bt_app_pool_free(param->set_app_value.p_vals);
+        }
         break;
     default:
         ESP_LOGE(BT_RC_TG_TAG, "Invalid AVRC event: %d", event);
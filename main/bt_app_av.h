@@ -42,4 +42,35 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param
  */
 void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event, esp_avrc_tg_cb_param_t *param);
 
+/**
+ * @brief  重连列表只保留仍然配对的音源，并开机重连最近连接过的音源（协议栈启动后在应用任务中调用），
+ *         没有记录或未开启重连时只整理列表
+ */
+void bt_av_reconnect_start(void);
+
+/**
+ * @brief  开始链路功耗管理（协议栈启动后在应用任务中调用），代替直接设置扫描模式：
+ *         断开后一段时间内可被发现，之后按占空比可被连接；连接后音频暂停一段时间请求长轮询间隔
+ */
+void bt_av_link_power_start(void);
+
+/**
+ * @brief  重新开始可被发现的时段，让新的手机可以搜索到（配对按键，可在任意任务中调用），已连接时忽略
+ */
+void bt_av_link_discoverable(void);
+
+/**
+ * @brief  链路模式变化（在GAP回调中调用），用于统计sniff模式的时间
+ *
+ * @param [in] mode  esp_bt_pm_mode_t
+ */
+void bt_av_link_mode_changed(uint8_t mode);
+
+/**
+ * @brief  ACL链路建立（在GAP回调中调用）：连接期间另一个已配对的音源建立链路时按配置切换或拒绝
+ *
+ * @param [in] bda  对端地址
+ */
+void bt_av_acl_connected(const uint8_t *bda);
+
 #endif /* __BT_APP_AV_H__*/
@@ -1,30 +1,139 @@
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <math.h>
 #include "freertos/FreeRTOSConfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_a2dp_api.h"
+#include "esp_avrc_api.h"
 #include "bt_app_core.h"
+#include "pcm_ring.h"
+#include "audio_jitter.h"
+#include "audio_drift.h"
+#include "audio_gain.h"
+#include "audio_plc.h"
+#include "audio_sink.h"
+#include "audio_eq.h"
+#include "audio_limiter.h"
+#include "audio_loudness.h"
+#include "audio_vbass.h"
+#include "audio_spectrum.h"
+#include "audio_arena.h"
+#include "msg_pool.h"
+#include "audio_chain.h"
+#include "cpu_load.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
 
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-#include "driver/dac_continuous.h"
-#else
+#define RINGBUF_HIGHEST_WATER_LEVEL    (32 * 1024)
+/* longest contiguous span handed out by the PCM ring, also bounds one producer write */
+#define RINGBUF_MIRROR_SIZE            (4 * 1024)
+/* frames per I2S write, one DMA descriptor (`dma_frame_num`) */
+#define I2S_BLOCK_FRAMES               (240)
+/* drift statistics are reported every this many blocks (about 5 s at 44.1 kHz) */
+#define I2S_DRIFT_REPORT_BLOCKS        (1000)
+/* task stacks in bytes, carved from the audio arena */
+#define BT_APP_TASK_STACK              (4096)
+#define BT_I2S_TASK_STACK              (4096)
+#define BT_DSP_TASK_STACK              (4096)
+/* messages queued for the application task, per priority class */
+#define BT_APP_HIGH_QUEUE_LEN          (6)
+#define BT_APP_LOW_QUEUE_LEN           (10)
+/* largest callback parameter union dispatched to the application task */
+#define BT_APP_MAX(a, b)               ((a) > (b) ? (a) : (b))
+#define BT_APP_PARAM_SIZE              BT_APP_MAX(sizeof(esp_a2d_cb_param_t), \
+                                           BT_APP_MAX(sizeof(esp_avrc_ct_cb_param_t), sizeof(esp_avrc_tg_cb_param_t)))
+/* parameter copies: full queues, the message being handled, the one being dispatched and the one it supersedes */
+#define BT_APP_PARAM_SLOTS             (BT_APP_HIGH_QUEUE_LEN + BT_APP_LOW_QUEUE_LEN + 3)
+/* variable-length copies, one metadata burst of a new track plus the player settings */
+#define BT_APP_BLOB_SLOTS              (8)
+/* pool and queue statistics reported at most this often, only when they change */
+#define BT_APP_REPORT_US               (5 * 1000 * 1000)
+/* task-to-core map, a negative core leaves the task unpinned */
+#define BT_TASK_CORE(core)             (((core) < 0) ? tskNO_AFFINITY : (core))
+/* period of the telemetry report */
+#define TELEMETRY_REPORT_US            (5 * 1000 * 1000)
+#if CONFIG_EXAMPLE_A2DP_SINK_CORE_LOAD
+/* period of the per-core load report */
+#define CORE_LOAD_REPORT_US            (5 * 1000 * 1000)
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+/* processed PCM queued between the DSP worker and the output, four stereo chain blocks */
+#define PIPE_RING_SIZE                 (4 * 1024)
+/* longest contiguous span of the pipeline ring, one stereo chain block fits */
+#define PIPE_MIRROR_SIZE               (1024)
+/* pipeline statistics are published every this many worker blocks */
+#define PIPE_REPORT_BLOCKS             (1000)
 
-#include "driver/i2s_std.h"
+/* pacing of the DSP worker and the margin left to the output */
+typedef struct {
+    uint32_t blocks;            /*!< blocks processed by the worker */           // 工作任务处理的块数
+    uint32_t interval_min_us;   /*!< shortest time between two blocks */         // 最短块间隔
+    uint32_t interval_max_us;   /*!< longest time between two blocks */          // 最长块间隔
+    uint32_t margin_min;        /*!< least processed bytes queued at an output refill */   // 输出取数时最少的排队字节数
+} bt_pipe_stats_t;
 #endif
-#include "freertos/ringbuf.h"
+/* weight of a new fill sample in the smoothed fill, as a shift */
+#define RING_FILL_AVG_SHIFT            (4)
+/* longest wait for the output to drain what the previous connection left */
+#define I2S_IDLE_WAIT_MS               (500)
+/* a connection starting later than this after a handoff request is not timed as the handoff */
+#define I2S_HANDOFF_MAX_US             (20 * 1000 * 1000)
 
-#define RINGBUF_HIGHEST_WATER_LEVEL    (32 * 1024)
-#define RINGBUF_PREFETCH_WATER_LEVEL   (20 * 1024)
+/* queue statistics of one priority class */
+typedef struct {
+    /* written by the dispatchers */
+    _Atomic uint32_t sent;              /*!< messages queued */                          // 入队的消息
+    _Atomic uint32_t dropped;           /*!< events lost, queue full or no slot */       // 丢失的事件
+    _Atomic uint32_t coalesced;         /*!< events folded into a pending one */         // 被合并的事件
+    /* written by the application task */
+    uint32_t         handled;           /*!< messages handled */                         // 处理的消息
+    uint32_t         depth_max;         /*!< deepest queue seen, this report */          // 本次统计的最大队列深度
+    uint32_t         wait_sum_us;       /*!< queueing latency, this report */            // 本次统计的排队时间之和
+    uint32_t         wait_max_us;       /*!< longest queueing latency, this report */    // 本次统计的最长排队时间
+} bt_app_class_stats_t;
+
+/* stack and control block of a task created from the arena */
+typedef struct {
+    StackType_t      *stack;            /*!< task stack */                               // 任务栈
+    StaticTask_t     *tcb;              /*!< task control block */                       // 任务控制块
+} bt_task_mem_t;
 
-enum {
-    RINGBUFFER_MODE_PROCESSING,    /* ringbuffer is buffering incoming audio data, I2S is working */
-    RINGBUFFER_MODE_PREFETCHING,   /* ringbuffer is buffering incoming audio data, I2S is waiting */
-    RINGBUFFER_MODE_DROPPING       /* ringbuffer is not buffering (dropping) incoming audio data, I2S is working */
-};
+/* time to sound after a connection, times are microseconds since the connection */
+typedef struct {
+    uint32_t         connect_us;        /*!< connection time, low bits of the timer */   // 连接时间
+    uint32_t         packet_us;         /*!< first packet written, 0 before it */        // 第一个数据包写入
+    uint32_t         prefetch_us;       /*!< prefetch done, 0 before it */               // 预取完成
+    _Atomic uint32_t sound_us;          /*!< first sample handed to the output */        // 第一个样本交给输出设备
+    atomic_bool      pending;           /*!< the first sample is still to come */        // 等待第一个样本
+    atomic_bool      ready;             /*!< a timing waits to be logged */              // 待输出
+    bool             warm;              /*!< tasks and buffers were kept from before */  // 复用了之前的任务和缓冲区
+    uint32_t         handoff_us;        /*!< source switch requested, 0 if none */       // 请求切换音源的时间
+} bt_i2s_sound_t;
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+/* descriptor statistics are published every this many DMA descriptors */
+#define I2S_PULL_REPORT_DESCS          (1000)
+/* period of the task-context reporter of the DMA callback statistics */
+#define I2S_PULL_REPORT_PERIOD_US      (1000 * 1000)
+
+/* per-descriptor refill statistics, accumulated in the DMA callback */
+typedef struct {
+    uint32_t descs;             /*!< descriptors refilled */                     // 填充的描述符数
+    uint32_t underruns;         /*!< descriptors that ran out of audio */        // 数据不足的描述符数
+    uint64_t cycles_sum;        /*!< refill cycles, summed */                    // 填充耗时总和（周期）
+    uint32_t cycles_max;        /*!< slowest refill in cycles */                 // 最长填充耗时（周期）
+    uint32_t period_min_us;     /*!< shortest interval between callbacks */      // 最短回调间隔
+    uint32_t period_max_us;     /*!< longest interval between callbacks */       // 最长回调间隔
+} bt_i2s_pull_stats_t;
+#endif
 
 /*******************************
  * STATIC FUNCTION DECLARATIONS
@@ -32,31 +141,115 @@ enum {
 
 /* handler for application task */
 static void bt_app_task_handler(void *arg);             // 应用任务处理函数
+#if !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
 /* handler for I2S task */
 static void bt_i2s_task_handler(void *arg);             // I2S任务处理函数
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+/* handler for the DSP worker task */
+static void bt_dsp_task_handler(void *arg);             // DSP任务处理函数
+#endif
 /* message sender */        
 static bool bt_app_send_msg(bt_app_msg_t *msg);         // 发送信息函数
+/* message receiver, highest class first */
+static bool bt_app_receive_msg(bt_app_msg_t *msg);      // 接收信息函数
 /* handle dispatched messages */
 static void bt_app_work_dispatched(bt_app_msg_t *msg);  // 分发信息函数
+/* pool and queue statistics, application task */
+static void bt_app_report(void);                        // 池和队列统计输出函数
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
  ******************************/
 
-static QueueHandle_t s_bt_app_task_queue = NULL;  /* handle of work queue */        // 工作队列
+static QueueHandle_t s_bt_app_task_queue[BT_APP_PRIO_CLASSES] = { NULL };  /* work queues, highest class first */  // 工作队列
 static TaskHandle_t s_bt_app_task_handle = NULL;  /* handle of application task  */ // 应用任务
 static TaskHandle_t s_bt_i2s_task_handle = NULL;  /* handle of I2S task */          // I2S任务
-static RingbufHandle_t s_ringbuf_i2s = NULL;     /* handle of ringbuffer for I2S */ // I2S ringbuffer
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+static TaskHandle_t s_bt_dsp_task_handle = NULL;  /* handle of DSP worker task */   // DSP任务
+static pcm_ring_t s_pipe_ring;                     /* processed PCM for the output */         // 处理后的PCM
+static uint8_t *s_pipe_storage = NULL;             /* backing storage of the pipeline ring */ // 流水线存储区
+static bt_task_mem_t s_dsp_task_mem;               /* DSP worker stack, from the arena */     // DSP任务栈
+static atomic_bool s_pipe_space_waiting = false;   /* worker waits for the output to drain */ // 工作任务等待空间
+static atomic_bool s_pipe_data_waiting = false;    /* output task waits for the worker */     // 输出任务等待数据
+static _Atomic uint32_t s_pipe_margin_min = UINT32_MAX;   /* lowered by the output */        // 输出侧最少排队字节数
+static bt_pipe_stats_t s_pipe_report;              /* snapshot handed to the reporter */      // 待输出的统计快照
+static atomic_bool s_pipe_report_ready = false;    /* a snapshot waits to be logged */        // 统计待输出
+#endif
+static pcm_ring_t s_ringbuf_i2s;                   /* lock-free PCM ring for I2S */  // I2S ringbuffer
+static uint8_t *s_ringbuf_storage = NULL;          /* backing storage of the PCM ring */   // ringbuffer存储区
+static atomic_bool s_i2s_ring_waiting = false;     /* I2S task waits for the producer */   // I2S任务等待数据标志
+static atomic_bool s_i2s_park_req = false;         /* a reconfiguration holds the output path off the sink */   // 重配置期间让输出路径停下
+static atomic_bool s_i2s_parked = false;           /* the task fed by the prefetch semaphore waits on it */     // 取数任务停在预取信号量上
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE && !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+static atomic_bool s_pipe_out_idle = true;         /* output task waits for processed data without a timeout */ // 输出任务无超时地等待数据
+#endif
+static _Atomic uint32_t s_ring_fill_avg = 0;       /* smoothed fill between packets, bytes */   // 平滑后的ringbuffer水位
+static atomic_bool s_handoff_drop = false;        /* packets of the source being replaced are dropped */   // 丢弃被替换音源的数据包
 static SemaphoreHandle_t s_i2s_write_semaphore = NULL;          // I2S信号量
-static uint16_t ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;   // ringbuffer模式
-
-/*********************************
- * EXTERNAL FUNCTION DECLARATIONS
- ********************************/
-#ifndef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-extern i2s_chan_handle_t tx_chan;
+static StaticSemaphore_t *s_i2s_write_semaphore_cb = NULL;      /* control block, from the arena */   // I2S信号量控制块
+static audio_arena_t s_arena;                      /* audio buffers, stacks and control blocks */   // 音频内存池
+static uint8_t s_arena_internal[CONFIG_EXAMPLE_A2DP_SINK_ARENA_KB * 1024] __attribute__((aligned(AUDIO_ARENA_ALIGN)));   /* reserved at link time */  // 内部RAM区域
+static bt_task_mem_t s_app_task_mem;               /* application task stack */                // 应用任务栈
+static msg_pool_t s_param_pool;                    /* copies of the callback parameter unions */ // 事件参数池
+static msg_pool_t s_blob_pool;                     /* metadata text and other variable copies */ // 变长数据池
+static uint8_t *s_app_queue_storage[BT_APP_PRIO_CLASSES] = { NULL };    /* application queue items */        // 应用队列存储区
+static StaticQueue_t *s_app_queue_cb[BT_APP_PRIO_CLASSES] = { NULL };   /* application queue control blocks */  // 应用队列控制块
+static const uint8_t s_app_queue_len[BT_APP_PRIO_CLASSES] = { BT_APP_HIGH_QUEUE_LEN, BT_APP_LOW_QUEUE_LEN };
+static const char *const s_app_class_name[BT_APP_PRIO_CLASSES] = { "high", "low" };
+static bt_app_class_stats_t s_app_class_stats[BT_APP_PRIO_CLASSES];     /* per class queue statistics */         // 各优先级队列统计
+static _Atomic(void *) s_app_coalesce[BT_APP_COALESCE_KEYS];            /* newest parameters of a pending event */ // 待处理事件的最新参数
+static uint8_t s_app_coalesce_empty;               /* marks a pending event without parameters */ // 无参数事件的占位
+#if !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+static bt_task_mem_t s_i2s_task_mem;               /* I2S task stack */                        // I2S任务栈
+#endif
+static audio_jitter_t s_jitter;                    /* adaptive jitter buffer and ringbuffer mode */  // 抖动缓冲区
+static audio_telemetry_t s_telemetry = { .capacity = RINGBUF_HIGHEST_WATER_LEVEL };   /* counters since boot */   // 遥测计数
+static audio_gain_t s_gain = { .target = AUDIO_GAIN_UNITY, .current = AUDIO_GAIN_UNITY };   /* sink-side volume */  // 音量增益
+static uint32_t s_i2s_sample_rate = 44100;         /* rate of the negotiated stream */             // 采样率
+static uint8_t s_i2s_ch_count = 2;                 /* channels of the negotiated stream */         // 声道数
+static audio_plc_t s_plc;                          /* underflow concealment and fades */           // 丢包隐藏与淡入淡出
+static audio_chain_t s_chain;                      /* in-place processing stages */                 // 音频处理链
+static audio_sink_t s_sink;                        /* output device and conversion kernel */       // 输出设备
+static bool s_sink_installed = false;              /* output driver is installed */                // 输出设备已安装
+static bt_i2s_sound_t s_sound;                     /* time to sound of the current connection */   // 本次连接的出声耗时
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+static const audio_sink_type_t s_sink_type = AUDIO_SINK_DAC;    /* output device, fixed at build time */   // 输出设备类型
 #else
-extern dac_continuous_handle_t tx_chan;
+static const audio_sink_type_t s_sink_type = AUDIO_SINK_I2S;    /* output device, fixed at build time */   // 输出设备类型
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+static audio_loudness_t s_loudness;                /* short-term loudness meter and normaliser */   // 响度表与归一化
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_VBASS
+static audio_vbass_t s_vbass;                      /* psychoacoustic bass */                    // 虚拟低音
+static bool s_vbass_enabled = true;                /* A/B switch, kept across connections */   // 虚拟低音开关
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_EQ
+static audio_eq_t s_eq;                            /* parametric EQ */                          // 参数均衡器
+static audio_eq_preset_t s_eq_preset = CONFIG_EXAMPLE_A2DP_SINK_EQ_PRESET;   /* preset while enabled */   // 开启时使用的预设
+static bool s_eq_enabled = true;                   /* EQ switched on by the player settings */  // 均衡器开关
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+static audio_spectrum_t s_spectrum;                /* analysis tap for the display */           // 频谱显示分析点
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+static audio_limiter_t s_limiter = { .ceiling = AUDIO_LIMITER_UNITY };   /* battery-aware peak limiter */   // 峰值限幅器
+static _Atomic uint32_t s_battery_mv = 0;          /* last battery reading, 0 before the first */   // 最近一次电池电压
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+static audio_drift_t s_drift;                      /* clock drift estimator and resampler */       // 时钟漂移补偿
+static int16_t s_i2s_block[I2S_BLOCK_FRAMES * AUDIO_DRIFT_MAX_CH];   /* resampled output block */  // 重采样输出块
+static uint32_t s_drift_cycles_avg = 0;            /* published resampler cost, average */      // 重采样平均耗时
+static uint32_t s_drift_cycles_max = 0;            /* published resampler cost, worst case */   // 重采样最长耗时
+static atomic_bool s_drift_report_ready = false;   /* a snapshot waits to be logged */          // 统计待输出
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+static bt_i2s_pull_stats_t s_pull_stats;           /* accumulated in the DMA callback */        // DMA回调中累计的统计
+static bt_i2s_pull_stats_t s_pull_report;          /* snapshot handed to the reporter */        // 待输出的统计快照
+static atomic_bool s_pull_report_ready = false;    /* a snapshot waits to be logged */          // 统计待输出
+static int64_t s_pull_last_us = 0;                 /* time of the previous callback */          // 上一次回调时间
+static esp_timer_handle_t s_pull_report_timer = NULL;   /* logs what the callback may not */    // 统计输出定时器
 #endif
 
 /*******************************
@@ -66,19 +259,64 @@ extern dac_continuous_handle_t tx_chan;
 // 发送消息
 static bool bt_app_send_msg(bt_app_msg_t *msg)
 {
+    bt_app_class_stats_t *st;
+
     // 判断是否为空消息
-    if (msg == NULL) {
+    if (msg == NULL || msg->prio >= BT_APP_PRIO_CLASSES || s_bt_app_task_queue[msg->prio] == NULL) {
         return false;
     }
+    st = &s_app_class_stats[msg->prio];
+    msg->queued_us = (uint32_t)esp_timer_get_time();
 
     /* send the message to work queue */        // 向工作队列发送消息
-    if (xQueueSend(s_bt_app_task_queue, msg, 10 / portTICK_PERIOD_MS) != pdTRUE) {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed", __func__);
+    /* connection and configuration events may wait for room, notifications never stall the stack */
+    // 高优先级事件最多等待10ms，低优先级事件不等待
+    if (xQueueSend(s_bt_app_task_queue[msg->prio], msg,
+                   (msg->prio == BT_APP_PRIO_HIGH) ? 10 / portTICK_PERIOD_MS : 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&st->dropped, 1, memory_order_relaxed);
+        if (msg->prio == BT_APP_PRIO_HIGH) {
+            ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed, event 0x%x", __func__, msg->event);
+        }
         return false;
     }
+    atomic_fetch_add_explicit(&st->sent, 1, memory_order_relaxed);
+    xTaskNotifyGive(s_bt_app_task_handle);
     return true;
 }
 
+// 按优先级取消息，高优先级队列取空之前不处理低优先级队列
+static bool bt_app_receive_msg(bt_app_msg_t *msg)
+{
+    for (int p = 0; p < BT_APP_PRIO_CLASSES; ) {
+        if (xQueueReceive(s_bt_app_task_queue[p], msg, 0) != pdTRUE) {
+            p++;
+        } else {
+            bt_app_class_stats_t *st = &s_app_class_stats[p];
+            uint32_t depth = uxQueueMessagesWaiting(s_bt_app_task_queue[p]) + 1;
+            uint32_t wait_us = (uint32_t)esp_timer_get_time() - msg->queued_us;
+
+            st->handled++;
+            st->depth_max = (depth > st->depth_max) ? depth : st->depth_max;
+            st->wait_sum_us += wait_us;
+            st->wait_max_us = (wait_us > st->wait_max_us) ? wait_us : st->wait_max_us;
+
+            // 合并的事件在处理时才取出最新的参数
+            if (msg->coalesce != BT_APP_COALESCE_NONE) {
+                msg->param = atomic_exchange(&s_app_coalesce[msg->coalesce], NULL);
+                if (msg->param == NULL) {
+                    /* taken back by a dispatcher whose send failed, look at the same class again */
+                    continue;
+                }
+                if (msg->param == &s_app_coalesce_empty) {
+                    msg->param = NULL;
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
 // 分发任务
 static void bt_app_work_dispatched(bt_app_msg_t *msg)
 {
@@ -89,6 +327,57 @@ static void bt_app_work_dispatched(bt_app_msg_t *msg)
     }
 }
 
+// 池和队列的统计有变化时输出，最多每 5 s 一次（应用任务中调用）
+static void bt_app_report(void)
+{
+    static msg_pool_stats_t s_prev[2] = { 0 };
+    static uint32_t s_prev_dropped[BT_APP_PRIO_CLASSES] = { 0 };
+    static uint32_t s_prev_coalesced[BT_APP_PRIO_CLASSES] = { 0 };
+    static int64_t s_last_us = 0;
+    msg_pool_t *pools[2] = { &s_param_pool, &s_blob_pool };
+    const char *names[2] = { "param", "blob" };
+    int64_t now_us = esp_timer_get_time();
+
+    if (now_us - s_last_us < BT_APP_REPORT_US) {
+        return;
+    }
+    s_last_us = now_us;
+    for (int p = 0; p < BT_APP_PRIO_CLASSES; p++) {
+        bt_app_class_stats_t *st = &s_app_class_stats[p];
+        uint32_t dropped = atomic_load_explicit(&st->dropped, memory_order_relaxed);
+        uint32_t coalesced = atomic_load_explicit(&st->coalesced, memory_order_relaxed);
+
+        if (st->handled > 0 || dropped != s_prev_dropped[p]) {
+            ESP_LOGI(BT_APP_CORE_TAG, "%s queue: %"PRIu32" handled, depth max %"PRIu32" of %d, wait avg %"PRIu32" max %"PRIu32" us, "
+                     "%"PRIu32" coalesced", s_app_class_name[p], st->handled, st->depth_max, s_app_queue_len[p],
+                     (st->handled > 0) ? st->wait_sum_us / st->handled : 0, st->wait_max_us, coalesced - s_prev_coalesced[p]);
+        }
+        if (dropped != s_prev_dropped[p]) {
+            ESP_LOGW(BT_APP_CORE_TAG, "%s queue dropped %"PRIu32" events (%"PRIu32" total)", s_app_class_name[p],
+                     dropped - s_prev_dropped[p], dropped);
+        }
+        s_prev_dropped[p] = dropped;
+        s_prev_coalesced[p] = coalesced;
+        st->handled = 0;
+        st->depth_max = 0;
+        st->wait_sum_us = 0;
+        st->wait_max_us = 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        msg_pool_stats_t st;
+
+        msg_pool_get_stats(pools[i], &st);
+        if (st.exhausted != s_prev[i].exhausted) {
+            ESP_LOGW(BT_APP_CORE_TAG, "%s pool empty %"PRIu32" times (%"PRIu32" total), high water %u of %u slots",
+                     names[i], st.exhausted - s_prev[i].exhausted, st.exhausted, st.high_water, st.count);
+        } else if (st.high_water != s_prev[i].high_water) {
+            ESP_LOGI(BT_APP_CORE_TAG, "%s pool high water %u of %u slots, %"PRIu32" allocations",
+                     names[i], st.high_water, st.count, st.allocs);
+        }
+        s_prev[i] = st;
+    }
+}
+
 // 应用任务处理函数
 static void bt_app_task_handler(void *arg)
 {
@@ -96,8 +385,10 @@ static void bt_app_task_handler(void *arg)
 
     for (;;) {
         /* receive message from work queue and handle it */
-        // 无限期等待，直到消息队列传来消息
-        if (pdTRUE == xQueueReceive(s_bt_app_task_queue, &msg, (TickType_t)portMAX_DELAY)) {
+        // 队列都为空时等待发送方的任务通知
+        if (!bt_app_receive_msg(&msg)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else {
             // 接收到消息后，使用ESP_LOGD宏记录调试信息，包括函数名、信号类型msg.sig和事件类型msg.event
             ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x", __func__, msg.sig, msg.event);
 
@@ -111,13 +402,671 @@ static void bt_app_task_handler(void *arg)
                 break;
             } /* switch (msg.sig) */
 
-            // 防止内存泄露，释放内存
+            // 参数槽位归还到池中
             if (msg.param) {
-                free(msg.param);
+                bt_app_pool_free(msg.param);
+            }
+            bt_app_report();
+        }
+    }
+}
+
+// 等待ringbuffer中的数据
+// 数据不足时挂起在任务通知上，由生产者在提交数据后唤醒，取代 xRingbufferReceiveUpTo 的阻塞等待
+// 流水线中同一个任务还会被另一个环形缓冲区的通知唤醒，因此重新检查直到超时
+static size_t bt_i2s_ring_wait(pcm_ring_t *ring, atomic_bool *waiting, uint8_t **data, size_t want, TickType_t timeout)
+{
+    TimeOut_t time_out;
+    size_t item_size = pcm_ring_peek(ring, data, want);
+    if (item_size > 0 || timeout == 0) {
+        return item_size;
+    }
+
+    /* announce the wait before checking again, so a commit in between cannot be missed */
+    atomic_store(waiting, true);
+    vTaskSetTimeOutState(&time_out);
+    while ((item_size = pcm_ring_peek(ring, data, want)) == 0 && xTaskCheckForTimeOut(&time_out, &timeout) == pdFALSE) {
+        ulTaskNotifyTake(pdTRUE, timeout);
+    }
+    atomic_store(waiting, false);
+
+    return item_size;
+}
+
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+// 工作任务：等待输出腾出一段连续空间，由输出在归还数据后唤醒
+static size_t bt_pipe_reserve(uint8_t **span, size_t want)
+{
+    size_t got = pcm_ring_reserve(&s_pipe_ring, span, want);
+    if (got > 0) {
+        return got;
+    }
+
+    atomic_store(&s_pipe_space_waiting, true);
+    while ((got = pcm_ring_reserve(&s_pipe_ring, span, want)) == 0) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    atomic_store(&s_pipe_space_waiting, false);
+
+    return got;
+}
+
+// 输出侧：记录取数时的排队量，越小说明工作任务越接近赶不上
+static void bt_pipe_margin(void)
+{
+    uint32_t fill = (uint32_t)pcm_ring_fill(&s_pipe_ring);
+
+    if (fill < atomic_load(&s_pipe_margin_min)) {
+        atomic_store(&s_pipe_margin_min, fill);
+    }
+}
+
+// 工作任务：累计块间隔，定期连同输出侧的余量一起发布快照
+// interval_us 为0表示欠载后的第一块，没有可比较的上一块
+static void bt_pipe_account(uint32_t interval_us)
+{
+    static bt_pipe_stats_t s_stats = { 0 };
+
+    if (interval_us > 0 && (s_stats.interval_min_us == 0 || interval_us < s_stats.interval_min_us)) {
+        s_stats.interval_min_us = interval_us;
+    }
+    if (interval_us > s_stats.interval_max_us) {
+        s_stats.interval_max_us = interval_us;
+    }
+    if (++s_stats.blocks < PIPE_REPORT_BLOCKS) {
+        return;
+    }
+
+    if (!atomic_load(&s_pipe_report_ready)) {
+        s_stats.margin_min = atomic_exchange(&s_pipe_margin_min, UINT32_MAX);
+        s_pipe_report = s_stats;
+        atomic_store(&s_pipe_report_ready, true);
+    }
+    memset(&s_stats, 0, sizeof(bt_pipe_stats_t));
+}
+
+// 输出流水线统计
+static void bt_pipe_report(void)
+{
+    size_t block_bytes = AUDIO_CHAIN_BLOCK_FRAMES * s_i2s_ch_count * sizeof(int16_t);
+
+    if (!atomic_load(&s_pipe_report_ready)) {
+        return;
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "pipeline: %"PRIu32" blocks on core %d, interval %"PRIu32"..%"PRIu32" us, output margin min %"PRIu32" bytes (%"PRIu32".%02"PRIu32" blocks)",
+             s_pipe_report.blocks, CONFIG_EXAMPLE_A2DP_SINK_DSP_TASK_CORE, s_pipe_report.interval_min_us, s_pipe_report.interval_max_us,
+             s_pipe_report.margin_min, s_pipe_report.margin_min / (uint32_t)block_bytes,
+             (s_pipe_report.margin_min % (uint32_t)block_bytes) * 100 / (uint32_t)block_bytes);
+    atomic_store(&s_pipe_report_ready, false);
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_CORE_LOAD
+// 每 5 s 输出各核负载
+static void bt_i2s_load_report(void)
+{
+    static cpu_load_t s_load = { 0 };
+    static int64_t s_last_us = 0;
+    uint8_t busy[CPU_LOAD_MAX_CORES];
+    int64_t now_us = esp_timer_get_time();
+
+    if (s_last_us != 0 && now_us - s_last_us < CORE_LOAD_REPORT_US) {
+        return;
+    }
+    s_last_us = now_us;
+    if (cpu_load_sample(&s_load, busy)) {
+        ESP_LOGI(BT_APP_CORE_TAG, "cpu load: core 0 %u%%, core 1 %u%%", busy[0], busy[1]);
+    }
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+// 漂移补偿统计：累计每块的重采样周期数，定期发布快照
+// 在输出热路径上运行，不直接打印日志
+static void bt_i2s_drift_account(uint32_t cycles)
+{
+    static uint32_t s_blocks = 0;
+    static uint64_t s_cycles_sum = 0;
+    static uint32_t s_cycles_max = 0;
+
+    s_cycles_sum += cycles;
+    if (cycles > s_cycles_max) {
+        s_cycles_max = cycles;
+    }
+    if (++s_blocks < I2S_DRIFT_REPORT_BLOCKS) {
+        return;
+    }
+
+    /* a snapshot the reporter has not logged yet is simply replaced on the next round */
+    if (!atomic_load(&s_drift_report_ready)) {
+        s_drift_cycles_avg = (uint32_t)(s_cycles_sum / s_blocks);
+        s_drift_cycles_max = s_cycles_max;
+        atomic_store(&s_drift_report_ready, true);
+    }
+    s_blocks = 0;
+    s_cycles_sum = 0;
+    s_cycles_max = 0;
+}
+
+// 输出漂移补偿统计
+static void bt_i2s_drift_report(void)
+{
+    if (!atomic_load(&s_drift_report_ready)) {
+        return;
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "drift: %"PRId32" ppm, fill %u / target %u bytes, resample cycles avg %"PRIu32" max %"PRIu32" per %d frames",
+             audio_drift_ppm(&s_drift), (unsigned)pcm_ring_fill(&s_ringbuf_i2s), (unsigned)audio_jitter_target_bytes(&s_jitter),
+             s_drift_cycles_avg, s_drift_cycles_max, I2S_BLOCK_FRAMES);
+    atomic_store(&s_drift_report_ready, false);
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+// 响度归一化的控制路径：读取新的短期响度并调整增益，每 5 s 输出一次
+static void bt_i2s_loudness_update(void)
+{
+    static uint32_t s_readings = 0;
+
+    if (!audio_loudness_update(&s_loudness) || ++s_readings % 50 != 0) {
+        return;
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "loudness: %.1f LUFS short-term, normalisation %.1f dB (target %d LUFS)",
+             atomic_load(&s_loudness.lufs_x10) / 10.0f, atomic_load(&s_loudness.gain_db10) / 10.0f,
+             CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS_TARGET);
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+// Q15增益换算为dB，只在任务上下文中使用
+static float bt_i2s_gain_db(int32_t gain)
+{
+    return (gain > 0) ? 20.0f * log10f((float)gain / AUDIO_LIMITER_UNITY) : -96.0f;
+}
+
+// 输出限幅器的增益压缩统计
+static void bt_i2s_limiter_report(void)
+{
+    const audio_limiter_stats_t *st = &s_limiter.report;
+
+    if (!atomic_load(&s_limiter.report_ready)) {
+        return;
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "limiter: battery %"PRIu32" mV, ceiling %.1f dB, active %"PRIu32"/%"PRIu32" blocks, gain avg %.2f dB min %.2f dB",
+             atomic_load(&s_battery_mv), bt_i2s_gain_db(st->ceiling), st->active, st->blocks,
+             bt_i2s_gain_db(st->gain_avg), bt_i2s_gain_db(st->gain_min));
+    atomic_store(&s_limiter.report_ready, false);
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_DAC_DITHER
+// 输出噪声整形抖动的耗时，超出预算时告警
+static void bt_i2s_dither_report(void)
+{
+    uint32_t cycles_q8;
+
+    if (!atomic_load(&s_sink.dither.report_ready)) {
+        return;
+    }
+    cycles_q8 = atomic_load(&s_sink.dither.cycles_per_sample_q8);
+    if (cycles_q8 > (AUDIO_DITHER_CYCLES_BUDGET << 8)) {
+        ESP_LOGW(BT_APP_CORE_TAG, "dac dither: %"PRIu32".%02"PRIu32" cycles per sample, over the budget of %d",
+                 cycles_q8 >> 8, ((cycles_q8 & 0xFF) * 100) >> 8, AUDIO_DITHER_CYCLES_BUDGET);
+    } else {
+        ESP_LOGI(BT_APP_CORE_TAG, "dac dither: %"PRIu32".%02"PRIu32" cycles per sample",
+                 cycles_q8 >> 8, ((cycles_q8 & 0xFF) * 100) >> 8);
+    }
+    atomic_store(&s_sink.dither.report_ready, false);
+}
+#endif
+
+// 连接后第一次有音频交给输出设备时记录耗时（可在DMA回调中调用）
+static void bt_i2s_sound_mark(void)
+{
+    bool pending = true;
+
+    if (atomic_load(&s_sound.pending) && atomic_compare_exchange_strong(&s_sound.pending, &pending, false)) {
+        atomic_store(&s_sound.sound_us, (uint32_t)esp_timer_get_time() - s_sound.connect_us);
+        atomic_store(&s_sound.ready, true);
+    }
+}
+
+// 输出本次连接的出声耗时
+static void bt_i2s_sound_report(void)
+{
+    if (!atomic_load(&s_sound.ready)) {
+        return;
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "time to sound: %"PRIu32" ms after connecting (%s start), first packet %"PRIu32" ms, prefetch done %"PRIu32" ms",
+             atomic_load(&s_sound.sound_us) / 1000, s_sound.warm ? "warm" : "cold",
+             s_sound.packet_us / 1000, s_sound.prefetch_us / 1000);
+    // 切换音源时从请求算起，包括断开上一个音源和连接新音源
+    if (s_sound.handoff_us != 0) {
+        ESP_LOGI(BT_APP_CORE_TAG, "handoff: %"PRIu32" ms from request to first sample, %"PRIu32" ms to connecting",
+                 (s_sound.connect_us - s_sound.handoff_us + atomic_load(&s_sound.sound_us)) / 1000,
+                 (s_sound.connect_us - s_sound.handoff_us) / 1000);
+        s_sound.handoff_us = 0;
+    }
+    atomic_store(&s_sound.ready, false);
+}
+
+// 开始计时，开始连接时调用
+static void bt_i2s_sound_start(bool warm)
+{
+    s_sound.connect_us = (uint32_t)esp_timer_get_time();
+    // 切换请求之后太久才开始的连接不算这次切换
+    if (s_sound.handoff_us != 0 && s_sound.connect_us - s_sound.handoff_us > I2S_HANDOFF_MAX_US) {
+        s_sound.handoff_us = 0;
+    }
+    s_sound.packet_us = 0;
+    s_sound.prefetch_us = 0;
+    s_sound.warm = warm;
+    atomic_store(&s_sound.ready, false);
+    atomic_store(&s_sound.pending, true);
+}
+
+// 输出路径是否已停下：取数任务停在预取信号量上，流水线的输出任务放完已处理的数据
+static bool bt_i2s_parked(void)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE && !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+    return atomic_load(&s_i2s_parked) && atomic_load(&s_pipe_out_idle) && pcm_ring_fill(&s_pipe_ring) == 0;
+#else
+    return atomic_load(&s_i2s_parked);
+#endif
+}
+
+// 重配置前让输出路径停下，之后输出设备、声道数和转换内核都可以修改
+// 取数任务（推送模式的I2S任务、流水线的DSP任务）做完当前一块后回到预取信号量上；返回是否确实停下
+static bool bt_i2s_park(void)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    bool parked = (s_bt_dsp_task_handle == NULL);
+#else
+    bool parked = (s_bt_i2s_task_handle == NULL);
+#endif
+
+    atomic_store(&s_i2s_park_req, true);
+    audio_jitter_set_mode(&s_jitter, AUDIO_JITTER_MODE_PREFETCHING);
+    for (int i = 0; i < I2S_IDLE_WAIT_MS / 10 && !(parked = parked || bt_i2s_parked()); i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (!parked) {
+        ESP_LOGW(BT_APP_CORE_TAG, "output path still busy, reconfiguring anyway");
+    }
+    return parked;
+}
+
+// 丢弃排队的旧格式数据，输出路径停下、输出设备停止后调用
+static void bt_i2s_drop_queued(void)
+{
+    /* every consumer is parked or stopped, releasing everything queued is a consumer-side operation */
+    if (s_ringbuf_i2s.buf != NULL) {
+        pcm_ring_release(&s_ringbuf_i2s, pcm_ring_fill(&s_ringbuf_i2s));
+    }
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    if (s_pipe_ring.buf != NULL) {
+        pcm_ring_release(&s_pipe_ring, pcm_ring_fill(&s_pipe_ring));
+    }
+#endif
+}
+
+// 重配置完成：预取重新开始，取数任务在预取完成后继续
+static void bt_i2s_unpark(void)
+{
+    audio_jitter_set_mode(&s_jitter, AUDIO_JITTER_MODE_PREFETCHING);
+    atomic_store(&s_i2s_park_req, false);
+}
+
+// 重新连接时复用任务和缓冲区
+// 输出放完上一次连接剩下的数据后回到预取，此时消费者不再访问ringbuffer，生产者还没有数据，可以清空
+static void bt_i2s_warm_start(void)
+{
+    for (int i = 0; i < I2S_IDLE_WAIT_MS / 10 && audio_jitter_get_mode(&s_jitter) != AUDIO_JITTER_MODE_PREFETCHING; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (audio_jitter_get_mode(&s_jitter) == AUDIO_JITTER_MODE_PREFETCHING) {
+        pcm_ring_reset(&s_ringbuf_i2s);
+    } else {
+        ESP_LOGW(BT_APP_CORE_TAG, "output still draining the previous connection, ringbuffer kept");
+    }
+    atomic_store(&s_ring_fill_avg, 0);
+    // 新连接的数据从这里开始写入
+    atomic_store(&s_handoff_drop, false);
+    /* jitter history belongs to the previous link, the drift estimate is kept for the same source */
+    audio_jitter_configure(&s_jitter, s_i2s_sample_rate, s_i2s_ch_count);
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    audio_loudness_reset(&s_loudness);
+#endif
+}
+
+// 按处理顺序注册各级：响度归一化在最前，测量的是原始节目；限幅在音量之后，门限针对实际输出电平；
+// 频谱分析在最后，显示的是实际播放的声音
+static void bt_i2s_chain_build(void)
+{
+    audio_chain_init(&s_chain, 44100, 2);
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    audio_chain_add(&s_chain, &audio_loudness_stage, &s_loudness);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_VBASS
+    audio_chain_add(&s_chain, &audio_vbass_stage, &s_vbass);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_EQ
+    audio_chain_add(&s_chain, &audio_eq_stage, &s_eq);
+#endif
+    audio_chain_add(&s_chain, &audio_gain_stage, &s_gain);
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+    audio_chain_add(&s_chain, &audio_limiter_stage, &s_limiter);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+    audio_chain_add(&s_chain, &audio_spectrum_stage, &s_spectrum);
+#endif
+}
+
+// 运行处理链；重新配置期间各级状态不可用，输出静音
+static void bt_i2s_chain_process(int16_t *pcm, size_t frames)
+{
+    if (frames > 0 && !audio_chain_process(&s_chain, pcm, frames)) {
+        memset(pcm, 0, frames * s_i2s_ch_count * sizeof(int16_t));
+    }
+}
+
+// 输出处理链各级的耗时和一块的实时余量
+static void bt_i2s_chain_report(void)
+{
+    const audio_chain_stats_t *total = &s_chain.total_report;
+    uint32_t budget = atomic_load(&s_chain.budget);
+
+    if (!atomic_load(&s_chain.report_ready)) {
+        return;
+    }
+    if (total->blocks > 0 && budget > 0) {
+        ESP_LOGI(BT_APP_CORE_TAG, "chain: %"PRIu32" blocks of %d frames, cycles min %"PRIu32" avg %"PRIu32" max %"PRIu32" of %"PRIu32" (%"PRIu32"%% at worst)",
+                 total->blocks, AUDIO_CHAIN_BLOCK_FRAMES, total->cycles_min, (uint32_t)(total->cycles_sum / total->blocks),
+                 total->cycles_max, budget, (uint32_t)((uint64_t)total->cycles_max * 100 / budget));
+    }
+    for (int k = 0; k < s_chain.count; k++) {
+        const audio_chain_stage_t *st = &s_chain.stages[k];
+        if (st->report.blocks == 0) {
+            ESP_LOGI(BT_APP_CORE_TAG, "  %s: bypassed", st->desc->name);
+        } else {
+            ESP_LOGI(BT_APP_CORE_TAG, "  %s: %"PRIu32" blocks, cycles min %"PRIu32" avg %"PRIu32" max %"PRIu32,
+                     st->desc->name, st->report.blocks, st->report.cycles_min,
+                     (uint32_t)(st->report.cycles_sum / st->report.blocks), st->report.cycles_max);
+        }
+    }
+    atomic_store(&s_chain.report_ready, false);
+}
+
+// 把一个分布格式化为 "a/b/c..."
+static void bt_i2s_hist_format(char *buf, size_t size, const uint32_t *hist, int bins)
+{
+    int len = 0;
+
+    buf[0] = '\0';
+    for (int i = 0; i < bins && len >= 0 && (size_t)len < size; i++) {
+        len += snprintf(buf + len, size - len, (i == 0) ? "%"PRIu32 : "/%"PRIu32, hist[i]);
+    }
+}
+
+// 每 5 s 输出这段时间的遥测统计，代替热路径上的日志；空闲时不输出
+static void bt_i2s_telemetry_report(void)
+{
+    static audio_telemetry_snapshot_t s_prev = { 0 };
+    audio_telemetry_snapshot_t now;
+    audio_telemetry_snapshot_t d;
+    char hist[96];
+    uint32_t arrival_max_us = 0;
+    uint32_t write_max_us = 0;
+    int64_t now_us = esp_timer_get_time();
+
+    if (s_prev.time_us != 0 && now_us - s_prev.time_us < TELEMETRY_REPORT_US) {
+        return;
+    }
+    audio_telemetry_snapshot(&s_telemetry, now_us, &now);
+    audio_telemetry_delta(&now, &s_prev, &d);
+    s_prev = now;
+    // 最长值按窗口取出，空闲的窗口也要清零，否则会记到下一个窗口
+    audio_telemetry_take_window_max(&s_telemetry, &arrival_max_us, &write_max_us);
+    if (d.packets_in == 0 && d.packets_dropped == 0 && d.underflows == 0) {
+        return;
+    }
+
+    ESP_LOGI(BT_APP_CORE_TAG, "telemetry %"PRId64" ms: in %"PRIu32" packets %"PRIu32" bytes, out %"PRIu32" blocks %"PRIu32" bytes, "
+             "dropped %"PRIu32" packets %"PRIu32" bytes in %"PRIu32" runs, prefetches %"PRIu32,
+             d.time_us / 1000, d.packets_in, d.bytes_in, d.blocks_out, d.bytes_out,
+             d.packets_dropped, d.bytes_dropped, d.drop_runs, d.prefetches);
+    bt_i2s_hist_format(hist, sizeof(hist), d.fill_hist, AUDIO_TELEMETRY_FILL_BINS);
+    ESP_LOGI(BT_APP_CORE_TAG, "  fill at arrival (1/%d of ring): %s", AUDIO_TELEMETRY_FILL_BINS, hist);
+    bt_i2s_hist_format(hist, sizeof(hist), d.arrival_hist, AUDIO_TELEMETRY_TIME_BINS);
+    ESP_LOGI(BT_APP_CORE_TAG, "  arrival gap (<%d us, x2 per bin): %s, max %"PRIu32" us (%"PRIu32" since boot), jitter %"PRIu32" us",
+             AUDIO_TELEMETRY_TIME_UNIT_US, hist, arrival_max_us, d.arrival_max_us, d.jitter_us);
+    bt_i2s_hist_format(hist, sizeof(hist), d.write_hist, AUDIO_TELEMETRY_TIME_BINS);
+    ESP_LOGI(BT_APP_CORE_TAG, "  output write (<%d us, x2 per bin): %s, max %"PRIu32" us (%"PRIu32" since boot)",
+             AUDIO_TELEMETRY_TIME_UNIT_US, hist, write_max_us, d.write_max_us);
+    if (d.underflows > 0) {
+        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer underflowed %"PRIu32" times, total %"PRIu32", gaps concealed: %"PRIu32,
+                 d.underflows, now.underflows, atomic_load(&s_plc.gaps));
+    }
+}
+
+// 输出各处理级的统计和控制路径的更新（任务上下文）
+static void bt_i2s_report(void)
+{
+    bt_i2s_sound_report();
+    bt_i2s_telemetry_report();
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+    bt_i2s_drift_report();
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    bt_i2s_loudness_update();
+#endif
+    bt_i2s_chain_report();
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+    bt_i2s_limiter_report();
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_DAC_DITHER
+    bt_i2s_dither_report();
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    bt_pipe_report();
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_CORE_LOAD
+    bt_i2s_load_report();
+#endif
+}
+
+// 取出下一个数据块，经过重采样和处理链，丢包隐藏留给输出侧
+// 返回可写入的字节数，0表示数据不足；*release 为写入完成后需要归还ringbuffer的字节数
+// 在输出任务或工作任务中运行，拉模式的DMA回调不经过这里
+static size_t bt_i2s_fetch_block(uint8_t **data, size_t *release, size_t frames, TickType_t timeout)
+{
+    size_t frame_bytes = s_i2s_ch_count * sizeof(int16_t);
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+    size_t produced = 0;
+    size_t consumed = 0;
+    uint32_t cycles = 0;
+    uint8_t *span = NULL;
+    size_t want = audio_drift_max_input(frames) * frame_bytes;
+    size_t item_size = bt_i2s_ring_wait(&s_ringbuf_i2s, &s_i2s_ring_waiting, &span, want, timeout);
+
+    if (item_size == 0) {
+        return 0;
+    }
+
+    /* steer the resampling ratio to keep the fill centred on the jitter target */
+    audio_drift_update(&s_drift, pcm_ring_fill(&s_ringbuf_i2s), audio_jitter_target_bytes(&s_jitter));
+    cycles = esp_cpu_get_cycle_count();
+    consumed = audio_drift_resample(&s_drift, (const int16_t *)span, item_size / frame_bytes,
+                                    s_i2s_block, frames, &produced);
+    cycles = esp_cpu_get_cycle_count() - cycles;
+    // 输入已被重采样进输出块，立即归还ringbuffer
+    pcm_ring_release(&s_ringbuf_i2s, consumed * frame_bytes);
+    if (produced > 0) {
+        bt_i2s_drift_account(cycles);
+    }
+    bt_i2s_chain_process(s_i2s_block, produced);
+
+    *data = (uint8_t *)s_i2s_block;
+    *release = 0;
+    return produced * frame_bytes;
+#else
+    size_t want = frames * frame_bytes;
+    /* get a contiguous span straight from the ring, even across the wrap point */
+    size_t item_size = bt_i2s_ring_wait(&s_ringbuf_i2s, &s_i2s_ring_waiting, data, want, timeout);
+
+    // 消费者在归还之前独占这段数据，可以原地处理
+    bt_i2s_chain_process((int16_t *)*data, item_size / frame_bytes);
+    *release = item_size;
+    return item_size;
+#endif
+}
+
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+// 发布描述符统计快照
+static void bt_i2s_pull_account(uint32_t cycles, uint32_t period_us)
+{
+    bt_i2s_pull_stats_t *st = &s_pull_stats;
+
+    st->cycles_sum += cycles;
+    if (cycles > st->cycles_max) {
+        st->cycles_max = cycles;
+    }
+    /* the first callback after registration has no previous one to measure against */
+    if (period_us > 0 && (st->period_min_us == 0 || period_us < st->period_min_us)) {
+        st->period_min_us = period_us;
+    }
+    if (period_us > st->period_max_us) {
+        st->period_max_us = period_us;
+    }
+    if (++st->descs < I2S_PULL_REPORT_DESCS) {
+        return;
+    }
+
+    if (!atomic_load(&s_pull_report_ready)) {
+        s_pull_report = *st;
+        atomic_store(&s_pull_report_ready, true);
+    }
+    memset(st, 0, sizeof(bt_i2s_pull_stats_t));
+}
+
+// 填充一个DMA描述符
+// 在DMA回调中运行：不等待、不打印日志，始终写满 frames 帧，数据不足时输出隐藏块或静音
+// 只从工作任务处理好的数据中取数，做丢包隐藏和格式转换；重采样和处理链都在工作任务中，回调的耗时有上限
+// 转换内核直接写入输出缓冲区，每个样本只拷贝一次
+static bool bt_i2s_render(void *dst, size_t frames)
+{
+    size_t frame_bytes = s_i2s_ch_count * sizeof(int16_t);
+    uint8_t *out = (uint8_t *)dst;
+    size_t filled = 0;
+    size_t item_size = 0;
+    uint8_t *data = NULL;
+    int16_t *conceal = NULL;
+    size_t conceal_frames = 0;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    int64_t now_us = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    size_t played = 0;
+    bool playing = (s_pipe_ring.buf != NULL);
+
+    if (playing) {
+        bt_pipe_margin();
+    }
+    while (playing && filled < frames) {
+        size_t want = frames - filled;
+        if (want > AUDIO_CHAIN_BLOCK_FRAMES) {
+            want = AUDIO_CHAIN_BLOCK_FRAMES;
+        }
+        item_size = pcm_ring_peek(&s_pipe_ring, &data, want * frame_bytes);
+        if (item_size == 0) {
+            break;
+        }
+        audio_plc_process(&s_plc, (int16_t *)data, item_size / frame_bytes, s_i2s_ch_count);
+        audio_sink_convert(&s_sink, out + filled * s_sink.frame_bytes, (const int16_t *)data, item_size / frame_bytes);
+        pcm_ring_release(&s_pipe_ring, item_size);
+        filled += item_size / frame_bytes;
+    }
+    if (filled > 0) {
+        bt_i2s_sound_mark();
+    }
+    if (filled > 0 && atomic_load(&s_pipe_space_waiting) && s_bt_dsp_task_handle) {
+        vTaskNotifyGiveFromISR(s_bt_dsp_task_handle, &woken);
+    }
+
+    played = filled;
+    if (playing && filled < frames) {
+        // 工作任务没有跟上或流已停止：最后一个正常块淡出，放不下的部分留到下一个描述符，已静音时不再输出
+        conceal = audio_plc_conceal(&s_plc, s_i2s_ch_count, frames - filled, &conceal_frames);
+        if (conceal_frames > 0) {
+            audio_sink_convert(&s_sink, out + filled * s_sink.frame_bytes, conceal, conceal_frames);
+            filled += conceal_frames;
+            s_pull_stats.underruns++;
+        }
+    }
+    audio_sink_silence(&s_sink, out + filled * s_sink.frame_bytes, frames - filled);
+
+    audio_telemetry_on_output(&s_telemetry, played * frame_bytes, (uint32_t)(esp_timer_get_time() - now_us));
+    bt_i2s_pull_account(esp_cpu_get_cycle_count() - cycles,
+                        (s_pull_last_us == 0) ? 0 : (uint32_t)(now_us - s_pull_last_us));
+    s_pull_last_us = now_us;
+    return woken == pdTRUE;
+}
+
+// 在任务上下文中输出DMA回调累计的统计
+static void bt_i2s_pull_report(void *arg)
+{
+    if (atomic_load(&s_pull_report_ready)) {
+        ESP_LOGI(BT_APP_CORE_TAG, "dma refill: %"PRIu32" descriptors, %"PRIu32" underruns, cycles avg %"PRIu32" max %"PRIu32", period %"PRIu32"..%"PRIu32" us",
+                 s_pull_report.descs, s_pull_report.underruns, (uint32_t)(s_pull_report.cycles_sum / s_pull_report.descs),
+                 s_pull_report.cycles_max, s_pull_report.period_min_us, s_pull_report.period_max_us);
+        atomic_store(&s_pull_report_ready, false);
+    }
+    bt_i2s_report();
+}
+#elif CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+
+// I2S任务处理函数（流水线）
+// 从工作任务处理好的数据中取数写入I2S，只做丢包隐藏；工作任务超过 20 ms 没有跟上时淡出，之后等待数据恢复
+static void bt_i2s_task_handler(void *arg)
+{
+    uint8_t *data = NULL;
+    size_t item_size = 0;
+    size_t frame_bytes = 0;
+    int16_t *conceal = NULL;
+    size_t conceal_frames = 0;
+    TickType_t timeout = portMAX_DELAY;
+    int64_t write_us = 0;
+
+    for (;;) {
+        frame_bytes = s_i2s_ch_count * sizeof(int16_t);
+        // 无超时地等待时不会再访问输出设备，工作任务停下、流水线放空之后重配置可以进行
+        atomic_store(&s_pipe_out_idle, timeout == portMAX_DELAY);
+        item_size = bt_i2s_ring_wait(&s_pipe_ring, &s_pipe_data_waiting, &data, AUDIO_CHAIN_BLOCK_FRAMES * frame_bytes, timeout);
+        atomic_store(&s_pipe_out_idle, false);
+        /* the format may have changed while waiting */
+        frame_bytes = s_i2s_ch_count * sizeof(int16_t);
+        if (item_size == 0) {
+            /* fade the last good block out instead of cutting to hard silence */
+            conceal = audio_plc_conceal(&s_plc, s_i2s_ch_count, AUDIO_PLC_MAX_FRAMES, &conceal_frames);
+            if (conceal_frames > 0) {
+                audio_sink_write(&s_sink, conceal, conceal_frames);
             }
+            timeout = portMAX_DELAY;
+            continue;
         }
+
+        bt_pipe_margin();
+        audio_plc_process(&s_plc, (int16_t *)data, item_size / frame_bytes, s_i2s_ch_count);
+        write_us = esp_timer_get_time();
+        audio_sink_write(&s_sink, (const int16_t *)data, item_size / frame_bytes);
+        audio_telemetry_on_output(&s_telemetry, item_size, (uint32_t)(esp_timer_get_time() - write_us));
+        bt_i2s_sound_mark();
+        pcm_ring_release(&s_pipe_ring, item_size);
+        if (atomic_load(&s_pipe_space_waiting) && s_bt_dsp_task_handle) {
+            xTaskNotifyGive(s_bt_dsp_task_handle);
+        }
+        timeout = (TickType_t)pdMS_TO_TICKS(20);
     }
 }
+#else
 
 // I2S任务处理函数
 // 用于从环形缓冲区（ringbuffer）中接收音频数据并将其写入I2S DMA传输缓冲区
@@ -125,39 +1074,205 @@ static void bt_i2s_task_handler(void *arg)
 {
     uint8_t *data = NULL;
     size_t item_size = 0;
-    /**
-     * The total length of DMA buffer of I2S is:
-     * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
-     * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
-     */
-    const size_t item_size_upto = 240 * 6;
-    size_t bytes_written = 0;
+    size_t release_size = 0;
+    int16_t *conceal = NULL;
+    size_t conceal_frames = 0;
+    int64_t write_us = 0;
 
     for (;;) {
+        // 停在信号量上时不访问输出设备，重配置可以进行
+        atomic_store(&s_i2s_parked, true);
         // 无限期等待，直到信号量可用
         if (pdTRUE == xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY)) {
-            // 进入内层循环，从环形缓冲区中接收数据并写入I2S DMA传输缓冲区
-            for (;;) {
-                item_size = 0;
-                /* receive data from ringbuffer and write it to I2S DMA transmit buffer */
-                data = (uint8_t *)xRingbufferReceiveUpTo(s_ringbuf_i2s, &item_size, (TickType_t)pdMS_TO_TICKS(20), item_size_upto);
+            atomic_store(&s_i2s_parked, false);
+            // 进入内层循环，从环形缓冲区中接收数据并写入I2S DMA传输缓冲区；重配置请求停下时回到信号量上
+            while (!atomic_load(&s_i2s_park_req)) {
+                /**
+                 * The total length of DMA buffer of I2S is:
+                 * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
+                 * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
+                 */
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+                item_size = bt_i2s_fetch_block(&data, &release_size, I2S_BLOCK_FRAMES, (TickType_t)pdMS_TO_TICKS(20));
+#else
+                /* two whole chain blocks per write */
+                item_size = bt_i2s_fetch_block(&data, &release_size, 2 * AUDIO_CHAIN_BLOCK_FRAMES, (TickType_t)pdMS_TO_TICKS(20));
+#endif
                 // 如果item_size为0，表示环形缓冲区为空，数据不足
                 if (item_size == 0) {
-                    ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_PREFETCHING");
-                    ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
+                    /* fade the last good block out instead of cutting to hard silence */
+                    conceal = audio_plc_conceal(&s_plc, s_i2s_ch_count, AUDIO_PLC_MAX_FRAMES, &conceal_frames);
+                    if (conceal_frames > 0) {
+                        audio_sink_write(&s_sink, conceal, conceal_frames);
+                    }
+                    audio_jitter_on_underflow(&s_jitter, esp_timer_get_time());
+                    audio_telemetry_count(&s_telemetry.underflows);
+                    break;
+                }
+
+                audio_plc_process(&s_plc, (int16_t *)data, item_size / (s_i2s_ch_count * sizeof(int16_t)), s_i2s_ch_count);
+                write_us = esp_timer_get_time();
+                audio_sink_write(&s_sink, (const int16_t *)data, item_size / (s_i2s_ch_count * sizeof(int16_t)));
+                audio_telemetry_on_output(&s_telemetry, item_size, (uint32_t)(esp_timer_get_time() - write_us));
+                bt_i2s_sound_mark();
+                // 数据所在空间归还ringbuffer
+                if (release_size > 0) {
+                    pcm_ring_release(&s_ringbuf_i2s, release_size);
+                }
+                bt_i2s_report();
+            }
+        }
+    }
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+// DSP任务处理函数
+// 预取完成后从抖动缓冲区取块，重采样并经过处理链，写入流水线交给输出；输出没有腾出空间时等待，由输出的节奏驱动
+static void bt_dsp_task_handler(void *arg)
+{
+    uint8_t *data = NULL;
+    uint8_t *span = NULL;
+    size_t item_size = 0;
+    size_t release_size = 0;
+    int64_t last_us = 0;
+    int64_t now_us = 0;
+
+    for (;;) {
+        // 停在信号量上时不访问抖动缓冲区和处理链，重配置可以进行
+        atomic_store(&s_i2s_parked, true);
+        // 无限期等待，直到预取完成
+        if (pdTRUE == xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY)) {
+            atomic_store(&s_i2s_parked, false);
+            // 重配置请求停下时回到信号量上
+            while (!atomic_load(&s_i2s_park_req)) {
+                bt_pipe_reserve(&span, AUDIO_CHAIN_BLOCK_FRAMES * s_i2s_ch_count * sizeof(int16_t));
+                item_size = bt_i2s_fetch_block(&data, &release_size, AUDIO_CHAIN_BLOCK_FRAMES, (TickType_t)pdMS_TO_TICKS(20));
+                if (item_size == 0) {
+                    /* the output conceals the gap once the queued blocks run out */
+                    audio_jitter_on_underflow(&s_jitter, esp_timer_get_time());
+                    audio_telemetry_count(&s_telemetry.underflows);
+                    last_us = 0;
                     break;
                 }
 
-            #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-                dac_continuous_write(tx_chan, data, item_size, &bytes_written, -1);
-            #else       // 写入I2S通道
-                i2s_channel_write(tx_chan, data, item_size, &bytes_written, portMAX_DELAY);
-            #endif      // 数据返回ringbuffer
-                vRingbufferReturnItem(s_ringbuf_i2s, (void *)data);
+                memcpy(span, data, item_size);
+                if (release_size > 0) {
+                    pcm_ring_release(&s_ringbuf_i2s, release_size);
+                }
+                pcm_ring_commit(&s_pipe_ring, item_size);
+                if (atomic_load(&s_pipe_data_waiting) && s_bt_i2s_task_handle) {
+                    xTaskNotifyGive(s_bt_i2s_task_handle);
+                }
+
+                now_us = esp_timer_get_time();
+                bt_pipe_account((last_us == 0) ? 0 : (uint32_t)(now_us - last_us));
+                last_us = now_us;
+#if !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+                /* the output task stays free of logging, in pull mode the report timer runs anyway */
+                bt_i2s_report();
+#endif
             }
         }
     }
 }
+#endif
+
+// 从内存池切出一块，控制块紧跟在后面，都在内部RAM
+static void *bt_arena_with_cb(const char *name, size_t size, void **cb, size_t cb_size)
+{
+    size_t head = (size + AUDIO_ARENA_ALIGN - 1) & ~(size_t)(AUDIO_ARENA_ALIGN - 1);
+    uint8_t *block = audio_arena_alloc(&s_arena, name, head + cb_size, AUDIO_ARENA_INTERNAL);
+
+    *cb = (block != NULL) ? block + head : NULL;
+    return block;
+}
+
+// 从内存池切出一个任务的栈和控制块
+static void bt_arena_task(bt_task_mem_t *mem, const char *name, size_t stack_bytes)
+{
+    mem->stack = (StackType_t *)bt_arena_with_cb(name, stack_bytes, (void **)&mem->tcb, sizeof(StaticTask_t));
+}
+
+// 开机日志：各区域的预留量与使用量，以及每一块的用途
+static void bt_arena_report(void)
+{
+    for (int r = 0; r < AUDIO_ARENA_REGIONS; r++) {
+        if (s_arena.size[r] > 0) {
+            ESP_LOGI(BT_APP_CORE_TAG, "audio arena %s: %u of %u bytes used", audio_arena_region_name(r),
+                     s_arena.used[r], s_arena.size[r]);
+        }
+    }
+    for (int i = 0; i < s_arena.count; i++) {
+        ESP_LOGI(BT_APP_CORE_TAG, "  %-16s %6"PRIu32" bytes, %s", s_arena.entries[i].name, s_arena.entries[i].size,
+                 audio_arena_region_name(s_arena.entries[i].region));
+    }
+    if (s_arena.failed > 0) {
+        ESP_LOGE(BT_APP_CORE_TAG, "audio arena short of %u bytes, raise EXAMPLE_A2DP_SINK_ARENA_KB", s_arena.failed);
+    }
+}
+
+// 开机时从内存池切出音频子系统的全部缓冲区、任务栈和控制块，之后连接和断开不再触碰堆
+static void bt_arena_reserve(void)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    /* the DMA callback reads the pipeline ring in pull mode, it stays in internal RAM */
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+    const audio_arena_place_t pipe_place = AUDIO_ARENA_INTERNAL;
+#else
+    const audio_arena_place_t pipe_place = AUDIO_ARENA_ANY;
+#endif
+#endif
+    void *external = NULL;
+    size_t external_size = 0;
+
+#if CONFIG_EXAMPLE_A2DP_SINK_ARENA_PSRAM_KB > 0
+    external_size = CONFIG_EXAMPLE_A2DP_SINK_ARENA_PSRAM_KB * 1024;
+    if ((external = heap_caps_malloc(external_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)) == NULL) {
+        ESP_LOGW(BT_APP_CORE_TAG, "no PSRAM for the audio arena, everything goes to internal RAM");
+    }
+#endif
+    audio_arena_init(&s_arena, s_arena_internal, sizeof(s_arena_internal), external, external_size);
+
+    bt_arena_task(&s_app_task_mem, "BtAppTask", BT_APP_TASK_STACK);
+    s_app_queue_storage[BT_APP_PRIO_HIGH] = bt_arena_with_cb("app queue high", BT_APP_HIGH_QUEUE_LEN * sizeof(bt_app_msg_t),
+                                                             (void **)&s_app_queue_cb[BT_APP_PRIO_HIGH], sizeof(StaticQueue_t));
+    s_app_queue_storage[BT_APP_PRIO_LOW] = bt_arena_with_cb("app queue low", BT_APP_LOW_QUEUE_LEN * sizeof(bt_app_msg_t),
+                                                            (void **)&s_app_queue_cb[BT_APP_PRIO_LOW], sizeof(StaticQueue_t));
+    msg_pool_init(&s_param_pool, audio_arena_alloc(&s_arena, "param pool",
+                                                   BT_APP_PARAM_SLOTS * msg_pool_slot_size(BT_APP_PARAM_SIZE),
+                                                   AUDIO_ARENA_INTERNAL),
+                  BT_APP_PARAM_SIZE, BT_APP_PARAM_SLOTS);
+    msg_pool_init(&s_blob_pool, audio_arena_alloc(&s_arena, "blob pool",
+                                                  BT_APP_BLOB_SLOTS * msg_pool_slot_size(BT_APP_BLOB_SIZE),
+                                                  AUDIO_ARENA_INTERNAL),
+                  BT_APP_BLOB_SIZE, BT_APP_BLOB_SLOTS);
+    s_ringbuf_storage = audio_arena_alloc(&s_arena, "ringbuffer", RINGBUF_HIGHEST_WATER_LEVEL + RINGBUF_MIRROR_SIZE,
+                                          AUDIO_ARENA_ANY);
+    s_i2s_write_semaphore_cb = audio_arena_alloc(&s_arena, "i2s semaphore", sizeof(StaticSemaphore_t),
+                                                 AUDIO_ARENA_INTERNAL);
+#if !CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+    bt_arena_task(&s_i2s_task_mem, "BtI2STask", BT_I2S_TASK_STACK);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    s_pipe_storage = audio_arena_alloc(&s_arena, "pipeline ring", PIPE_RING_SIZE + PIPE_MIRROR_SIZE, pipe_place);
+    bt_arena_task(&s_dsp_task_mem, "BtDspTask", BT_DSP_TASK_STACK);
+#endif
+    bt_arena_report();
+}
+
+// 删除栈来自内存池的任务，等它确实停止后栈和控制块才能复用
+static void bt_task_delete(TaskHandle_t *handle)
+{
+    if (*handle == NULL) {
+        return;
+    }
+    vTaskDelete(*handle);
+    while (eTaskGetState(*handle) != eDeleted) {
+        vTaskDelay(1);
+    }
+    *handle = NULL;
+}
 
 /********************************
  * EXTERNAL FUNCTION DEFINITIONS
@@ -167,6 +1282,16 @@ static void bt_i2s_task_handler(void *arg)
 // 用于将工作事件分发到工作队列中
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
 {
+    return bt_app_work_dispatch_prio(p_cback, event, p_params, param_len, p_copy_cback, BT_APP_PRIO_HIGH,
+                                     BT_APP_COALESCE_NONE);
+}
+
+// 按优先级分发，可合并的事件只保留最新的参数
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                               bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio, bt_app_coalesce_t coalesce)
+{
+    void *pending;
+
     // 记录函数名、事件类型和参数长度
     ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d", __func__, event, param_len);
 
@@ -178,44 +1303,108 @@ bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, i
     msg.sig = BT_APP_SIG_WORK_DISPATCH;
     msg.event = event;
     msg.cb = p_cback;
-    
-    // 无参数，直接发送
-    if (param_len == 0) {
-        return bt_app_send_msg(&msg);
-    }
-    // 有参数
-     else if (p_params && param_len > 0) {
-        if ((msg.param = malloc(param_len)) != NULL) {
-            memcpy(msg.param, p_params, param_len);
-            /* check if caller has provided a copy callback to do the deep copy */
-            // 确保参数在消息发送过程中不会被修改或释放
-            if (p_copy_cback) {
-                p_copy_cback(msg.param, p_params, param_len);
-            }
-            return bt_app_send_msg(&msg);
+    msg.prio = (prio < BT_APP_PRIO_CLASSES) ? prio : BT_APP_PRIO_LOW;
+    msg.coalesce = (coalesce < BT_APP_COALESCE_KEYS) ? coalesce : BT_APP_COALESCE_NONE;
+
+    // 有参数，从池中取槽位复制
+    if (param_len != 0) {
+        if (p_params == NULL || param_len < 0) {
+            return false;
+        }
+        if ((msg.param = bt_app_pool_alloc(param_len)) == NULL) {
+            atomic_fetch_add_explicit(&s_app_class_stats[msg.prio].dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        memcpy(msg.param, p_params, param_len);
+        /* check if caller has provided a copy callback to do the deep copy */
+        // 确保参数在消息发送过程中不会被修改或释放
+        if (p_copy_cback) {
+            p_copy_cback(msg.param, p_params, param_len);
         }
     }
 
+    if (msg.coalesce == BT_APP_COALESCE_NONE) {
+        if (bt_app_send_msg(&msg)) {
+            return true;
+        }
+        bt_app_pool_free(msg.param);
+        return false;
+    }
+
+    /* a message for this key still waiting picks up the newest parameters when it is handled */
+    // 同类事件已在队列中时只替换参数，不再入队
+    pending = atomic_exchange(&s_app_coalesce[msg.coalesce], (msg.param != NULL) ? msg.param : &s_app_coalesce_empty);
+    if (pending != NULL) {
+        bt_app_pool_free(pending);
+        atomic_fetch_add_explicit(&s_app_class_stats[msg.prio].coalesced, 1, memory_order_relaxed);
+        return true;
+    }
+    msg.param = NULL;
+    if (bt_app_send_msg(&msg)) {
+        return true;
+    }
+    /* anything folded in meanwhile goes with it, the queue had no room for the event */
+    bt_app_pool_free(atomic_exchange(&s_app_coalesce[msg.coalesce], NULL));
     return false;
 }
 
+// 按长度从参数池或变长数据池取槽位
+void *bt_app_pool_alloc(size_t len)
+{
+    if (len <= BT_APP_PARAM_SIZE) {
+        return msg_pool_alloc(&s_param_pool);
+    }
+    if (len <= BT_APP_BLOB_SIZE) {
+        return msg_pool_alloc(&s_blob_pool);
+    }
+    ESP_LOGE(BT_APP_CORE_TAG, "%s, %u bytes exceed the largest slot", __func__, len);
+    return NULL;
+}
+
+// 归还槽位
+void bt_app_pool_free(void *p)
+{
+    if (msg_pool_owns(&s_param_pool, p)) {
+        msg_pool_free(&s_param_pool, p);
+    } else if (msg_pool_owns(&s_blob_pool, p)) {
+        msg_pool_free(&s_blob_pool, p);
+    }
+}
+
 // 开始应用任务函数
 void bt_app_task_start_up(void)
 {
-    s_bt_app_task_queue = xQueueCreate(10, sizeof(bt_app_msg_t));
-    xTaskCreate(bt_app_task_handler, "BtAppTask", 4096, NULL, 15, &s_bt_app_task_handle);
+    // 音频子系统的内存在WiFi和TLS之前一次性预留
+    if (s_arena.base[AUDIO_ARENA_REGION_INTERNAL] == NULL) {
+        bt_arena_reserve();
+    }
+    if (s_app_task_mem.stack == NULL || s_app_queue_storage[BT_APP_PRIO_HIGH] == NULL ||
+        s_app_queue_storage[BT_APP_PRIO_LOW] == NULL) {
+        ESP_LOGE(BT_APP_CORE_TAG, "%s, no arena space for the application task", __func__);
+        return;
+    }
+    for (int p = 0; p < BT_APP_PRIO_CLASSES; p++) {
+        s_bt_app_task_queue[p] = xQueueCreateStatic(s_app_queue_len[p], sizeof(bt_app_msg_t), s_app_queue_storage[p],
+                                                    s_app_queue_cb[p]);
+    }
+    s_bt_app_task_handle = xTaskCreateStaticPinnedToCore(bt_app_task_handler, "BtAppTask", BT_APP_TASK_STACK, NULL, 15,
+                                                         s_app_task_mem.stack, s_app_task_mem.tcb,
+                                                         BT_TASK_CORE(CONFIG_EXAMPLE_A2DP_SINK_APP_TASK_CORE));
 }
 
 // 关闭应用任务函数
 void bt_app_task_shut_down(void)
 {
-    if (s_bt_app_task_handle) {
-        vTaskDelete(s_bt_app_task_handle);
-        s_bt_app_task_handle = NULL;
+    bt_task_delete(&s_bt_app_task_handle);
+    for (int p = 0; p < BT_APP_PRIO_CLASSES; p++) {
+        if (s_bt_app_task_queue[p]) {
+            vQueueDelete(s_bt_app_task_queue[p]);
+            s_bt_app_task_queue[p] = NULL;
+        }
     }
-    if (s_bt_app_task_queue) {
-        vQueueDelete(s_bt_app_task_queue);
-        s_bt_app_task_queue = NULL;
+    // 合并槽位中尚未处理的参数归还到池中
+    for (int k = 0; k < BT_APP_COALESCE_KEYS; k++) {
+        bt_app_pool_free(atomic_exchange(&s_app_coalesce[k], NULL));
     }
 }
 
@@ -223,68 +1412,408 @@ void bt_app_task_shut_down(void)
 void bt_i2s_task_start_up(void)
 {
     ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
-    ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
-    if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == NULL) {
+    // 任务只在第一次连接时创建，之后的连接复用；缓冲区开机时已从内存池预留
+    if (s_ringbuf_i2s.buf != NULL) {
+        bt_i2s_warm_start();
+        return;
+    }
+    /* the codec is configured before the connection completes, start with the negotiated format */
+    audio_jitter_init(&s_jitter, RINGBUF_HIGHEST_WATER_LEVEL,
+                      CONFIG_EXAMPLE_A2DP_SINK_JITTER_MIN_MS, CONFIG_EXAMPLE_A2DP_SINK_JITTER_MAX_MS);
+    audio_jitter_configure(&s_jitter, s_i2s_sample_rate, s_i2s_ch_count);
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+    audio_drift_configure(&s_drift, s_i2s_sample_rate, s_i2s_ch_count);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    audio_loudness_init(&s_loudness, CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS_TARGET,
+                        CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS_MAX_BOOST, CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS_MAX_CUT);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_VBASS
+    audio_vbass_init(&s_vbass, CONFIG_EXAMPLE_A2DP_SINK_VBASS_CUTOFF_HZ, CONFIG_EXAMPLE_A2DP_SINK_VBASS_GAIN,
+                     s_vbass_enabled);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_EQ
+    audio_eq_init(&s_eq, 44100, s_eq_enabled ? s_eq_preset : AUDIO_EQ_PRESET_FLAT);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+    audio_limiter_configure(&s_limiter, 44100, 2);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+    audio_spectrum_init(&s_spectrum);
+#endif
+    bt_i2s_chain_build();
+    audio_chain_configure(&s_chain, s_i2s_sample_rate, s_i2s_ch_count);
+    audio_plc_init(&s_plc);
+    atomic_store(&s_ring_fill_avg, 0);
+    if (s_i2s_write_semaphore_cb == NULL ||
+        (s_i2s_write_semaphore = xSemaphoreCreateBinaryStatic(s_i2s_write_semaphore_cb)) == NULL) {
         ESP_LOGE(BT_APP_CORE_TAG, "%s, Semaphore create failed", __func__);
         return;
     }
-    if ((s_ringbuf_i2s = xRingbufferCreate(RINGBUF_HIGHEST_WATER_LEVEL, RINGBUF_TYPE_BYTEBUF)) == NULL) {
+    if (s_ringbuf_storage == NULL ||
+        !pcm_ring_init(&s_ringbuf_i2s, s_ringbuf_storage, RINGBUF_HIGHEST_WATER_LEVEL, RINGBUF_MIRROR_SIZE)) {
         ESP_LOGE(BT_APP_CORE_TAG, "%s, ringbuffer create failed", __func__);
         return;
     }
-    xTaskCreate(bt_i2s_task_handler, "BtI2STask", 4096, NULL, configMAX_PRIORITIES - 2, &s_bt_i2s_task_handle);
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    if (s_pipe_storage == NULL || s_dsp_task_mem.stack == NULL ||
+        !pcm_ring_init(&s_pipe_ring, s_pipe_storage, PIPE_RING_SIZE, PIPE_MIRROR_SIZE)) {
+        ESP_LOGE(BT_APP_CORE_TAG, "%s, pipeline ring create failed", __func__);
+        return;
+    }
+    /* below the output task, above everything else on the DSP core */
+    s_bt_dsp_task_handle = xTaskCreateStaticPinnedToCore(bt_dsp_task_handler, "BtDspTask", BT_DSP_TASK_STACK, NULL,
+                                                         configMAX_PRIORITIES - 3, s_dsp_task_mem.stack, s_dsp_task_mem.tcb,
+                                                         CONFIG_EXAMPLE_A2DP_SINK_DSP_TASK_CORE);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+    /* the DMA callbacks refill the output, only their statistics need a task context */
+    const esp_timer_create_args_t report_args = {
+        .callback = bt_i2s_pull_report,
+        .name = "i2s_pull_report",
+    };
+    if (esp_timer_create(&report_args, &s_pull_report_timer) == ESP_OK) {
+        esp_timer_start_periodic(s_pull_report_timer, I2S_PULL_REPORT_PERIOD_US);
+    }
+#else
+    if (s_i2s_task_mem.stack == NULL) {
+        ESP_LOGE(BT_APP_CORE_TAG, "%s, no arena space for the I2S task", __func__);
+        return;
+    }
+    s_bt_i2s_task_handle = xTaskCreateStaticPinnedToCore(bt_i2s_task_handler, "BtI2STask", BT_I2S_TASK_STACK, NULL,
+                                                         configMAX_PRIORITIES - 2, s_i2s_task_mem.stack, s_i2s_task_mem.tcb,
+                                                         BT_TASK_CORE(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_TASK_CORE));
+#endif
 }
 
-// 关闭I2S任务
-void bt_i2s_task_shut_down(void)
+// 安装输出设备
+void bt_i2s_output_install(void)
 {
-    if (s_bt_i2s_task_handle) {
-        vTaskDelete(s_bt_i2s_task_handle);
-        s_bt_i2s_task_handle = NULL;
+    bool warm = s_sink_installed;
+
+    // 出声耗时从开始连接算起
+    bt_i2s_sound_start(warm && s_ringbuf_i2s.buf != NULL);
+    // 输出设备在连接之间保持运行，只在第一次连接时安装
+    if (warm) {
+        return;
     }
-    if (s_ringbuf_i2s) {
-        vRingbufferDelete(s_ringbuf_i2s);
-        s_ringbuf_i2s = NULL;
+#if CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_MODE_PULL
+    s_pull_last_us = 0;
+    audio_sink_install(&s_sink, s_sink_type, bt_i2s_render);
+#else
+    audio_sink_install(&s_sink, s_sink_type, NULL);
+#endif
+    s_sink_installed = true;
+}
+
+// 根据协商的音频格式配置抖动缓冲区
+void bt_i2s_audio_config(uint32_t sample_rate, uint8_t ch_count)
+{
+    bool parked;
+
+    s_i2s_sample_rate = sample_rate;
+    // 重新连接同一格式的音源：输出已按此格式运行，各级状态无需复位
+    if (s_sink_installed && audio_sink_running_as(&s_sink, sample_rate, ch_count) && s_i2s_ch_count == ch_count) {
+        ESP_LOGI(BT_APP_CORE_TAG, "output already running at %"PRIu32" Hz, %u ch, kept as is", sample_rate, ch_count);
+        return;
+    }
+    /* park the output path and stop the output first, so neither a task nor a DMA callback runs on a half reset state */
+    parked = bt_i2s_park();
+    if (s_sink_installed) {
+        audio_sink_stop(&s_sink);
     }
-    if (s_i2s_write_semaphore) {
-        vSemaphoreDelete(s_i2s_write_semaphore);
-        s_i2s_write_semaphore = NULL;
+    if (parked) {
+        bt_i2s_drop_queued();
+    }
+    s_i2s_ch_count = ch_count;
+    audio_jitter_configure(&s_jitter, sample_rate, ch_count);
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+    audio_drift_configure(&s_drift, sample_rate, ch_count);
+#endif
+    /* every stage in one go, the EQ and virtual bass coefficients are designed only here and on a preset change */
+    audio_chain_configure(&s_chain, sample_rate, ch_count);
+    if (s_sink_installed) {
+        audio_sink_start(&s_sink, sample_rate, ch_count);
     }
+    bt_i2s_unpark();
+    ESP_LOGI(BT_APP_CORE_TAG, "jitter buffer target: %"PRIu32" ms (%u bytes)",
+             atomic_load(&s_jitter.target_ms), (unsigned)audio_jitter_target_bytes(&s_jitter));
+}
+
+// 音频流开始/停止
+void bt_i2s_stream_state(bool started)
+{
+    audio_plc_set_stopping(&s_plc, !started);
+}
+
+// 输出淡出到静音
+void bt_i2s_fade_out(void)
+{
+    if (s_ringbuf_i2s.buf == NULL || audio_jitter_get_mode(&s_jitter) == AUDIO_JITTER_MODE_PREFETCHING) {
+        return;
+    }
+
+    /* the output path clears the request once the fade-out block is rendered, wait about two blocks */
+    audio_plc_request_fade_out(&s_plc);
+    for (int i = 0; i < 4 && atomic_load(&s_plc.fade_out_req); i++) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "output faded out, fade-ins: %"PRIu32", fade-outs: %"PRIu32", gaps concealed: %"PRIu32,
+             atomic_load(&s_plc.fade_ins), atomic_load(&s_plc.fade_outs), atomic_load(&s_plc.gaps));
+}
+
+// 切换音源：开始计时，之后收到的数据包丢弃，当前输出淡出后回到预取；
+// 剩下的数据属于上一个音源，下一次连接直接清空，不等它放完，丢弃也到那时结束
+void bt_i2s_handoff_begin(void)
+{
+    s_sound.handoff_us = (uint32_t)esp_timer_get_time();
+    if (s_sound.handoff_us == 0) {
+        s_sound.handoff_us = 1;
+    }
+    atomic_store(&s_handoff_drop, true);
+    bt_i2s_fade_out();
+    if (s_ringbuf_i2s.buf != NULL) {
+        audio_jitter_set_mode(&s_jitter, AUDIO_JITTER_MODE_PREFETCHING);
+    }
+}
+
+// 设置音量，由AVRCP音量事件调用
+void bt_i2s_set_volume(uint8_t volume)
+{
+    audio_gain_set_volume(&s_gain, volume);
+}
+
+// 选择均衡器预设，由AVRCP播放器设置调用
+bool bt_i2s_set_eq_preset(uint8_t preset)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_EQ
+    if (preset >= AUDIO_EQ_PRESET_MAX) {
+        return false;
+    }
+    s_eq_preset = (audio_eq_preset_t)preset;
+    /* before the first connection there is no sample rate to design for, the preset is applied on start up */
+    if (s_eq_enabled && s_eq.sample_rate != 0) {
+        audio_eq_set_preset(&s_eq, s_eq_preset);
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "eq preset: %s%s", audio_eq_preset_name(s_eq_preset), s_eq_enabled ? "" : " (off)");
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 打开/关闭均衡器，由AVRCP播放器设置调用
+void bt_i2s_set_eq_enabled(bool enable)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_EQ
+    s_eq_enabled = enable;
+    if (s_eq.sample_rate != 0) {
+        audio_eq_set_preset(&s_eq, enable ? s_eq_preset : AUDIO_EQ_PRESET_FLAT);
+    }
+    ESP_LOGI(BT_APP_CORE_TAG, "eq %s, preset: %s", enable ? "on" : "off", audio_eq_preset_name(s_eq_preset));
+#endif
+}
+
+// 打开/关闭虚拟低音（A/B 对比），由AVRCP播放器设置调用
+void bt_i2s_set_vbass_enabled(bool enable)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_VBASS
+    s_vbass_enabled = enable;
+    audio_vbass_set_enabled(&s_vbass, enable);
+    /* the timestamp lets a current log be split into the A and B periods */
+    ESP_LOGI(BT_APP_CORE_TAG, "vbass %s at %"PRId64" ms", enable ? "on" : "off", esp_timer_get_time() / 1000);
+#endif
+}
+
+// 新曲目：复位响度测量窗口，归一化增益从当前值继续调整
+void bt_i2s_loudness_reset(void)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    audio_loudness_reset(&s_loudness);
+#endif
+}
+
+// 读取短期响度和归一化增益，供显示使用
+void bt_i2s_get_loudness(int16_t *lufs_x10, int16_t *gain_db10)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    *lufs_x10 = (int16_t)atomic_load(&s_loudness.lufs_x10);
+    *gain_db10 = (int16_t)atomic_load(&s_loudness.gain_db10);
+#else
+    *lufs_x10 = 0;
+    *gain_db10 = 0;
+#endif
+}
+
+// 读取频谱条高，由显示任务按固定帧率调用；分析在调用者的任务中进行
+bool bt_i2s_get_spectrum(uint8_t *levels, size_t count, uint8_t fall)
+{
+    bool fresh = false;
+
+    memset(levels, 0, count);
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+    if (s_ringbuf_i2s.buf != NULL) {
+        fresh = audio_spectrum_update(&s_spectrum, fall);
+        memcpy(levels, s_spectrum.levels, (count < AUDIO_SPECTRUM_BARS) ? count : AUDIO_SPECTRUM_BARS);
+    }
+#endif
+    return fresh;
+}
+
+// 根据电池电压收紧限幅门限，由ADC任务调用
+// 门限在满电和低电两个电压之间按dB线性过渡，处理路径只读取原子变量
+void bt_i2s_set_battery_mv(uint32_t battery_mv)
+{
+#if CONFIG_EXAMPLE_A2DP_SINK_LIMITER
+    const int32_t full_mv = CONFIG_EXAMPLE_A2DP_SINK_LIMITER_FULL_MV;
+    const int32_t low_mv = CONFIG_EXAMPLE_A2DP_SINK_LIMITER_LOW_MV;
+    float db = CONFIG_EXAMPLE_A2DP_SINK_LIMITER_FULL_DB;
+
+    if ((int32_t)battery_mv <= low_mv) {
+        db = CONFIG_EXAMPLE_A2DP_SINK_LIMITER_LOW_DB;
+    } else if ((int32_t)battery_mv < full_mv) {
+        db = CONFIG_EXAMPLE_A2DP_SINK_LIMITER_LOW_DB +
+             (float)(CONFIG_EXAMPLE_A2DP_SINK_LIMITER_FULL_DB - CONFIG_EXAMPLE_A2DP_SINK_LIMITER_LOW_DB) *
+             ((int32_t)battery_mv - low_mv) / (full_mv - low_mv);
+    }
+    atomic_store(&s_battery_mv, battery_mv);
+    audio_limiter_set_ceiling(&s_limiter, (int32_t)(AUDIO_LIMITER_UNITY * powf(10.0f, db / 20.0f)));
+    ESP_LOGD(BT_APP_CORE_TAG, "battery %"PRIu32" mV, limiter ceiling %.1f dB", battery_mv, db);
+#endif
+}
+
+// 根据链路RSSI调整缓冲余量
+void bt_i2s_set_rssi_delta(int8_t rssi_delta)
+{
+    audio_jitter_set_rssi_delta(&s_jitter, rssi_delta);
+}
+
+// 保存协商的SBC参数（控制路径）
+void bt_i2s_set_sbc_info(const uint8_t *cie)
+{
+    audio_telemetry_set_sbc(&s_telemetry, cie);
+}
+
+// 读取遥测计数快照，可在任意任务中调用
+void bt_i2s_get_telemetry(audio_telemetry_snapshot_t *snap)
+{
+    audio_telemetry_snapshot(&s_telemetry, esp_timer_get_time(), snap);
+}
+
+// 估算应用层延迟：一个样本写入ringbuffer后，依次经过抖动缓冲、流水线、重采样和处理链、DMA队列才被播放
+uint32_t bt_i2s_get_delay_us(void)
+{
+    size_t frame_bytes = s_i2s_ch_count * sizeof(int16_t);
+    uint32_t sample_rate = s_i2s_sample_rate;
+    uint64_t frames = 0;
+
+    if (s_ringbuf_i2s.buf == NULL) {
+        return 0;
+    }
+    /* while prefetching, playback starts once the fill reaches the target */
+    if (audio_jitter_get_mode(&s_jitter) == AUDIO_JITTER_MODE_PREFETCHING) {
+        frames = audio_jitter_target_bytes(&s_jitter) / frame_bytes;
+    } else {
+        frames = atomic_load(&s_ring_fill_avg) / frame_bytes;
+    }
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    frames += pcm_ring_fill(&s_pipe_ring) / frame_bytes;
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_DRIFT_COMP
+    frames += AUDIO_DRIFT_HIST_FRAMES;
+#endif
+    frames += audio_chain_latency(&s_chain);
+    if (s_sink_installed) {
+        frames += s_sink.dma_frames;
+    }
+    return (uint32_t)(frames * 1000000 / sample_rate);
 }
 
 // 将数据写入ringbuffer中
 size_t write_ringbuf(const uint8_t *data, size_t size)
 {
-    size_t item_size = 0;
-    BaseType_t done = pdFALSE;
-
-    if (ringbuffer_mode == RINGBUFFER_MODE_DROPPING) {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer is full, drop this packet!");
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size <= RINGBUF_PREFETCH_WATER_LEVEL) {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data decreased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
+    uint8_t *span = NULL;
+    size_t offset = 0;
+    size_t fill = 0;
+    uint32_t avg = 0;
+    int64_t now_us = 0;
+    audio_jitter_mode_t prev_mode;
+
+    if (s_ringbuf_i2s.buf == NULL) {
+        return 0;
+    }
+    // 切换音源期间，被替换的音源断开之前发来的数据不再播放
+    if (atomic_load(&s_handoff_drop)) {
+        audio_telemetry_on_packet(&s_telemetry, size, false);
+        return 0;
+    }
+
+    now_us = esp_timer_get_time();
+    audio_jitter_on_packet(&s_jitter, size, now_us);
+    fill = pcm_ring_fill(&s_ringbuf_i2s);
+    audio_telemetry_on_arrival(&s_telemetry, fill, s_jitter.jitter_us, now_us);
+
+    // 模式变化只计数，由报告任务输出
+    prev_mode = audio_jitter_get_mode(&s_jitter);
+    if (!audio_jitter_admit(&s_jitter, fill, size)) {
+        if (prev_mode != AUDIO_JITTER_MODE_DROPPING) {
+            audio_telemetry_count(&s_telemetry.drop_runs);
         }
+        audio_telemetry_on_packet(&s_telemetry, size, false);
         return 0;
     }
 
-    done = xRingbufferSend(s_ringbuf_i2s, (void *)data, size, (TickType_t)0);
+    /* admission keeps fill + size within the capacity, a packet that still does not fit is dropped whole */
+    if (s_ringbuf_i2s.size - pcm_ring_fill(&s_ringbuf_i2s) < size) {
+        audio_telemetry_on_packet(&s_telemetry, size, false);
+        return 0;
+    }
+    // 直接拷贝进预留空间，单次不超过镜像区长度；消费者只会腾出空间，上面检查过后每段都能预留成功
+    while (offset < size) {
+        size_t chunk = size - offset;
+        if (chunk > RINGBUF_MIRROR_SIZE) {
+            chunk = RINGBUF_MIRROR_SIZE;
+        }
+        if (pcm_ring_reserve(&s_ringbuf_i2s, &span, chunk) != chunk) {
+            audio_telemetry_on_packet(&s_telemetry, size - offset, false);
+            return offset;
+        }
+        memcpy(span, data + offset, chunk);
+        pcm_ring_commit(&s_ringbuf_i2s, chunk);
+        offset += chunk;
+    }
+    audio_telemetry_on_packet(&s_telemetry, size, true);
 
-    if (!done) {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
-        ringbuffer_mode = RINGBUFFER_MODE_DROPPING;
+    /* the fill drains from here until the next packet, half a packet below is its mean */
+    fill = pcm_ring_fill(&s_ringbuf_i2s);
+    fill = (fill > size / 2) ? fill - size / 2 : 0;
+    avg = atomic_load(&s_ring_fill_avg);
+    atomic_store(&s_ring_fill_avg, avg + (((int32_t)fill - (int32_t)avg) >> RING_FILL_AVG_SHIFT));
+
+    // 唤醒等待数据的消费者：I2S任务，流水线模式下为DSP任务
+#if CONFIG_EXAMPLE_A2DP_SINK_PIPELINE
+    if (atomic_load(&s_i2s_ring_waiting) && s_bt_dsp_task_handle) {
+        xTaskNotifyGive(s_bt_dsp_task_handle);
+    }
+#else
+    if (atomic_load(&s_i2s_ring_waiting) && s_bt_i2s_task_handle) {
+        xTaskNotifyGive(s_bt_i2s_task_handle);
     }
+#endif
 
-    if (ringbuffer_mode == RINGBUFFER_MODE_PREFETCHING) {
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size >= RINGBUF_PREFETCH_WATER_LEVEL) {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data increased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-            if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
-                ESP_LOGE(BT_APP_CORE_TAG, "semphore give failed");
-            }
+    // 连接后的出声耗时：第一个数据包和预取完成的时刻
+    if (atomic_load(&s_sound.pending) && s_sound.packet_us == 0) {
+        s_sound.packet_us = (uint32_t)now_us - s_sound.connect_us;
+    }
+    if (audio_jitter_prefetch_done(&s_jitter, pcm_ring_fill(&s_ringbuf_i2s))) {
+        if (atomic_load(&s_sound.pending)) {
+            s_sound.prefetch_us = (uint32_t)esp_timer_get_time() - s_sound.connect_us;
+        }
+        audio_telemetry_count(&s_telemetry.prefetches);
+        if (s_i2s_write_semaphore && pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
+            ESP_LOGE(BT_APP_CORE_TAG, "semphore give failed");
         }
     }
 
-    return done ? size : 0;
+    return size;
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include "audio_telemetry.h"
 
 /* log tag */
 #define BT_APP_CORE_TAG    "BT_APP_CORE"
@@ -20,12 +21,31 @@
  */
 typedef void (* bt_app_cb_t) (uint16_t event, void *param);
 
+/* priority classes of the work queue, a class is handled only when the ones above it are empty */
+typedef enum {
+    BT_APP_PRIO_HIGH,               /* connection, audio configuration, stack events */
+    BT_APP_PRIO_LOW,                /* AVRCP commands, notifications and metadata */
+    BT_APP_PRIO_CLASSES,
+} bt_app_prio_t;
+
+/* events where only the newest one matters, one pending message per key */
+typedef enum {
+    BT_APP_COALESCE_NONE,
+    BT_APP_COALESCE_PLAY_POS,       /* ESP_AVRC_RN_PLAY_POS_CHANGED */
+    BT_APP_COALESCE_VOLUME,         /* absolute volume commands */
+    BT_APP_COALESCE_DELAY,          /* delay report update */
+    BT_APP_COALESCE_KEYS,
+} bt_app_coalesce_t;
+
 /* message to be sent */
 // 发送信号的结构体定义
 typedef struct {
     uint16_t       sig;      /*!< signal to bt_app_task */              // 通知应用程序的信号
     uint16_t       event;    /*!< message event id */                   // 消息的事件id
     bt_app_cb_t    cb;       /*!< context switch callback */            // 回调函数指针
+    uint8_t        prio;     /*!< bt_app_prio_t */                      // 优先级
+    uint8_t        coalesce; /*!< bt_app_coalesce_t */                  // 合并键
+    uint32_t       queued_us;   /*!< time queued, for the latency */    // 入队时间
     void           *param;   /*!< parameter area needs to be last */    // 参数指针，传递给回调函数的指针
 } bt_app_msg_t;
 
@@ -51,6 +71,44 @@ typedef void (* bt_app_copy_cb_t) (void *p_dest, void *p_src, int len);
  */
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback);
 
+/**
+ * @brief  按优先级分发（bt_app_work_dispatch 为高优先级、不合并）
+ *
+ * 高优先级队列满时最多等待10ms，低优先级队列满时不等待，丢失的事件计数并在统计中输出。
+ * 可合并的事件已有一个在排队时只替换为最新的参数，不再入队；处理函数拿到的是最后一次分发的参数。
+ *
+ * @param [in] p_cback       回调函数
+ * @param [in] event         事件id
+ * @param [in] p_params      回调参数
+ * @param [in] param_len     参数长度
+ * @param [in] p_copy_cback  参数深拷贝函数
+ * @param [in] prio          优先级
+ * @param [in] coalesce      合并键，同一个键须始终对应同一个回调函数和事件
+ *
+ * @return  true if queued or folded into a pending message（入队或合并成功返回true）
+ */
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                               bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio, bt_app_coalesce_t coalesce);
+
+/* largest variable-length copy, e.g. one metadata attribute with its terminator */
+#define BT_APP_BLOB_SIZE    (256)
+
+/**
+ * @brief  从开机时预留的消息池中取一个能放下 len 字节的槽位，不等待、不使用堆，可在蓝牙回调中调用
+ *
+ * @param [in] len  需要的字节数，不大于 BT_APP_BLOB_SIZE
+ *
+ * @return  the slot, or NULL if the pool is empty（池空时返回NULL并计数）
+ */
+void *bt_app_pool_alloc(size_t len);
+
+/**
+ * @brief  归还 bt_app_pool_alloc 取出的槽位，NULL 和不属于池的地址被忽略
+ *
+ * @param [in] p  槽位
+ */
+void bt_app_pool_free(void *p);
+
 /**
  * @brief  开始应用任务
  */
@@ -62,14 +120,130 @@ void bt_app_task_start_up(void);
 void bt_app_task_shut_down(void);
 
 /**
- * @brief  开始I2S任务
+ * @brief  开始I2S任务，第一次调用时创建任务和缓冲区，之后复用并清空上一次连接剩下的数据
  */
 void bt_i2s_task_start_up(void);
 
 /**
- * @brief  关闭I2S任务
+ * @brief  安装配置中选择的输出设备（拉取模式下同时注册DMA回调），已安装时保持不变；开始出声计时
+ */
+void bt_i2s_output_install(void);
+
+/**
+ * @brief  根据协商的采样率和声道数配置音频通路（抖动缓冲目标、输出格式等），期间输出暂停
+ *
+ * @param [in] sample_rate  采样率
+ * @param [in] ch_count     声道数
+ */
+void bt_i2s_audio_config(uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief  通知音频流开始或停止，停止时的数据耗尽按淡出处理，不计为数据缺口
+ *
+ * @param [in] started  true 为开始，false 为停止
+ */
+void bt_i2s_stream_state(bool started);
+
+/**
+ * @brief  将输出淡出到静音（编码重配置前调用），之后的第一个块自动淡入
+ */
+void bt_i2s_fade_out(void);
+
+/**
+ * @brief  开始切换音源（请求断开当前音源之后调用）：淡出并丢弃当前音源剩下的数据，
+ *         直到下一次连接开始之前收到的数据包都被丢弃；下一次连接的出声耗时同时从这里算起，作为切换耗时输出
+ */
+void bt_i2s_handoff_begin(void);
+
+/**
+ * @brief  设置输出音量，在I2S任务中以定点增益施加（无锁）
+ *
+ * @param [in] volume  AVRCP绝对音量（0~0x7F）
+ */
+void bt_i2s_set_volume(uint8_t volume);
+
+/**
+ * @brief  选择均衡器预设（audio_eq_preset_t），可在播放中调用
+ *
+ * @param [in] preset  预设序号
+ *
+ * @return  false if the preset is unknown or the EQ is not built in（预设无效或未启用均衡器）
+ */
+bool bt_i2s_set_eq_preset(uint8_t preset);
+
+/**
+ * @brief  打开/关闭均衡器，关闭时为直通，重新打开时恢复所选预设
+ *
+ * @param [in] enable  是否打开
+ */
+void bt_i2s_set_eq_enabled(bool enable);
+
+/**
+ * @brief  打开/关闭虚拟低音，用于对比CPU占用和功耗，下一块生效
+ *
+ * @param [in] enable  是否打开
+ */
+void bt_i2s_set_vbass_enabled(bool enable);
+
+/**
+ * @brief  复位响度测量（切换曲目时调用）
+ */
+void bt_i2s_loudness_reset(void);
+
+/**
+ * @brief  读取短期响度和归一化增益，供显示使用，可在任意任务中调用
+ *
+ * @param [out] lufs_x10   短期响度（0.1 LUFS）
+ * @param [out] gain_db10  归一化增益（0.1 dB）
+ */
+void bt_i2s_get_loudness(int16_t *lufs_x10, int16_t *gain_db10);
+
+/**
+ * @brief  分析最新的一帧并读取频谱条高（0~100），在显示任务中按固定帧率调用；
+ *         处理路径不等待分析，没有新帧时条高按 fall 回落（丢帧）
+ *
+ * @param [out] levels  条高
+ * @param [in]  count   条数，最多 AUDIO_SPECTRUM_BARS
+ * @param [in]  fall    每次最多回落的高度
+ *
+ * @return  true if a new frame was analysed（有新帧返回true）
+ */
+bool bt_i2s_get_spectrum(uint8_t *levels, size_t count, uint8_t fall);
+
+/**
+ * @brief  更新电池电压，据此收紧输出限幅门限，可在任意任务中调用
+ *
+ * @param [in] battery_mv  电池电压（mV）
+ */
+void bt_i2s_set_battery_mv(uint32_t battery_mv);
+
+/**
+ * @brief  根据链路RSSI偏差调整抖动缓冲余量
+ *
+ * @param [in] rssi_delta  RSSI偏差（dB），负数表示低于黄金接收功率范围
+ */
+void bt_i2s_set_rssi_delta(int8_t rssi_delta);
+
+/**
+ * @brief  保存协商的SBC参数，供遥测快照解码
+ *
+ * @param [in] cie  `mcc.cie.sbc` 的四个字节
+ */
+void bt_i2s_set_sbc_info(const uint8_t *cie);
+
+/**
+ * @brief  读取音频路径的遥测计数快照（开机以来的累计值），可在任意任务中调用，取两次之差得到一段时间的统计
+ *
+ * @param [out] snap  快照
+ */
+void bt_i2s_get_telemetry(audio_telemetry_snapshot_t *snap);
+
+/**
+ * @brief  估算应用层延迟：抖动缓冲的平均水位、流水线、处理链和DMA队列，预取时按缓冲目标计算，可在任意任务中调用
+ *
+ * @return  delay in microseconds, 0 while no stream is set up（延迟，微秒；没有音频流时为0）
  */
-void bt_i2s_task_shut_down(void);
+uint32_t bt_i2s_get_delay_us(void);
 
 /**
  * @brief  将数据写入ringbuffer中
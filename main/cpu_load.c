@@ -0,0 +1,35 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "cpu_load.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 采样各核负载
+bool cpu_load_sample(cpu_load_t *load, uint8_t busy_pct[CPU_LOAD_MAX_CORES])
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    int64_t now_us = esp_timer_get_time();
+    int64_t wall = now_us - load->wall_last;
+    bool first = (load->wall_last == 0);
+
+    memset(busy_pct, 0, CPU_LOAD_MAX_CORES);
+    for (int core = 0; core < portNUM_PROCESSORS && core < CPU_LOAD_MAX_CORES; core++) {
+        uint32_t idle = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+        /* the 32-bit counter wraps after about 71 minutes, the difference stays right */
+        uint32_t idle_us = idle - load->idle_last[core];
+
+        load->idle_last[core] = idle;
+        if (!first && wall > 0) {
+            busy_pct[core] = (idle_us >= wall) ? 0 : (uint8_t)(100 - (uint64_t)idle_us * 100 / (uint64_t)wall);
+        }
+    }
+    load->wall_last = now_us;
+    return !first && wall > 0;
+#else
+    return false;
+#endif
+}
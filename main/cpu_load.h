@@ -0,0 +1,32 @@
+#ifndef __CPU_LOAD_H__
+#define __CPU_LOAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* largest core count */
+#define CPU_LOAD_MAX_CORES      (2)
+
+/**
+ * 各核负载
+ *
+ * 由各核空闲任务的运行时间（FreeRTOS 运行时间统计，时基为 esp_timer 微秒）与经过的时间之比得到忙碌比例，
+ * 用于比较单任务与多核流水线音频路径在相同处理负载下的余量。未打开运行时间统计时不输出。
+ * 结构体清零即可使用，第一次采样只记录起点。
+ */
+typedef struct {
+    uint32_t idle_last[CPU_LOAD_MAX_CORES];   /*!< idle run time at the last sample */   // 上次采样时的空闲时间
+    int64_t  wall_last;                       /*!< time of the last sample, 0 if none */ // 上次采样时间
+} cpu_load_t;
+
+/**
+ * @brief  采样，给出上次采样以来各核的忙碌比例（任务上下文）
+ *
+ * @param [in]  load      负载统计
+ * @param [out] busy_pct  各核忙碌比例（%），未使用的核为0
+ *
+ * @return  false on the first sample or without run time statistics（无结果）
+ */
+bool cpu_load_sample(cpu_load_t *load, uint8_t busy_pct[CPU_LOAD_MAX_CORES]);
+
+#endif /* __CPU_LOAD_H__ */
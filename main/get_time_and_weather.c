@@ -247,13 +247,8 @@ static void Weather_http_rest_with_url(void)
     // uart_send_string(name);
     // uart_send_string("\r\n");
 
-    uart_send_string("weather.txt=\"");
-    uart_send_string(text);
-    uart_send_string("\"\xff\xff\xff");
-
-    uart_send_string("temperature.val=");
-    uart_send_num(temp);
-    uart_send_string("\xff\xff\xff");
+    uart_send_txt("weather", text);
+    uart_send_val("temperature", temp);
 
     // uart_send_string("humidity:");
     // uart_send_num(rh);
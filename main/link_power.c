@@ -0,0 +1,188 @@
+#include <string.h>
+#include "link_power.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 是否为已连接的状态
+static bool link_power_connected(uint8_t state)
+{
+    return state == LINK_POWER_STREAMING || state == LINK_POWER_PAUSED || state == LINK_POWER_SLOW_POLL;
+}
+
+// 进入新状态，at_us 之前的时间记到旧状态上
+static void link_power_enter(link_power_t *lp, uint8_t state, int64_t at_us)
+{
+    lp->time_us[lp->state] += (uint64_t)(at_us - lp->since_us);
+    lp->state = state;
+    lp->since_us = at_us;
+    lp->entries[state]++;
+}
+
+// 结束一段sniff模式
+static void link_power_sniff_end(link_power_t *lp, int64_t now_us)
+{
+    if (lp->sniff) {
+        lp->sniff_us += (uint64_t)(now_us - lp->sniff_since_us);
+        lp->sniff = false;
+    }
+}
+
+// 当前状态的超时（毫秒），没有时返回0
+static uint32_t link_power_timeout_ms(const link_power_t *lp)
+{
+    switch (lp->state) {
+    case LINK_POWER_DISCOVERABLE:
+        return lp->cfg.discoverable_ms;
+    case LINK_POWER_PAUSED:
+        return lp->cfg.slow_poll_ms;
+    default:
+        return 0;
+    }
+}
+
+// 可连接占空比：每个周期的开头可被连接
+static bool link_power_window(const link_power_t *lp, int64_t now_us, uint32_t *edge_ms)
+{
+    uint32_t phase = (uint32_t)(((now_us - lp->since_us) / 1000) % lp->cfg.period_ms);
+
+    if (phase < lp->cfg.window_ms) {
+        *edge_ms = lp->cfg.window_ms - phase;
+        return true;
+    }
+    *edge_ms = lp->cfg.period_ms - phase;
+    return false;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化
+void link_power_init(link_power_t *lp, const link_power_config_t *cfg, int64_t now_us)
+{
+    memset(lp, 0, sizeof(link_power_t));
+    lp->cfg = *cfg;
+    // 窗口不小于周期时一直可被连接
+    if (lp->cfg.period_ms == 0 || lp->cfg.window_ms > lp->cfg.period_ms) {
+        lp->cfg.period_ms = lp->cfg.window_ms;
+    }
+    if (lp->cfg.period_ms == 0) {
+        lp->cfg.window_ms = lp->cfg.period_ms = 1;
+    }
+    lp->state = LINK_POWER_DISCOVERABLE;
+    lp->since_us = now_us;
+    lp->entries[LINK_POWER_DISCOVERABLE] = 1;
+}
+
+// 连接或断开；断开时重新开始可被发现的时段，没有连接时的断开事件（重连失败）不影响扫描
+void link_power_on_connection(link_power_t *lp, bool connected, int64_t now_us)
+{
+    if (connected && !link_power_connected(lp->state)) {
+        link_power_enter(lp, LINK_POWER_PAUSED, now_us);
+    } else if (!connected && link_power_connected(lp->state)) {
+        link_power_sniff_end(lp, now_us);
+        link_power_enter(lp, LINK_POWER_DISCOVERABLE, now_us);
+    }
+}
+
+// 重新开始可被发现的时段
+bool link_power_make_discoverable(link_power_t *lp, int64_t now_us)
+{
+    if (link_power_connected(lp->state)) {
+        return false;
+    }
+    link_power_enter(lp, LINK_POWER_DISCOVERABLE, now_us);
+    return true;
+}
+
+// 音频流开始或暂停
+void link_power_on_audio(link_power_t *lp, bool started, int64_t now_us)
+{
+    if (started && (lp->state == LINK_POWER_PAUSED || lp->state == LINK_POWER_SLOW_POLL)) {
+        link_power_enter(lp, LINK_POWER_STREAMING, now_us);
+    } else if (!started && lp->state == LINK_POWER_STREAMING) {
+        link_power_enter(lp, LINK_POWER_PAUSED, now_us);
+    }
+}
+
+// 链路模式变化
+void link_power_on_sniff(link_power_t *lp, bool sniff, int64_t now_us)
+{
+    if (!sniff) {
+        link_power_sniff_end(lp, now_us);
+    } else if (!lp->sniff && link_power_connected(lp->state)) {
+        lp->sniff = true;
+        lp->sniff_since_us = now_us;
+        lp->sniffs++;
+    }
+}
+
+// 处理到期的超时，状态在超时的时刻切换，统计和窗口相位不受调用迟到的影响
+void link_power_update(link_power_t *lp, int64_t now_us, link_power_policy_t *policy)
+{
+    uint32_t timeout_ms = link_power_timeout_ms(lp);
+    uint32_t edge_ms;
+
+    if (timeout_ms != 0 && now_us - lp->since_us >= (int64_t)timeout_ms * 1000) {
+        link_power_enter(lp, (lp->state == LINK_POWER_DISCOVERABLE) ? LINK_POWER_WINDOWED : LINK_POWER_SLOW_POLL,
+                         lp->since_us + (int64_t)timeout_ms * 1000);
+    }
+
+    switch (lp->state) {
+    case LINK_POWER_DISCOVERABLE:
+        policy->connectable = true;
+        policy->discoverable = true;
+        break;
+    case LINK_POWER_WINDOWED:
+        policy->connectable = link_power_window(lp, now_us, &edge_ms);
+        policy->discoverable = false;
+        break;
+    default:
+        policy->connectable = lp->cfg.connectable_connected;
+        policy->discoverable = false;
+        break;
+    }
+    policy->slow_poll = (lp->state == LINK_POWER_SLOW_POLL);
+}
+
+// 距离下一次超时或可连接窗口边沿的时间
+uint32_t link_power_next_ms(const link_power_t *lp, int64_t now_us)
+{
+    uint32_t timeout_ms = link_power_timeout_ms(lp);
+    uint32_t elapsed_ms = (uint32_t)((now_us - lp->since_us) / 1000);
+    uint32_t edge_ms;
+
+    if (lp->state == LINK_POWER_WINDOWED) {
+        if (lp->cfg.window_ms >= lp->cfg.period_ms) {
+            return 0;
+        }
+        link_power_window(lp, now_us, &edge_ms);
+        return edge_ms;
+    }
+    if (timeout_ms == 0) {
+        return 0;
+    }
+    return (elapsed_ms < timeout_ms) ? timeout_ms - elapsed_ms : 1;
+}
+
+// 统计
+void link_power_get_stats(const link_power_t *lp, int64_t now_us, link_power_stats_t *stats)
+{
+    for (int i = 0; i < LINK_POWER_STATES; i++) {
+        uint64_t us = lp->time_us[i] + ((i == lp->state) ? (uint64_t)(now_us - lp->since_us) : 0);
+        stats->time_ms[i] = (uint32_t)(us / 1000);
+        stats->entries[i] = lp->entries[i];
+    }
+    stats->sniff_ms = (uint32_t)((lp->sniff_us + (lp->sniff ? (uint64_t)(now_us - lp->sniff_since_us) : 0)) / 1000);
+    stats->sniffs = lp->sniffs;
+}
+
+// 状态名称
+const char *link_power_state_name(uint8_t state)
+{
+    static const char *names[] = { "discoverable", "windowed connectable", "streaming", "paused", "slow poll" };
+
+    return (state < LINK_POWER_STATES) ? names[state] : "unknown";
+}
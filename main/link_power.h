@@ -0,0 +1,146 @@
+#ifndef __LINK_POWER_H__
+#define __LINK_POWER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* states of the link, one at a time */
+typedef enum {
+    LINK_POWER_DISCOVERABLE,        /* disconnected, discoverable and connectable */
+    LINK_POWER_WINDOWED,            /* disconnected, connectable in short windows only */
+    LINK_POWER_STREAMING,           /* connected, audio started */
+    LINK_POWER_PAUSED,              /* connected, audio suspended */
+    LINK_POWER_SLOW_POLL,           /* connected, suspended long enough to ask for a long poll interval */
+    LINK_POWER_STATES,
+} link_power_state_t;
+
+/* timing, all in milliseconds */
+typedef struct {
+    uint32_t discoverable_ms;       /*!< discoverable after disconnecting, 0 for always */       // 断开后保持可被发现的时长，0为一直
+    uint32_t window_ms;             /*!< connectable part of each period */                      // 每个周期中可被连接的时长
+    uint32_t period_ms;             /*!< connectable duty cycle period, the window for always */ // 可连接占空比的周期，等于窗口时一直可被连接
+    uint32_t slow_poll_ms;          /*!< suspended this long before the long poll, 0 for never */ // 暂停多久后请求长轮询间隔，0为不请求
+    bool     connectable_connected; /*!< stay connectable while connected, for a handoff */      // 连接期间仍可被连接（切换音源）
+} link_power_config_t;
+
+/* what the radio should do */
+typedef struct {
+    bool connectable;               /*!< answer pages */                                         // 响应寻呼
+    bool discoverable;              /*!< answer inquiries */                                     // 响应查询
+    bool slow_poll;                 /*!< ask the source for a long poll interval */              // 请求长轮询间隔
+} link_power_policy_t;
+
+/* time spent in each state */
+typedef struct {
+    uint32_t time_ms[LINK_POWER_STATES];    /*!< including the current state */                 // 各状态累计时间
+    uint32_t entries[LINK_POWER_STATES];    /*!< times each state was entered */                // 各状态进入次数
+    uint32_t sniff_ms;                      /*!< stack reported the link in sniff mode */       // 协议栈报告链路处于sniff模式的时间
+    uint32_t sniffs;                        /*!< entries into sniff mode */                     // 进入sniff模式的次数
+} link_power_stats_t;
+
+/**
+ * 蓝牙链路功耗管理
+ *
+ * 只做决策的状态机，不调用协议栈，可在主机上测试。输入连接、音频流和链路模式的变化以及当前时间，
+ * 输出无线应有的设置（可连接、可被发现、长轮询间隔），调用者负责应用到协议栈，并在 link_power_next_ms
+ * 给出的时间再调用一次 link_power_update，让超时和可连接占空比生效。
+ * 断开后先可被发现，超过 discoverable_ms 后停止可被发现，只在每个 period_ms 中的前 window_ms
+ * 可被连接（调用者切换扫描模式实现，已配对的手机仍能重连）；link_power_make_discoverable 重新开始可被发现的时段。
+ * 连接后音频暂停超过 slow_poll_ms 请求长轮询间隔，音频恢复时立即恢复默认值。
+ * 本模块不请求sniff模式，链路是否进入sniff由协议栈决定，链路模式事件只用于统计时间。
+ * 只在应用任务中调用，不加锁。
+ */
+typedef struct {
+    link_power_config_t cfg;                        /*!< timing */                              // 配置
+    uint8_t             state;                      /*!< link_power_state_t */                  // 当前状态
+    bool                sniff;                      /*!< link reported in sniff mode */         // 链路处于sniff模式
+    int64_t             since_us;                   /*!< entry into the state */                // 进入当前状态的时间
+    int64_t             sniff_since_us;             /*!< entry into sniff mode */               // 进入sniff模式的时间
+    uint64_t            time_us[LINK_POWER_STATES]; /*!< closed time in each state */           // 各状态已结束的累计时间
+    uint32_t            entries[LINK_POWER_STATES];
+    uint64_t            sniff_us;
+    uint32_t            sniffs;
+} link_power_t;
+
+/**
+ * @brief  初始化，从可被发现开始（开机时未连接）
+ *
+ * @param [out] lp      功耗管理
+ * @param [in]  cfg     配置
+ * @param [in]  now_us  当前时间（微秒）
+ */
+void link_power_init(link_power_t *lp, const link_power_config_t *cfg, int64_t now_us);
+
+/**
+ * @brief  连接或断开
+ *
+ * @param [in] lp         功耗管理
+ * @param [in] connected  是否已连接
+ * @param [in] now_us     当前时间（微秒）
+ */
+void link_power_on_connection(link_power_t *lp, bool connected, int64_t now_us);
+
+/**
+ * @brief  音频流开始或暂停
+ *
+ * @param [in] lp       功耗管理
+ * @param [in] started  是否开始
+ * @param [in] now_us   当前时间（微秒）
+ */
+void link_power_on_audio(link_power_t *lp, bool started, int64_t now_us);
+
+/**
+ * @brief  重新开始可被发现的时段（例如按下配对按键），已连接时不改变状态
+ *
+ * @param [in] lp      功耗管理
+ * @param [in] now_us  当前时间（微秒）
+ *
+ * @return  true if the sink is discoverable again, false while connected（已连接时返回false）
+ */
+bool link_power_make_discoverable(link_power_t *lp, int64_t now_us);
+
+/**
+ * @brief  链路模式变化（GAP模式事件）
+ *
+ * @param [in] lp      功耗管理
+ * @param [in] sniff   是否为sniff模式
+ * @param [in] now_us  当前时间（微秒）
+ */
+void link_power_on_sniff(link_power_t *lp, bool sniff, int64_t now_us);
+
+/**
+ * @brief  处理到期的超时并给出当前应有的设置
+ *
+ * @param [in]  lp      功耗管理
+ * @param [in]  now_us  当前时间（微秒）
+ * @param [out] policy  无线设置
+ */
+void link_power_update(link_power_t *lp, int64_t now_us, link_power_policy_t *policy);
+
+/**
+ * @brief  距离下一次需要调用 link_power_update 的时间
+ *
+ * @param [in] lp      功耗管理
+ * @param [in] now_us  当前时间（微秒）
+ *
+ * @return  milliseconds, or 0 if nothing is pending（没有待处理的超时返回0）
+ */
+uint32_t link_power_next_ms(const link_power_t *lp, int64_t now_us);
+
+/**
+ * @brief  各状态的累计时间，包括当前状态已经过的时间
+ *
+ * @param [in]  lp      功耗管理
+ * @param [in]  now_us  当前时间（微秒）
+ * @param [out] stats   统计
+ */
+void link_power_get_stats(const link_power_t *lp, int64_t now_us, link_power_stats_t *stats);
+
+/**
+ * @brief  状态名称
+ *
+ * @param [in] state  link_power_state_t
+ */
+const char *link_power_state_name(uint8_t state);
+
+#endif /* __LINK_POWER_H__ */
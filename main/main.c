@@ -7,10 +7,12 @@
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 
 #include "esp_bt.h"
@@ -37,6 +39,7 @@
 #include "get_time_and_weather.h"
 #include "myuart.h"
 #include "myadc.h"
+#include "audio_spectrum.h"
 
 /* device name */
 #define LOCAL_DEVICE_NAME    "Desktop_Cube"
@@ -49,6 +52,11 @@
 #define DEBUG_TAG           "Debug"
 #define ADC_TAG             "adc detect"
 
+/* presses closer than this count once */
+#define PAIR_BUTTON_DEBOUNCE_US     (500 * 1000)
+/* loudness readout refresh, the meter itself updates every 100 ms */
+#define LOUDNESS_DISPLAY_MS         (1000)
+
 // 变量 define
 int adc_raw;
 int voltage;
@@ -70,6 +78,10 @@ static void bt_app_dev_cb(esp_bt_dev_cb_event_t event, esp_bt_dev_cb_param_t *pa
 static void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
 /* handler for bluetooth stack enabled events */
 static void bt_av_hdl_stack_evt(uint16_t event, void *p_param);
+#if CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO >= 0
+/* pairing button set up */
+static void pair_button_init(void);                                 // 配对按键初始化
+#endif
 
 
 /*******************************
@@ -89,6 +101,49 @@ static char *bda2str(uint8_t * bda, char *str, size_t size)
     return str;
 }
 
+#if CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO >= 0
+// 配对按键按下（定时器服务任务中）：去抖后让音箱重新可被发现
+static void pair_button_pressed(void *arg, uint32_t unused)
+{
+    static int64_t s_last_us = -PAIR_BUTTON_DEBOUNCE_US;
+    int64_t now_us = esp_timer_get_time();
+
+    if (now_us - s_last_us >= PAIR_BUTTON_DEBOUNCE_US) {
+        s_last_us = now_us;
+        bt_av_link_discoverable();
+    }
+    gpio_intr_enable(CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO);
+}
+
+// 配对按键中断：关闭中断，交给定时器服务任务处理
+static void pair_button_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+
+    gpio_intr_disable(CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO);
+    if (xTimerPendFunctionCallFromISR(pair_button_pressed, NULL, 0, &woken) != pdPASS) {
+        gpio_intr_enable(CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+// 配对按键初始化：低电平有效，下降沿中断
+static void pair_button_init(void)
+{
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ull << CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+
+    gpio_config(&io_conf);
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO, pair_button_isr, NULL);
+}
+#endif
+
 // 设备回调函数
 static void bt_app_dev_cb(esp_bt_dev_cb_event_t event, esp_bt_dev_cb_param_t *param)
 {
@@ -154,9 +209,23 @@ static void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *pa
         break;
 #endif
 
+    /* when RSSI delta of the A2DP link is read, this event comes */
+    // 链路RSSI读取完成事件，用于调整抖动缓冲余量
+    case ESP_BT_GAP_READ_RSSI_DELTA_EVT:
+        if (param->read_rssi_delta.stat == ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGD(BT_AV_TAG, "RSSI delta: %d dB", param->read_rssi_delta.rssi_delta);
+            bt_i2s_set_rssi_delta(param->read_rssi_delta.rssi_delta);
+        }
+        break;
     /* when GAP mode changed, this event comes */
     case ESP_BT_GAP_MODE_CHG_EVT:
         ESP_LOGI(BT_AV_TAG, "ESP_BT_GAP_MODE_CHG_EVT mode: %d", param->mode_chg.mode);
+        bt_av_link_mode_changed(param->mode_chg.mode);
+        break;
+    /* when QoS setup completed, this event comes */
+    // 轮询间隔设置完成事件（链路功耗管理在暂停时加长轮询间隔）
+    case ESP_BT_GAP_QOS_CMPL_EVT:
+        ESP_LOGI(BT_AV_TAG, "ESP_BT_GAP_QOS_CMPL_EVT status: %d, t_poll: %"PRIu32, param->qos_cmpl.stat, param->qos_cmpl.t_poll);
         break;
     /* when ACL connection completed, this event comes */
     // ACL链路（用于传输非实时逻辑数据）连接成功事件
@@ -164,6 +233,10 @@ static void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *pa
         bda = (uint8_t *)param->acl_conn_cmpl_stat.bda;
         ESP_LOGI(BT_AV_TAG, "ESP_BT_GAP_ACL_CONN_CMPL_STAT_EVT Connected to [%02x:%02x:%02x:%02x:%02x:%02x], status: 0x%x",
                  bda[0], bda[1], bda[2], bda[3], bda[4], bda[5], param->acl_conn_cmpl_stat.stat);
+        // 连接期间另一个音源建立链路时切换音源
+        if (param->acl_conn_cmpl_stat.stat == ESP_BT_STATUS_SUCCESS) {
+            bt_av_acl_connected(bda);
+        }
         break;
     /* when ACL disconnection completed, this event comes */
     // ACL链路（用于传输非实时逻辑数据）连接断开事件
@@ -216,7 +289,9 @@ static void bt_av_hdl_stack_evt(uint16_t event, void *p_param)
         esp_bt_gap_get_device_name();       // 获取本地设备名称
 
         /* set discoverable and connectable mode, wait to be connected */
-        esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);      // 设置设备为可连接和可发现模式
+        bt_av_link_power_start();       // 设置设备为可连接和可发现模式，一段时间没有连接后停止可被发现，按占空比可被连接
+        // 同时主动连接最近连接过的音源
+        bt_av_reconnect_start();
         break;
     }
     /* others */
@@ -295,15 +370,11 @@ static void Task_RTCGetTime(void* arg){
         // uart_send_string("\r\n");
 
         // 月
-        uart_send_string("month.val=");
         int real_mon = timeinfo.tm_mon + 1;     // 补偿
-        uart_send_num(real_mon);
-        uart_send_string("\xff\xff\xff");
+        uart_send_val("month", real_mon);
 
         // 日
-        uart_send_string("day.val=");
-        uart_send_num(timeinfo.tm_mday);
-        uart_send_string("\xff\xff\xff");
+        uart_send_val("day", timeinfo.tm_mday);
 
         // // 周
         // uart_send_string("wday:");
@@ -311,14 +382,10 @@ static void Task_RTCGetTime(void* arg){
         // uart_send_string("\r\n");
 
         // 时
-        uart_send_string("hour.val=");
-        uart_send_num(timeinfo.tm_hour);
-        uart_send_string("\xff\xff\xff");
+        uart_send_val("hour", timeinfo.tm_hour);
 
         // 分
-        uart_send_string("minute.val=");
-        uart_send_num(timeinfo.tm_min);
-        uart_send_string("\xff\xff\xff");
+        uart_send_val("minute", timeinfo.tm_min);
 
         // // 秒
         // uart_send_string("second:");
@@ -330,6 +397,68 @@ static void Task_RTCGetTime(void* arg){
     }
 }
 
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+/*
+ * 简介：  频谱显示，按固定帧率把频谱条高发送给屏幕（进度条 bar0~bar7），只发送变化的条
+ * 参数：  arg
+ * 返回值：无
+ */
+static void Task_Spectrum(void* arg){
+    uint8_t levels[AUDIO_SPECTRUM_BARS];
+    uint8_t shown[AUDIO_SPECTRUM_BARS];
+    char name[8];
+    // 周期向上取整到tick，实际帧率不超过配置值
+    const TickType_t period = (configTICK_RATE_HZ + CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM_FPS - 1) /
+                              CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM_FPS;
+    // 满格约 0.5 s 落到底
+    const uint8_t fall = (2 * AUDIO_SPECTRUM_LEVEL_MAX + CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM_FPS - 1) /
+                         CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM_FPS;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    // 第一帧全部发送
+    memset(shown, 0xff, sizeof(shown));
+    while(1){
+        vTaskDelayUntil(&last_wake, period);
+        bt_i2s_get_spectrum(levels, AUDIO_SPECTRUM_BARS, fall);
+        for (int i = 0; i < AUDIO_SPECTRUM_BARS; i++) {
+            if (levels[i] != shown[i]) {
+                snprintf(name, sizeof(name), "bar%d", i);
+                uart_send_val(name, levels[i]);
+                shown[i] = levels[i];
+            }
+        }
+    }
+}
+#endif
+
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+/*
+ * 简介：  响度显示，每秒把短期响度和归一化增益发送给屏幕（一位小数的浮点控件 lufs、norm），只发送变化的值
+ * 参数：  arg
+ * 返回值：无
+ */
+static void Task_Loudness(void* arg){
+    int16_t lufs_x10 = 0;
+    int16_t gain_db10 = 0;
+    int shown_lufs = INT32_MIN;
+    int shown_gain = INT32_MIN;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while(1){
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(LOUDNESS_DISPLAY_MS));
+        bt_i2s_get_loudness(&lufs_x10, &gain_db10);
+        if (lufs_x10 != shown_lufs) {
+            uart_send_val("lufs", lufs_x10);
+            shown_lufs = lufs_x10;
+        }
+        if (gain_db10 != shown_gain) {
+            uart_send_val("norm", gain_db10);
+            shown_gain = gain_db10;
+        }
+    }
+}
+#endif
+
 /*
  * 简介：  使用ADC检测电池电量
  * 参数：  arg
@@ -366,6 +495,8 @@ static void Task_ADCGetVoltage(void* arg){
             // 经过分压得到电池电压
             bat_voltage = (double)voltage * 2;
             ESP_LOGI(ADC_TAG, "ADC%d Channel[%d] Battery Voltage: %.1f mV", ADC_UNIT_1 + 1, EXAMPLE_ADC1_CHAN0, bat_voltage);
+            // 电池电压交给音频输出的限幅器
+            bt_i2s_set_battery_mv((uint32_t)bat_voltage);
             // 根据查表判断当前电压值对应的电池电量
             if(bat_voltage >= 4150){
                 bat_percent = 100;
@@ -403,9 +534,7 @@ static void Task_ADCGetVoltage(void* arg){
             ESP_LOGI(ADC_TAG, "Battery power percent: %d%%",bat_percent);
 
             // 串口打印
-            uart_send_string("bat.val=");
-            uart_send_num(bat_percent);
-            uart_send_string("\xff\xff\xff");
+            uart_send_val("bat", bat_percent);
         }
 
         // 1min刷新一次
@@ -497,6 +626,10 @@ void app_main(void)
     /* bluetooth device name, connection mode and profile set up */
     // 派发栈初始化任务
     bt_app_work_dispatch(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL);
+#if CONFIG_EXAMPLE_A2DP_SINK_PAIR_GPIO >= 0
+    // 配对按键：断开后可被发现的时段结束后，按下按键让新的手机可以搜索到
+    pair_button_init();
+#endif
 
     //连接WIFI
     ESP_ERROR_CHECK(esp_netif_init());
@@ -516,6 +649,14 @@ void app_main(void)
     xTaskCreatePinnedToCore(Task_RTCGetTime, "rtc get time", 4096, NULL, 3, NULL, 1);
     // ADC检测电量任务
     xTaskCreatePinnedToCore(Task_ADCGetVoltage, "adc get voltage", 2048, NULL, 12, NULL, 0);
+#if CONFIG_EXAMPLE_A2DP_SINK_SPECTRUM
+    // 频谱显示任务，优先级低于音频和其他显示任务，来不及时丢帧
+    xTaskCreatePinnedToCore(Task_Spectrum, "spectrum", 3072, NULL, 2, NULL, 1);
+#endif
+#if CONFIG_EXAMPLE_A2DP_SINK_LOUDNESS
+    // 响度显示任务
+    xTaskCreatePinnedToCore(Task_Loudness, "loudness", 2048, NULL, 2, NULL, 1);
+#endif
 
     // 拉高GPIO25，使能MAX98357
     gpio_config_t Gpio_config = {
@@ -0,0 +1,98 @@
+#include "msg_pool.h"
+
+/* empty free stack */
+#define MSG_POOL_NONE           (0xffff)
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 栈顶：高16位为版本号，每次修改加一，低16位为槽位下标
+static inline uint32_t msg_pool_top(uint32_t version, uint16_t slot)
+{
+    return (version << 16) | slot;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化，所有槽位串入空闲栈
+bool msg_pool_init(msg_pool_t *pool, void *storage, size_t size, uint16_t count)
+{
+    if (storage == NULL || size == 0 || count == 0 || count > MSG_POOL_MAX_SLOTS) {
+        pool->slots = NULL;
+        pool->count = 0;
+        atomic_init(&pool->top, msg_pool_top(0, MSG_POOL_NONE));
+        return false;
+    }
+    pool->slots = (uint8_t *)storage;
+    pool->size = msg_pool_slot_size(size);
+    pool->count = count;
+    for (uint16_t i = 0; i < count; i++) {
+        atomic_init(&pool->next[i], (i + 1 < count) ? i + 1 : MSG_POOL_NONE);
+    }
+    atomic_init(&pool->top, msg_pool_top(0, 0));
+    atomic_init(&pool->in_use, 0);
+    atomic_init(&pool->high_water, 0);
+    atomic_init(&pool->allocs, 0);
+    atomic_init(&pool->exhausted, 0);
+    return true;
+}
+
+// 出栈
+void *msg_pool_alloc(msg_pool_t *pool)
+{
+    uint32_t top = atomic_load_explicit(&pool->top, memory_order_acquire);
+    uint32_t in_use;
+    uint32_t high;
+    uint16_t slot;
+
+    do {
+        slot = top & 0xffff;
+        if (slot == MSG_POOL_NONE) {
+            atomic_fetch_add_explicit(&pool->exhausted, 1, memory_order_relaxed);
+            return NULL;
+        }
+        /* a stale next is harmless, the version makes the exchange fail */
+    } while (!atomic_compare_exchange_weak_explicit(&pool->top, &top,
+                 msg_pool_top((top >> 16) + 1, atomic_load_explicit(&pool->next[slot], memory_order_relaxed)),
+                 memory_order_acquire, memory_order_acquire));
+
+    atomic_fetch_add_explicit(&pool->allocs, 1, memory_order_relaxed);
+    in_use = atomic_fetch_add_explicit(&pool->in_use, 1, memory_order_relaxed) + 1;
+    high = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    while (in_use > high &&
+           !atomic_compare_exchange_weak_explicit(&pool->high_water, &high, in_use,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+    return pool->slots + (size_t)slot * pool->size;
+}
+
+// 入栈
+void msg_pool_free(msg_pool_t *pool, void *slot)
+{
+    uint16_t index;
+    uint32_t top;
+
+    if (!msg_pool_owns(pool, slot)) {
+        return;
+    }
+    index = (uint16_t)(((uint8_t *)slot - pool->slots) / pool->size);
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+    top = atomic_load_explicit(&pool->top, memory_order_relaxed);
+    do {
+        atomic_store_explicit(&pool->next[index], top & 0xffff, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->top, &top, msg_pool_top((top >> 16) + 1, index),
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// 读取统计
+void msg_pool_get_stats(msg_pool_t *pool, msg_pool_stats_t *stats)
+{
+    stats->count = pool->count;
+    stats->in_use = (uint16_t)atomic_load_explicit(&pool->in_use, memory_order_relaxed);
+    stats->high_water = (uint16_t)atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    stats->allocs = atomic_load_explicit(&pool->allocs, memory_order_relaxed);
+    stats->exhausted = atomic_load_explicit(&pool->exhausted, memory_order_relaxed);
+}
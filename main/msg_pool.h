@@ -0,0 +1,102 @@
+#ifndef __MSG_POOL_H__
+#define __MSG_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* largest slot count of one pool */
+#define MSG_POOL_MAX_SLOTS      (32)
+/* alignment of the slot size, any parameter union fits at that alignment */
+#define MSG_POOL_ALIGN          (8)
+
+/* pool counters */
+typedef struct {
+    uint16_t count;         /*!< slots in the pool */                  // 槽位数
+    uint16_t in_use;        /*!< slots handed out now */               // 当前占用
+    uint16_t high_water;    /*!< most slots handed out at once */      // 最高占用
+    uint32_t allocs;        /*!< slots handed out since boot */        // 累计分配次数
+    uint32_t exhausted;     /*!< requests refused, pool empty */       // 池空导致的分配失败次数
+} msg_pool_stats_t;
+
+/**
+ * 定长消息槽位池
+ *
+ * 开机时给出一块存储区，切成大小相同的槽位，取代每个蓝牙事件的 malloc/free。
+ * 空闲槽位用下标串成无锁栈（Treiber 栈），栈顶带 16 位版本号防止 ABA，
+ * 分配和释放都是 O(1) 的一次比较交换，可在任意任务中调用，多个分配方和释放方可以同时工作。
+ * 池空时分配失败并计数，不等待；统计给出当前占用、最高占用和失败次数，用来确定槽位数。
+ */
+typedef struct {
+    uint8_t          *slots;                        /*!< storage, count * size bytes */   // 存储区
+    size_t           size;                          /*!< bytes per slot */                // 槽位大小
+    uint16_t         count;                         /*!< slots in the pool */             // 槽位数
+    _Atomic uint32_t top;                           /*!< version << 16 | free slot */     // 空闲栈顶
+    _Atomic uint16_t next[MSG_POOL_MAX_SLOTS];      /*!< free slot below each one */      // 空闲栈的下一个
+    _Atomic uint32_t in_use;
+    _Atomic uint32_t high_water;
+    _Atomic uint32_t allocs;
+    _Atomic uint32_t exhausted;
+} msg_pool_t;
+
+/**
+ * @brief  对齐后的槽位大小，用于计算存储区长度
+ *
+ * @param [in] size  需要的字节数
+ */
+static inline size_t msg_pool_slot_size(size_t size)
+{
+    return (size + MSG_POOL_ALIGN - 1) & ~(size_t)(MSG_POOL_ALIGN - 1);
+}
+
+/**
+ * @brief  初始化
+ *
+ * @param [out] pool     槽位池
+ * @param [in]  storage  存储区，长度至少为 count * msg_pool_slot_size(size)
+ * @param [in]  size     槽位大小
+ * @param [in]  count    槽位数，不大于 MSG_POOL_MAX_SLOTS
+ *
+ * @return  false if the parameters are invalid（参数无效）
+ */
+bool msg_pool_init(msg_pool_t *pool, void *storage, size_t size, uint16_t count);
+
+/**
+ * @brief  取一个槽位，不等待
+ *
+ * @param [in] pool  槽位池
+ *
+ * @return  the slot, or NULL if the pool is empty（池空时返回NULL）
+ */
+void *msg_pool_alloc(msg_pool_t *pool);
+
+/**
+ * @brief  归还槽位
+ *
+ * @param [in] pool  槽位池
+ * @param [in] slot  msg_pool_alloc 取出的槽位
+ */
+void msg_pool_free(msg_pool_t *pool, void *slot);
+
+/**
+ * @brief  槽位是否属于这个池
+ *
+ * @param [in] pool  槽位池
+ * @param [in] p     地址
+ */
+static inline bool msg_pool_owns(const msg_pool_t *pool, const void *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    return pool->slots != NULL && b >= pool->slots && b < pool->slots + pool->size * pool->count;
+}
+
+/**
+ * @brief  读取统计
+ *
+ * @param [in]  pool   槽位池
+ * @param [out] stats  统计
+ */
+void msg_pool_get_stats(msg_pool_t *pool, msg_pool_stats_t *stats);
+
+#endif /* __MSG_POOL_H__ */
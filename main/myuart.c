@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include "esp_log.h"
 #include "driver/uart.h"
 #include "string.h"
@@ -53,10 +54,42 @@ void uart_send_string(const char* string)
 
 void uart_send_num(int num)
 {
-    // int转字符串
-    char num_string[3] = {0};
+    // int转字符串（最长为 "-2147483648"）
+    char num_string[12] = {0};
     itoa(num,num_string,10);
     
     // 转化完成后按照字符串格式发送
     uart_send_string(num_string);
 }
+
+/*
+ * 简介：  UART发送一条数值指令（obj.val=num 加结束符），整条指令一次写入，不会与其他任务的指令交错
+ * 参数：  obj  控件名
+ *         num  数值
+ * 返回值：无
+ */
+void uart_send_val(const char* obj, int num)
+{
+    char cmd[48];
+    int len = snprintf(cmd, sizeof(cmd), "%s.val=%d\xff\xff\xff", obj, num);
+
+    if (len > 0 && len < (int)sizeof(cmd)) {
+        uart_write_bytes(UART_NUM_1, cmd, len);
+    }
+}
+
+/*
+ * 简介：  UART发送一条文本指令（obj.txt="text" 加结束符），整条指令一次写入
+ * 参数：  obj   控件名
+ *         text  文本
+ * 返回值：无
+ */
+void uart_send_txt(const char* obj, const char* text)
+{
+    char cmd[128];
+    int len = snprintf(cmd, sizeof(cmd), "%s.txt=\"%s\"\xff\xff\xff", obj, text);
+
+    if (len > 0 && len < (int)sizeof(cmd)) {
+        uart_write_bytes(UART_NUM_1, cmd, len);
+    }
+}
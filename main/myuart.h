@@ -4,5 +4,7 @@
 void uart_init(void);
 void uart_send_string(const char* string);
 void uart_send_num(int num);
+void uart_send_val(const char* obj, int num);
+void uart_send_txt(const char* obj, const char* text);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <string.h>
+#include "pcm_ring.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 初始化环形缓冲区
+bool pcm_ring_init(pcm_ring_t *ring, uint8_t *storage, size_t size, size_t mirror)
+{
+    // 容量必须为2的幂，计数器回绕时下标才保持连续
+    if (ring == NULL || storage == NULL || size == 0 || (size & (size - 1)) != 0 || mirror > size / 2) {
+        return false;
+    }
+
+    ring->buf = storage;
+    ring->size = size;
+    ring->mirror = mirror;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+// 清空环形缓冲区
+void pcm_ring_reset(pcm_ring_t *ring)
+{
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_release);
+}
+
+// 预留可写空间
+size_t pcm_ring_reserve(pcm_ring_t *ring, uint8_t **span, size_t want)
+{
+    /* only the producer writes `head`, so a relaxed load is enough here */
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (want == 0 || want > ring->mirror || want > ring->size - (size_t)(head - tail)) {
+        return 0;
+    }
+
+    // 越过末尾的部分写入镜像区，commit 时回拷
+    *span = ring->buf + (head & (ring->size - 1));
+    return want;
+}
+
+// 提交数据
+void pcm_ring_commit(pcm_ring_t *ring, size_t len)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t start = head & (ring->size - 1);
+    size_t end = start + len;
+
+    if (end > ring->size) {
+        /* the write ran into the overhang: fold it back to the ring start */
+        memcpy(ring->buf, ring->buf + ring->size, end - ring->size);
+    } else if (start < ring->mirror) {
+        /* the write landed in the mirrored head: keep the overhang in sync */
+        size_t mirror_end = (end < ring->mirror) ? end : ring->mirror;
+        memcpy(ring->buf + ring->size + start, ring->buf + start, mirror_end - start);
+    }
+
+    // release语义保证数据先于写计数对消费者可见
+    atomic_store_explicit(&ring->head, head + (uint32_t)len, memory_order_release);
+}
+
+// 获取可读数据
+size_t pcm_ring_peek(pcm_ring_t *ring, uint8_t **span, size_t want)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t fill = (size_t)(head - tail);
+
+    if (want > ring->mirror) {
+        want = ring->mirror;
+    }
+    if (fill < want) {
+        want = fill;
+    }
+    if (want == 0) {
+        return 0;
+    }
+
+    // 跨越回绕点的部分直接从镜像区读取
+    *span = ring->buf + (tail & (ring->size - 1));
+    return want;
+}
+
+// 释放已读数据
+void pcm_ring_release(pcm_ring_t *ring, size_t len)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + (uint32_t)len, memory_order_release);
+}
@@ -0,0 +1,96 @@
+#ifndef __PCM_RING_H__
+#define __PCM_RING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * 单生产者/单消费者（SPSC）无锁PCM环形缓冲区
+ *
+ * 生产者（A2DP数据回调）通过 reserve/commit 直接写入缓冲区，
+ * 消费者（I2S任务）通过 peek/release 直接读取缓冲区，双方都不需要临界区。
+ *
+ * 缓冲区尾部额外分配 `mirror` 字节的镜像区：写入越过末尾的数据在 commit 时回拷到
+ * 缓冲区开头，写入开头 `mirror` 字节内的数据在 commit 时同步到镜像区。
+ * 因此只要单次请求不超过 `mirror` 字节，读写双方拿到的都是一段连续内存，即使跨越了回绕点。
+ */
+typedef struct {
+    uint8_t          *buf;      /*!< storage, `size + mirror` bytes */          // 存储区
+    size_t           size;      /*!< ring capacity in bytes, power of two */    // 容量（2的幂）
+    size_t           mirror;    /*!< overhang bytes after the ring end */       // 镜像区长度
+    _Atomic uint32_t head;      /*!< write counter, owned by producer */        // 写计数（生产者）
+    _Atomic uint32_t tail;      /*!< read counter, owned by consumer */         // 读计数（消费者）
+} pcm_ring_t;
+
+/**
+ * @brief  初始化环形缓冲区
+ *
+ * @param [out] ring     环形缓冲区
+ * @param [in]  storage  存储区，长度至少为 size + mirror 字节
+ * @param [in]  size     容量，必须为2的幂
+ * @param [in]  mirror   镜像区长度，即单次 reserve/peek 的最大连续长度，不大于 size / 2
+ *
+ * @return  true if initialized successfully, false if the parameters are invalid
+ */
+bool pcm_ring_init(pcm_ring_t *ring, uint8_t *storage, size_t size, size_t mirror);
+
+/**
+ * @brief  清空环形缓冲区，只能在生产者和消费者都不工作时调用
+ *
+ * @param [in] ring  环形缓冲区
+ */
+void pcm_ring_reset(pcm_ring_t *ring);
+
+/**
+ * @brief  当前缓冲的数据长度（字节）
+ *
+ * @param [in] ring  环形缓冲区
+ */
+static inline size_t pcm_ring_fill(pcm_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return (size_t)(head - tail);
+}
+
+/**
+ * @brief  生产者：预留一段连续的可写空间
+ *
+ * @param [in]  ring  环形缓冲区
+ * @param [out] span  可写空间的起始地址
+ * @param [in]  want  需要的字节数，不大于 mirror
+ *
+ * @return  want if there is enough free space, 0 otherwise（空间不足时返回0，不做部分预留）
+ */
+size_t pcm_ring_reserve(pcm_ring_t *ring, uint8_t **span, size_t want);
+
+/**
+ * @brief  生产者：提交已写入预留空间的数据，对消费者可见
+ *
+ * @param [in] ring  环形缓冲区
+ * @param [in] len   写入的字节数，不大于上一次 reserve 的长度
+ */
+void pcm_ring_commit(pcm_ring_t *ring, size_t len);
+
+/**
+ * @brief  消费者：获取一段连续的可读数据，不拷贝
+ *
+ * @param [in]  ring  环形缓冲区
+ * @param [out] span  可读数据的起始地址
+ * @param [in]  want  最多读取的字节数，不大于 mirror
+ *
+ * @return  readable length in bytes, 0 if the ring is empty（可读长度）
+ */
+size_t pcm_ring_peek(pcm_ring_t *ring, uint8_t **span, size_t want);
+
+/**
+ * @brief  消费者：释放已读取的数据，空间归还给生产者
+ *
+ * @param [in] ring  环形缓冲区
+ * @param [in] len   释放的字节数，不大于上一次 peek 的长度
+ */
+void pcm_ring_release(pcm_ring_t *ring, size_t len);
+
+#endif /* __PCM_RING_H__ */
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "peer_list.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 清空
+void peer_list_clear(peer_list_t *list)
+{
+    memset(list, 0, sizeof(peer_list_t));
+    list->version = PEER_LIST_VERSION;
+}
+
+// 检查读取的列表
+bool peer_list_valid(const peer_list_t *list)
+{
+    return list->version == PEER_LIST_VERSION && list->count <= PEER_LIST_MAX;
+}
+
+// 查找
+int peer_list_find(const peer_list_t *list, const uint8_t addr[PEER_ADDR_LEN])
+{
+    for (int i = 0; i < list->count; i++) {
+        if (memcmp(list->addr[i], addr, PEER_ADDR_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 移到最前
+bool peer_list_touch(peer_list_t *list, const uint8_t addr[PEER_ADDR_LEN])
+{
+    int at = peer_list_find(list, addr);
+
+    if (at == 0) {
+        return false;
+    }
+    // 不在表中时从最后一个位置挤入，表满则丢掉最早的
+    if (at < 0) {
+        at = (list->count < PEER_LIST_MAX) ? list->count++ : PEER_LIST_MAX - 1;
+    }
+    memmove(list->addr[1], list->addr[0], (size_t)at * PEER_ADDR_LEN);
+    memcpy(list->addr[0], addr, PEER_ADDR_LEN);
+    return true;
+}
+
+// 按已配对设备整理：去掉已取消配对的，补上从未记录过的
+bool peer_list_sync_bonds(peer_list_t *list, const uint8_t (*bonded)[PEER_ADDR_LEN], int bonded_count)
+{
+    peer_list_t synced;
+
+    peer_list_clear(&synced);
+    // 记录过的音源保持原来的先后
+    for (int i = 0; i < list->count; i++) {
+        for (int b = 0; b < bonded_count; b++) {
+            if (memcmp(list->addr[i], bonded[b], PEER_ADDR_LEN) == 0) {
+                memcpy(synced.addr[synced.count++], list->addr[i], PEER_ADDR_LEN);
+                break;
+            }
+        }
+    }
+    // 没有连接记录的已配对设备排在最后
+    for (int b = 0; b < bonded_count && synced.count < PEER_LIST_MAX; b++) {
+        if (peer_list_find(&synced, bonded[b]) < 0) {
+            memcpy(synced.addr[synced.count++], bonded[b], PEER_ADDR_LEN);
+        }
+    }
+    if (memcmp(&synced, list, sizeof(peer_list_t)) == 0) {
+        return false;
+    }
+    *list = synced;
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef __PEER_LIST_H__
+#define __PEER_LIST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* sources remembered, most recent first */
+#define PEER_LIST_MAX           (4)
+/* bytes of a Bluetooth device address */
+#define PEER_ADDR_LEN           (6)
+/* layout version of the stored list, a stored list of another version is ignored */
+#define PEER_LIST_VERSION       (1)
+
+/**
+ * 最近连接过的音源
+ *
+ * 按最近一次连接的先后排列，开机重连按这个顺序。
+ * 最多 PEER_LIST_MAX 个，最早的被挤出。只有字节成员，没有填充，
+ * 可整体作为一个NVS blob保存和读取；读取后用 peer_list_valid 检查，版本或数量不对时当作空表。
+ * 结构体清零即为空表（使用前设置 version）。
+ */
+typedef struct {
+    uint8_t version;                                /*!< PEER_LIST_VERSION */         // 版本
+    uint8_t count;                                  /*!< addresses in use */          // 地址个数
+    uint8_t addr[PEER_LIST_MAX][PEER_ADDR_LEN];     /*!< most recent first */         // 地址，最近的在前
+} peer_list_t;
+
+/**
+ * @brief  清空
+ *
+ * @param [out] list  音源列表
+ */
+void peer_list_clear(peer_list_t *list);
+
+/**
+ * @brief  读取的列表是否可用
+ *
+ * @param [in] list  音源列表
+ */
+bool peer_list_valid(const peer_list_t *list);
+
+/**
+ * @brief  记录一次连接：移到最前，不在表中时插入
+ *
+ * @param [in] list  音源列表
+ * @param [in] addr  地址
+ *
+ * @return  true if the list changed and should be saved（列表有变化，需要保存）
+ */
+bool peer_list_touch(peer_list_t *list, const uint8_t addr[PEER_ADDR_LEN]);
+
+/**
+ * @brief  地址在表中的位置
+ *
+ * @param [in] list  音源列表
+ * @param [in] addr  地址
+ *
+ * @return  index, or -1 if not in the list（不在表中返回-1）
+ */
+int peer_list_find(const peer_list_t *list, const uint8_t addr[PEER_ADDR_LEN]);
+
+/**
+ * @brief  与已配对设备同步：保留仍配对的音源及其先后，去掉已取消配对的，
+ *         没有连接记录的已配对设备按给出的顺序补在最后，直到表满
+ *
+ * @param [in] list          音源列表
+ * @param [in] bonded        已配对设备的地址
+ * @param [in] bonded_count  已配对设备个数
+ *
+ * @return  true if the list changed and should be saved（列表有变化，需要保存）
+ */
+bool peer_list_sync_bonds(peer_list_t *list, const uint8_t (*bonded)[PEER_ADDR_LEN], int bonded_count);
+
+#endif /* __PEER_LIST_H__ */
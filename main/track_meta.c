@@ -0,0 +1,140 @@
+#include <string.h>
+#include "track_meta.h"
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+// 截断到不超过 max 字节，不切开多字节字符
+static size_t track_meta_utf8_cut(const char *text, size_t len, size_t max)
+{
+    if (len <= max) {
+        return len;
+    }
+    while (max > 0 && ((uint8_t)text[max] & 0xc0) == 0x80) {
+        max--;
+    }
+    return max;
+}
+
+// 屏幕指令中的字符：双引号会结束字符串，控制字符显示不出来
+static char track_meta_display_char(char c)
+{
+    return (c == '"') ? '\'' : ((uint8_t)c < 0x20) ? ' ' : c;
+}
+
+// 已保存的字段与替换后的新文本是否相同
+static bool track_meta_same(const char *stored, const char *text, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (stored[i] != track_meta_display_char(text[i])) {
+            return false;
+        }
+    }
+    return stored[len] == '\0';
+}
+
+// 字段文本，未收到时指向空字符串
+static const char *track_meta_text(const track_meta_record_t *rec, track_meta_field_t field)
+{
+    return (rec->present & (1 << field)) ? rec->text + rec->offset[field] : "";
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+// 开始收集，清空收集中的记录
+void track_meta_begin(track_meta_t *meta, uint8_t expected)
+{
+    track_meta_record_t *rec = &meta->rec[meta->shown ^ 1];
+
+    rec->used = 0;
+    rec->present = 0;
+    meta->expected = expected;
+    meta->collecting = true;
+}
+
+// 写入一个属性
+bool track_meta_set(track_meta_t *meta, track_meta_field_t field, const char *text, size_t len)
+{
+    track_meta_record_t *rec = &meta->rec[meta->shown ^ 1];
+    size_t room;
+    size_t keep;
+    char *dst;
+
+    if (!meta->collecting || field >= TRACK_META_FIELDS || (rec->present & (1 << field))) {
+        return false;
+    }
+    // 源端可能带上结尾的NUL
+    len = strnlen(text, len);
+    keep = track_meta_utf8_cut(text, len, TRACK_META_FIELD_MAX);
+    if (keep < len) {
+        meta->truncated++;
+    }
+
+    // 相同的文本只保存一份，例如专辑名与标题相同
+    for (int f = 0; f < TRACK_META_FIELDS; f++) {
+        if ((rec->present & (1 << f)) && track_meta_same(track_meta_text(rec, f), text, keep)) {
+            rec->offset[field] = rec->offset[f];
+            rec->present |= 1 << field;
+            return (rec->present & meta->expected) == meta->expected;
+        }
+    }
+
+    // 字符串区剩余空间不够时再截断
+    room = TRACK_META_TEXT_SIZE - rec->used;
+    if (room == 0) {
+        /* the terminator of the last field doubles as an empty one */
+        meta->truncated++;
+        rec->offset[field] = rec->used - 1;
+        rec->present |= 1 << field;
+        return (rec->present & meta->expected) == meta->expected;
+    }
+    if (keep > room - 1) {
+        keep = track_meta_utf8_cut(text, keep, room - 1);
+        meta->truncated++;
+    }
+    dst = rec->text + rec->used;
+    for (size_t i = 0; i < keep; i++) {
+        dst[i] = track_meta_display_char(text[i]);
+    }
+    dst[keep] = '\0';
+    rec->offset[field] = rec->used;
+    rec->used += keep + 1;
+    rec->present |= 1 << field;
+    return (rec->present & meta->expected) == meta->expected;
+}
+
+// 提交并交换
+uint8_t track_meta_commit(track_meta_t *meta)
+{
+    const track_meta_record_t *old = &meta->rec[meta->shown];
+    const track_meta_record_t *rec = &meta->rec[meta->shown ^ 1];
+    uint8_t changed = 0;
+
+    if (!meta->collecting) {
+        return 0;
+    }
+    meta->collecting = false;
+    // 一个属性都没收到（音源不提供元数据），保留显示中的内容
+    if (rec->present == 0) {
+        return 0;
+    }
+    // 没有收到的字段清空显示
+    for (int f = 0; f < TRACK_META_FIELDS; f++) {
+        if (!meta->pushed || strcmp(track_meta_text(old, f), track_meta_text(rec, f)) != 0) {
+            changed |= 1 << f;
+        }
+    }
+    meta->shown ^= 1;
+    meta->pushed = true;
+    meta->tracks++;
+    return changed;
+}
+
+// 显示中的字段
+const char *track_meta_get(const track_meta_t *meta, track_meta_field_t field)
+{
+    return (field < TRACK_META_FIELDS) ? track_meta_text(&meta->rec[meta->shown], field) : "";
+}
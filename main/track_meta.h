@@ -0,0 +1,86 @@
+#ifndef __TRACK_META_H__
+#define __TRACK_META_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* fields kept for a track */
+typedef enum {
+    TRACK_META_TITLE,
+    TRACK_META_ARTIST,
+    TRACK_META_ALBUM,
+    TRACK_META_GENRE,
+    TRACK_META_FIELDS,
+} track_meta_field_t;
+
+/* string arena of one track, all fields together */
+#define TRACK_META_TEXT_SIZE    (256)
+/* longest field in bytes without the terminator, what one display text command carries */
+#define TRACK_META_FIELD_MAX    (95)
+
+/* one track, fields packed into a fixed string arena */
+typedef struct {
+    char     text[TRACK_META_TEXT_SIZE];        /*!< NUL-terminated fields, back to back */     // 字符串区
+    uint16_t offset[TRACK_META_FIELDS];         /*!< start of each field in text */              // 各字段起始位置
+    uint16_t used;                              /*!< bytes of text taken */                      // 已使用字节数
+    uint8_t  present;                           /*!< 1 << field for each field received */       // 已收到的字段
+} track_meta_record_t;
+
+/**
+ * 曲目元数据
+ *
+ * 两条记录交替使用：一条是屏幕上正在显示的曲目，另一条收集新曲目的各个属性，都是固定大小，换曲不触碰堆。
+ * 新曲目开始时清空收集中的记录，属性逐个写入其字符串区；与已写入字段相同的文本只保存一份（interning）。
+ * 单个字段和整个字符串区不够时都在 UTF-8 字符边界截断；双引号和控制字符替换掉，文本可直接放进屏幕指令。
+ * 提交时与显示中的记录逐字段比较，给出变化的字段，调用者只发送这些字段，然后两条记录交换。
+ * 只在应用任务中调用，不加锁。结构体清零即可使用，第一次提交时所有收到的字段都算变化。
+ */
+typedef struct {
+    track_meta_record_t rec[2];                 /*!< shown and collecting */                     // 显示中和收集中的记录
+    uint8_t             shown;                  /*!< index of the shown record */                // 显示中的记录
+    uint8_t             expected;               /*!< fields asked for this track */              // 本曲目请求的字段
+    bool                collecting;             /*!< a track is being collected */               // 正在收集
+    bool                pushed;                 /*!< the shown record reached the display */     // 显示中的记录已发送过
+    uint32_t            tracks;                 /*!< records committed */                        // 已提交的曲目数
+    uint32_t            truncated;              /*!< fields cut to fit */                        // 被截断的字段数
+} track_meta_t;
+
+/**
+ * @brief  开始收集新曲目的属性
+ *
+ * @param [in] meta      元数据
+ * @param [in] expected  请求的字段（1 << track_meta_field_t）
+ */
+void track_meta_begin(track_meta_t *meta, uint8_t expected);
+
+/**
+ * @brief  写入一个属性，必要时截断
+ *
+ * @param [in] meta   元数据
+ * @param [in] field  字段
+ * @param [in] text   文本（UTF-8）
+ * @param [in] len    文本字节数
+ *
+ * @return  true once every expected field is present（请求的字段都已收到）
+ */
+bool track_meta_set(track_meta_t *meta, track_meta_field_t field, const char *text, size_t len);
+
+/**
+ * @brief  提交收集中的记录：与显示中的记录比较后交换（收到全部字段或等待超时后调用）
+ *
+ * @param [in] meta  元数据
+ *
+ * @return  1 << field for each field to send, 0 if nothing was collected（需要发送的字段）
+ */
+uint8_t track_meta_commit(track_meta_t *meta);
+
+/**
+ * @brief  显示中的字段，没有收到时为空字符串
+ *
+ * @param [in] meta   元数据
+ * @param [in] field  字段
+ */
+const char *track_meta_get(const track_meta_t *meta, track_meta_field_t field);
+
+#endif /* __TRACK_META_H__ */
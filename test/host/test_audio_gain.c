@@ -0,0 +1,149 @@
+#include <string.h>
+#include "host_test.h"
+#include "audio_gain.h"
+
+#define BLOCK_FRAMES        (240)           /* one I2S block, as in bt_app_core.c */
+
+// 单位增益不改变样本
+static void test_unity_bypass(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2], ref[BLOCK_FRAMES * 2];
+    audio_gain_t gain;
+
+    for (int i = 0; i < BLOCK_FRAMES * 2; i++) {
+        ref[i] = (int16_t)(i * 137 - 32768);
+    }
+    ref[0] = INT16_MIN;
+    ref[1] = INT16_MAX;
+    memcpy(pcm, ref, sizeof(pcm));
+    audio_gain_init(&gain);
+    audio_gain_process(&gain, pcm, BLOCK_FRAMES, 2);
+    HOST_CHECK(memcmp(pcm, ref, sizeof(pcm)) == 0);
+
+    // 恒定的单位增益斜坡同样位精确
+    audio_gain_ramp(pcm, BLOCK_FRAMES, 2, AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY);
+    HOST_CHECK(memcmp(pcm, ref, sizeof(pcm)) == 0);
+}
+
+// 斜坡的最后一帧恰好是 to，中间单调且不越过两端；包括满幅样本和 from/to 为单位增益的边界
+static void check_ramp(int32_t from, int32_t to, size_t frames, uint8_t ch_count, int16_t sample)
+{
+    static int16_t pcm[4096 * 2];
+    int32_t ends[2] = { (sample * from) >> 15, (sample * to) >> 15 };
+    int32_t lo = (ends[0] < ends[1]) ? ends[0] : ends[1];
+    int32_t hi = (ends[0] < ends[1]) ? ends[1] : ends[0];
+    bool rising = (to > from) == (sample > 0);
+    int32_t prev = ends[0];
+
+    for (size_t i = 0; i < frames * ch_count; i++) {
+        pcm[i] = sample;
+    }
+    audio_gain_ramp(pcm, frames, ch_count, from, to);
+    for (size_t i = 0; i < frames; i++) {
+        int32_t out = pcm[i * ch_count];
+
+        for (uint8_t c = 1; c < ch_count; c++) {
+            HOST_CHECK(pcm[i * ch_count + c] == out);
+        }
+        HOST_CHECK(out >= lo && out <= hi);
+        HOST_CHECK(rising ? out >= prev : out <= prev);
+        prev = out;
+    }
+    HOST_CHECK(pcm[(frames - 1) * ch_count] == ends[1]);
+}
+
+static void test_ramp_edges(void)
+{
+    static const int16_t samples[] = { INT16_MAX, INT16_MIN, 12345, -1 };
+    static const size_t frame_counts[] = { 1, 7, BLOCK_FRAMES, 4096 };
+
+    for (size_t s = 0; s < sizeof(samples) / sizeof(samples[0]); s++) {
+        for (size_t f = 0; f < sizeof(frame_counts) / sizeof(frame_counts[0]); f++) {
+            for (uint8_t ch = 1; ch <= 2; ch++) {
+                check_ramp(AUDIO_GAIN_UNITY, 0, frame_counts[f], ch, samples[s]);
+                check_ramp(0, AUDIO_GAIN_UNITY, frame_counts[f], ch, samples[s]);
+                check_ramp(AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY - AUDIO_GAIN_MAX_STEP, frame_counts[f], ch, samples[s]);
+                check_ramp(1000, 1001, frame_counts[f], ch, samples[s]);
+                check_ramp(20000, 3, frame_counts[f], ch, samples[s]);
+            }
+        }
+    }
+}
+
+// 音量表单调，0为静音，最大音量为单位增益
+static void test_volume_table(void)
+{
+    HOST_CHECK(audio_gain_from_volume(0) == 0);
+    HOST_CHECK(audio_gain_from_volume(0x7f) == AUDIO_GAIN_UNITY);
+    for (int v = 1; v < 0x80; v++) {
+        HOST_CHECK(audio_gain_from_volume(v) > audio_gain_from_volume(v - 1));
+    }
+}
+
+// 大的音量跳变分摊到多个块，每块的变化不超过 AUDIO_GAIN_MAX_STEP，最终到达目标
+static void test_block_step_limit(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    audio_gain_t gain;
+    int blocks = 0;
+
+    audio_gain_init(&gain);
+    audio_gain_set_volume(&gain, 0);
+    while (gain.current != 0) {
+        int32_t before = gain.current;
+
+        for (int i = 0; i < BLOCK_FRAMES * 2; i++) {
+            pcm[i] = INT16_MAX;
+        }
+        audio_gain_process(&gain, pcm, BLOCK_FRAMES, 2);
+        HOST_CHECK(before - gain.current <= AUDIO_GAIN_MAX_STEP && gain.current < before);
+        HOST_CHECK(pcm[(BLOCK_FRAMES - 1) * 2] == (int16_t)((INT16_MAX * gain.current) >> 15));
+        HOST_CHECK(++blocks <= AUDIO_GAIN_UNITY / AUDIO_GAIN_MAX_STEP);
+    }
+
+    // 静音后保持为0
+    audio_gain_process(&gain, pcm, BLOCK_FRAMES, 2);
+    for (int i = 0; i < BLOCK_FRAMES * 2; i++) {
+        HOST_CHECK(pcm[i] == 0);
+    }
+}
+
+// 每块的处理时间：固定增益与斜坡
+static void bench(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    const int rounds = 200000;
+    audio_gain_t gain;
+    double t0, t_const, t_ramp;
+
+    for (int i = 0; i < BLOCK_FRAMES * 2; i++) {
+        pcm[i] = (int16_t)(i * 61);
+    }
+    audio_gain_init(&gain);
+    audio_gain_set_volume(&gain, 100);
+    gain.current = audio_gain_from_volume(100);
+    t0 = host_now_us();
+    for (int r = 0; r < rounds; r++) {
+        audio_gain_process(&gain, pcm, BLOCK_FRAMES, 2);
+    }
+    t_const = host_now_us() - t0;
+
+    t0 = host_now_us();
+    for (int r = 0; r < rounds; r++) {
+        audio_gain_ramp(pcm, BLOCK_FRAMES, 2, (r & 1) ? 20000 : 24000, (r & 1) ? 24000 : 20000);
+    }
+    t_ramp = host_now_us() - t0;
+
+    printf("%d frame stereo block: constant gain %.1f ns, ramp %.1f ns\n",
+           BLOCK_FRAMES, t_const * 1000 / rounds, t_ramp * 1000 / rounds);
+}
+
+int main(void)
+{
+    test_unity_bypass();
+    test_ramp_edges();
+    test_volume_table();
+    test_block_step_limit();
+    bench();
+    return 0;
+}
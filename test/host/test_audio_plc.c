@@ -0,0 +1,118 @@
+#include <string.h>
+#include <math.h>
+#include "host_test.h"
+#include "audio_plc.h"
+
+#define BLOCK_FRAMES        (252)           /* ends near a peak of the test tone */
+#define DESC_FRAMES         (100)           /* one DMA descriptor, shorter than the fade */
+#define TONE_PERIOD         (48)            /* 1 kHz at 48 kHz */
+#define TONE_AMPLITUDE      (20000)
+/* largest step between two samples of the tone, with a margin for the fade */
+#define MAX_STEP            (TONE_AMPLITUDE * 2 * M_PI / TONE_PERIOD + 64)
+
+// 立体声正弦块，右声道反相
+static void tone_block(int16_t *pcm, size_t frames, size_t phase)
+{
+    for (size_t i = 0; i < frames; i++) {
+        int16_t v = (int16_t)lrint(TONE_AMPLITUDE * sin(2 * M_PI * (double)(phase + i) / TONE_PERIOD));
+
+        pcm[2 * i] = v;
+        pcm[2 * i + 1] = (int16_t)-v;
+    }
+}
+
+// 相邻两帧之间的最大跳变
+static int32_t max_jump(const int16_t *pcm, size_t frames, const int16_t *prev)
+{
+    int32_t jump = 0;
+
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t d = abs(pcm[i] - ((i < 2) ? prev[i] : pcm[i - 2]));
+
+        jump = (d > jump) ? d : jump;
+    }
+    return jump;
+}
+
+// 欠载后的淡出从最后一个样本接着往下走，按描述符分段输出，最后落到零，之后不再输出
+static void test_fade_continues(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    audio_plc_t plc;
+    int16_t prev[2];
+    size_t total = 0;
+    size_t frames;
+    int16_t *out;
+
+    audio_plc_init(&plc);
+    plc.muted = false;
+    tone_block(pcm, BLOCK_FRAMES, 0);
+    audio_plc_process(&plc, pcm, BLOCK_FRAMES, 2);
+    memcpy(prev, &pcm[(BLOCK_FRAMES - 1) * 2], sizeof(prev));
+    HOST_CHECK(abs(prev[0]) > TONE_AMPLITUDE * 9 / 10);
+
+    while ((out = audio_plc_conceal(&plc, 2, DESC_FRAMES, &frames)), frames > 0) {
+        HOST_CHECK(frames <= DESC_FRAMES);
+        HOST_CHECK(max_jump(out, frames, prev) <= MAX_STEP);
+        memcpy(prev, &out[(frames - 1) * 2], sizeof(prev));
+        total += frames;
+    }
+    HOST_CHECK(total == BLOCK_FRAMES);
+    HOST_CHECK(prev[0] == 0 && prev[1] == 0);
+    HOST_CHECK(atomic_load(&plc.fade_outs) == 1 && atomic_load(&plc.gaps) == 1);
+}
+
+// 淡出没放完数据就恢复：剩下的淡出和新块交叉淡化，衔接处不跳变
+static void test_crossfade_on_resume(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    audio_plc_t plc;
+    int16_t prev[2];
+    size_t frames;
+    int16_t *out;
+
+    audio_plc_init(&plc);
+    plc.muted = false;
+    tone_block(pcm, BLOCK_FRAMES, 0);
+    audio_plc_process(&plc, pcm, BLOCK_FRAMES, 2);
+    out = audio_plc_conceal(&plc, 2, DESC_FRAMES, &frames);
+    HOST_CHECK(frames == DESC_FRAMES);
+    memcpy(prev, &out[(frames - 1) * 2], sizeof(prev));
+
+    // 恢复的数据接着原来的相位
+    tone_block(pcm, BLOCK_FRAMES, BLOCK_FRAMES);
+    audio_plc_process(&plc, pcm, BLOCK_FRAMES, 2);
+    HOST_CHECK(max_jump(pcm, BLOCK_FRAMES, prev) <= 2 * MAX_STEP);
+    HOST_CHECK(atomic_load(&plc.fade_ins) == 1);
+
+    // 淡出的剩余部分已经用掉，下一次欠载重新从这一块开始
+    out = audio_plc_conceal(&plc, 2, BLOCK_FRAMES, &frames);
+    HOST_CHECK(frames == BLOCK_FRAMES);
+    HOST_CHECK(abs(out[0] - pcm[(BLOCK_FRAMES - 1) * 2]) <= MAX_STEP);
+}
+
+// 控制路径请求的淡出之后，已静音时不再产生隐藏块
+static void test_requested_fade_out(void)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    audio_plc_t plc;
+    size_t frames = 1;
+
+    audio_plc_init(&plc);
+    tone_block(pcm, BLOCK_FRAMES, 0);
+    audio_plc_process(&plc, pcm, BLOCK_FRAMES, 2);
+    audio_plc_request_fade_out(&plc);
+    tone_block(pcm, BLOCK_FRAMES, BLOCK_FRAMES);
+    audio_plc_process(&plc, pcm, BLOCK_FRAMES, 2);
+    HOST_CHECK(pcm[(BLOCK_FRAMES - 1) * 2] == 0);
+    audio_plc_conceal(&plc, 2, DESC_FRAMES, &frames);
+    HOST_CHECK(frames == 0);
+}
+
+int main(void)
+{
+    test_fade_continues();
+    test_crossfade_on_resume();
+    test_requested_fade_out();
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <string.h>
+#include <math.h>
+#include "host_test.h"
+#include "audio_spectrum.h"
+
+#define BLOCK_FRAMES        (240)           /* one I2S block, as in bt_app_core.c */
+
+static audio_spectrum_t s_sp;
+
+// 定点FFT与双精度DFT比较的信噪比
+static void test_fft_accuracy(void)
+{
+    static int16_t re[AUDIO_SPECTRUM_FFT_SIZE], im[AUDIO_SPECTRUM_FFT_SIZE];
+    static double x[AUDIO_SPECTRUM_FFT_SIZE];
+    const int n = AUDIO_SPECTRUM_FFT_SIZE;
+    uint32_t rnd = 1;
+    double err = 0, ref = 0, snr;
+
+    for (int i = 0; i < n; i++) {
+        rnd = rnd * 1103515245u + 12345u;
+        re[i] = (int16_t)((int32_t)(rnd >> 16) % 20000 - 10000);
+        im[i] = 0;
+        x[i] = re[i];
+    }
+    audio_spectrum_fft(&s_sp, re, im);
+    for (int k = 0; k < n / 2; k++) {
+        double r = 0, m = 0;
+
+        for (int i = 0; i < n; i++) {
+            r += x[i] * cos(2 * M_PI * k * i / n);
+            m -= x[i] * sin(2 * M_PI * k * i / n);
+        }
+        r /= n;
+        m /= n;
+        err += (r - re[k]) * (r - re[k]) + (m - im[k]) * (m - im[k]);
+        ref += r * r + m * m;
+    }
+    snr = 10 * log10(ref / err);
+    printf("%d point fixed point FFT vs double DFT: %.1f dB\n", n, snr);
+    HOST_CHECK(snr > 40);
+}
+
+// 通过处理链接口送入正弦音直到一帧采满，然后分析
+static void run_tone(double hz, double dbfs, uint32_t rate)
+{
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    const audio_chain_stage_desc_t *stage = &audio_spectrum_stage;
+    double amp = 32767 * pow(10, dbfs / 20);
+    double phase = 0;
+    int blocks = 0;
+
+    memset(s_sp.levels, 0, sizeof(s_sp.levels));
+    stage->configure(&s_sp, rate, 2);
+    HOST_CHECK(!audio_spectrum_update(&s_sp, AUDIO_SPECTRUM_LEVEL_MAX));      // first call only asks for a frame
+    while (!stage->bypassed(&s_sp)) {
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            int16_t v = (int16_t)lrint(amp * sin(phase));
+
+            phase += 2 * M_PI * hz / rate;
+            pcm[2 * i] = v;
+            pcm[2 * i + 1] = v;
+        }
+        stage->process(&s_sp, pcm, BLOCK_FRAMES, 2);
+        HOST_CHECK(++blocks < 100);
+    }
+    HOST_CHECK(audio_spectrum_update(&s_sp, AUDIO_SPECTRUM_LEVEL_MAX));
+}
+
+// 音调落在它所在频点的条上，且该条最高
+static void test_tone_bars(void)
+{
+    static const double tones[] = { 100, 400, 1000, 2500, 6000, 10000 };
+    static const uint32_t rates[] = { 16000, 44100, 48000 };
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (size_t t = 0; t < sizeof(tones) / sizeof(tones[0]); t++) {
+            int bin, expect = -1, peak = 0;
+
+            if (tones[t] >= rates[r] / 2 * 0.9) {
+                continue;
+            }
+            run_tone(tones[t], -6, rates[r]);
+            bin = (int)lrint(tones[t] * AUDIO_SPECTRUM_FFT_SIZE / s_sp.edges_rate);
+            for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+                if (bin >= s_sp.edges[b] && bin < s_sp.edges[b + 1]) {
+                    expect = b;
+                }
+                if (s_sp.levels[b] > s_sp.levels[peak]) {
+                    peak = b;
+                }
+            }
+            HOST_CHECK(expect >= 0 && peak == expect);
+            // -6 dBFS in a 60 dB range is 90, the window spreads a little of it into the next bin
+            HOST_CHECK(s_sp.levels[peak] >= 85);
+        }
+    }
+
+    // 很小的音调只点亮一点
+    run_tone(1000, -54, 44100);
+    for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+        HOST_CHECK(s_sp.levels[b] <= 15);
+    }
+}
+
+// 没有新帧时返回false，条高按给定速度回落
+static void test_drop_and_fall(void)
+{
+    uint8_t before[AUDIO_SPECTRUM_BARS];
+    uint32_t dropped;
+
+    run_tone(1000, -6, 44100);
+    memcpy(before, s_sp.levels, sizeof(before));
+    dropped = s_sp.dropped;
+    HOST_CHECK(!audio_spectrum_update(&s_sp, 7));
+    HOST_CHECK(s_sp.dropped == dropped + 1);
+    for (int b = 0; b < AUDIO_SPECTRUM_BARS; b++) {
+        HOST_CHECK(s_sp.levels[b] == ((before[b] > 7) ? before[b] - 7 : 0));
+    }
+}
+
+// 处理路径和读取方的耗时
+static void bench(void)
+{
+    static int16_t re[AUDIO_SPECTRUM_FFT_SIZE], im[AUDIO_SPECTRUM_FFT_SIZE];
+    static int16_t pcm[BLOCK_FRAMES * 2];
+    const int rounds = 20000;
+    double t0, t_fft, t_update, t_feed, t_idle;
+
+    for (int i = 0; i < AUDIO_SPECTRUM_FFT_SIZE; i++) {
+        re[i] = (int16_t)(i * 61);
+    }
+    t0 = host_now_us();
+    for (int i = 0; i < rounds; i++) {
+        audio_spectrum_fft(&s_sp, re, im);
+    }
+    t_fft = (host_now_us() - t0) / rounds;
+
+    t0 = host_now_us();
+    for (int i = 0; i < rounds; i++) {
+        atomic_store(&s_sp.ready, true);
+        audio_spectrum_update(&s_sp, 5);
+    }
+    t_update = (host_now_us() - t0) / rounds;
+
+    for (int i = 0; i < BLOCK_FRAMES * 2; i++) {
+        pcm[i] = (int16_t)(i * 61);
+    }
+    t0 = host_now_us();
+    for (int i = 0; i < rounds; i++) {
+        s_sp.frame_n = 0;
+        atomic_store(&s_sp.ready, false);
+        atomic_store(&s_sp.want, true);
+        audio_spectrum_feed(&s_sp, pcm, BLOCK_FRAMES);
+    }
+    t_feed = (host_now_us() - t0) / rounds;
+
+    atomic_store(&s_sp.want, false);
+    t0 = host_now_us();
+    for (int i = 0; i < rounds; i++) {
+        audio_spectrum_feed(&s_sp, pcm, BLOCK_FRAMES);
+    }
+    t_idle = (host_now_us() - t0) / rounds;
+
+    printf("fft %.2f us, update (window, fft, bars) %.2f us, feed %d frames %.3f us, idle feed %.3f us\n",
+           t_fft, t_update, BLOCK_FRAMES, t_feed, t_idle);
+}
+
+int main(void)
+{
+    audio_spectrum_init(&s_sp);
+    test_fft_accuracy();
+    test_tone_bars();
+    test_drop_and_fall();
+    bench();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "host_test.h"
+#include "link_power.h"
+
+#define MS(x)   ((int64_t)(x) * 1000)
+
+/* the defaults of the example configuration */
+static const link_power_config_t s_cfg = {
+    .discoverable_ms = 120000,
+    .window_ms = 1280,
+    .period_ms = 4000,
+    .slow_poll_ms = 10000,
+    .connectable_connected = true,
+};
+
+// 断开后的可被发现时段、可连接窗口和迟到的定时器
+static void test_disconnected(void)
+{
+    link_power_t lp;
+    link_power_policy_t p;
+
+    link_power_init(&lp, &s_cfg, 0);
+    link_power_update(&lp, MS(1000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_DISCOVERABLE && p.connectable && p.discoverable && !p.slow_poll);
+    HOST_CHECK(link_power_next_ms(&lp, MS(1000)) == 119000);
+
+    // 没有连接时的断开事件（重连失败）不重新开始可被发现的时段
+    link_power_on_connection(&lp, false, MS(5000));
+    HOST_CHECK(lp.entries[LINK_POWER_DISCOVERABLE] == 1);
+
+    // 定时器迟到1秒，状态仍在120秒时切换，窗口相位从那时算起
+    link_power_update(&lp, MS(121000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_WINDOWED && p.connectable && !p.discoverable);
+    HOST_CHECK(link_power_next_ms(&lp, MS(121000)) == 280);
+    link_power_update(&lp, MS(121300), &p);
+    HOST_CHECK(!p.connectable);
+    HOST_CHECK(link_power_next_ms(&lp, MS(121300)) == 2700);
+    link_power_update(&lp, MS(124000), &p);
+    HOST_CHECK(p.connectable);
+}
+
+// 按键重新可被发现：断开时重新开始时段，连接时忽略
+static void test_make_discoverable(void)
+{
+    link_power_t lp;
+    link_power_policy_t p;
+
+    link_power_init(&lp, &s_cfg, 0);
+    link_power_update(&lp, MS(300000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_WINDOWED && !p.discoverable);
+
+    HOST_CHECK(link_power_make_discoverable(&lp, MS(300000)));
+    link_power_update(&lp, MS(300000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_DISCOVERABLE && p.connectable && p.discoverable);
+    HOST_CHECK(link_power_next_ms(&lp, MS(300000)) == 120000);
+
+    // 可被发现时再按一次，时段从头开始
+    HOST_CHECK(link_power_make_discoverable(&lp, MS(400000)));
+    link_power_update(&lp, MS(500000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_DISCOVERABLE && p.discoverable);
+    link_power_update(&lp, MS(520000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_WINDOWED && !p.discoverable);
+
+    link_power_on_connection(&lp, true, MS(530000));
+    HOST_CHECK(!link_power_make_discoverable(&lp, MS(531000)));
+    link_power_update(&lp, MS(531000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_PAUSED && !p.discoverable);
+}
+
+// 连接后的音频状态、长轮询间隔和各状态时间的统计
+static void test_connected(void)
+{
+    link_power_t lp;
+    link_power_policy_t p;
+    link_power_stats_t st;
+    uint32_t sum = 0;
+
+    link_power_init(&lp, &s_cfg, 0);
+    link_power_update(&lp, MS(121000), &p);
+    link_power_on_connection(&lp, true, MS(130000));
+    link_power_update(&lp, MS(130000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_PAUSED && p.connectable && !p.discoverable && !p.slow_poll);
+
+    link_power_on_audio(&lp, true, MS(131000));
+    link_power_update(&lp, MS(200000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_STREAMING && !p.slow_poll);
+    HOST_CHECK(link_power_next_ms(&lp, MS(200000)) == 0);
+
+    link_power_on_audio(&lp, false, MS(200000));
+    HOST_CHECK(link_power_next_ms(&lp, MS(205000)) == 5000);
+    link_power_update(&lp, MS(210000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_SLOW_POLL && p.slow_poll);
+
+    // sniff 由协议栈报告，只统计时间
+    link_power_on_sniff(&lp, true, MS(212000));
+    link_power_on_audio(&lp, true, MS(220000));
+    link_power_update(&lp, MS(220000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_STREAMING && !p.slow_poll);
+    link_power_on_sniff(&lp, false, MS(220500));
+
+    link_power_on_connection(&lp, false, MS(230000));
+    link_power_update(&lp, MS(230000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_DISCOVERABLE && p.discoverable);
+
+    link_power_get_stats(&lp, MS(231000), &st);
+    HOST_CHECK(st.time_ms[LINK_POWER_DISCOVERABLE] == 121000);
+    HOST_CHECK(st.time_ms[LINK_POWER_WINDOWED] == 10000);
+    HOST_CHECK(st.time_ms[LINK_POWER_STREAMING] == 69000 + 10000);
+    HOST_CHECK(st.time_ms[LINK_POWER_PAUSED] == 1000 + 10000);
+    HOST_CHECK(st.time_ms[LINK_POWER_SLOW_POLL] == 10000);
+    HOST_CHECK(st.sniff_ms == 8500 && st.sniffs == 1);
+    for (int i = 0; i < LINK_POWER_STATES; i++) {
+        sum += st.time_ms[i];
+    }
+    HOST_CHECK(sum == 231000);
+}
+
+// 一直可被发现、一直可被连接、从不请求长轮询间隔的配置没有定时
+static void test_always_on(void)
+{
+    const link_power_config_t cfg = { .discoverable_ms = 0, .window_ms = 1280, .period_ms = 1280, .slow_poll_ms = 0 };
+    link_power_t lp;
+    link_power_policy_t p;
+
+    link_power_init(&lp, &cfg, 0);
+    link_power_update(&lp, MS(1000000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_DISCOVERABLE && link_power_next_ms(&lp, MS(1000000)) == 0);
+
+    link_power_on_connection(&lp, true, MS(1000000));
+    link_power_update(&lp, MS(2000000), &p);
+    HOST_CHECK(lp.state == LINK_POWER_PAUSED && !p.slow_poll && link_power_next_ms(&lp, MS(2000000)) == 0);
+}
+
+int main(void)
+{
+    test_disconnected();
+    test_make_discoverable();
+    test_connected();
+    test_always_on();
+    return 0;
+}
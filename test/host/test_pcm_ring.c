@@ -0,0 +1,303 @@
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "host_test.h"
+#include "pcm_ring.h"
+
+/* same geometry as the I2S ring in bt_app_core.c */
+#define RING_SIZE           (32 * 1024)
+#define RING_MIRROR         (4 * 1024)
+#define CONSUMER_BYTES      (240 * 4)       /* one I2S block of 16 bit stereo */
+#define STREAM_BYTES        (64u * 1024 * 1024)
+
+/*
+ * Host model of a FreeRTOS RINGBUF_TYPE_BYTEBUF as the sink used it before the lock-free ring:
+ * xRingbufferSend copies in, xRingbufferReceiveUpTo hands out a pointer that stops at the wrap
+ * and vRingbufferReturnItem frees it, every call inside the ring's critical section.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    uint8_t         *buf;
+    size_t          size;
+    size_t          read;
+    size_t          write;
+    size_t          fill;
+    size_t          held;
+} bytebuf_t;
+
+static bool bytebuf_send(bytebuf_t *rb, const uint8_t *data, size_t len)
+{
+    bool ok = false;
+
+    pthread_mutex_lock(&rb->lock);
+    if (rb->size - rb->fill >= len) {
+        size_t first = rb->size - rb->write;
+
+        if (first > len) {
+            first = len;
+        }
+        memcpy(rb->buf + rb->write, data, first);
+        memcpy(rb->buf, data + first, len - first);
+        rb->write = (rb->write + len) % rb->size;
+        rb->fill += len;
+        ok = true;
+    }
+    pthread_mutex_unlock(&rb->lock);
+    return ok;
+}
+
+static size_t bytebuf_receive_up_to(bytebuf_t *rb, uint8_t **data, size_t max)
+{
+    size_t len;
+
+    pthread_mutex_lock(&rb->lock);
+    len = rb->fill;
+    if (len > rb->size - rb->read) {
+        len = rb->size - rb->read;
+    }
+    if (len > max) {
+        len = max;
+    }
+    *data = rb->buf + rb->read;
+    rb->held = len;
+    pthread_mutex_unlock(&rb->lock);
+    return len;
+}
+
+static void bytebuf_return_item(bytebuf_t *rb)
+{
+    pthread_mutex_lock(&rb->lock);
+    rb->read = (rb->read + rb->held) % rb->size;
+    rb->fill -= rb->held;
+    rb->held = 0;
+    pthread_mutex_unlock(&rb->lock);
+}
+
+/* per-call latencies of one side, nanoseconds */
+typedef struct {
+    uint32_t        *ns;
+    size_t          count;
+    size_t          cap;
+} latency_t;
+
+// 记录一次调用的耗时
+static void latency_add(latency_t *lat, double t0, double t1)
+{
+    if (lat->count == lat->cap) {
+        lat->cap = (lat->cap == 0) ? 65536 : lat->cap * 2;
+        lat->ns = realloc(lat->ns, lat->cap * sizeof(uint32_t));
+        HOST_CHECK(lat->ns != NULL);
+    }
+    lat->ns[lat->count++] = (uint32_t)((t1 - t0) * 1000.0);
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// 排序后取最大值和 p99（微秒），并释放样本
+static void latency_stats(latency_t *lat, double *max_us, double *p99_us)
+{
+    HOST_CHECK(lat->count > 0);
+    qsort(lat->ns, lat->count, sizeof(uint32_t), latency_cmp);
+    *max_us = lat->ns[lat->count - 1] / 1000.0;
+    *p99_us = lat->ns[(lat->count * 99) / 100] / 1000.0;
+    free(lat->ns);
+    memset(lat, 0, sizeof(latency_t));
+}
+
+/* byte n of the stream is (uint8_t)n, both sides copy or compare against this */
+static uint8_t s_pattern[4096 + 256];
+
+/* one producer thread of A2DP sized packets, one consumer of I2S blocks */
+typedef struct {
+    bool            lock_free;
+    pcm_ring_t      ring;
+    bytebuf_t       model;
+    atomic_bool     failed;
+    latency_t       put;        /* producer: reserve, copy and commit, or send */
+    latency_t       get;        /* consumer: peek, check and release, or receive, check and return */
+} stream_t;
+
+/* what one stream_run measured */
+typedef struct {
+    double          mb_s;
+    double          put_max_us;
+    double          put_p99_us;
+    double          get_max_us;
+    double          get_p99_us;
+} stream_result_t;
+
+// 生产者：按A2DP包的大小写入递增的字节序列
+static void *stream_producer(void *arg)
+{
+    stream_t *s = arg;
+    uint32_t seq = 0;
+    uint32_t rnd = 1;
+
+    for (uint32_t sent = 0; sent < STREAM_BYTES;) {
+        rnd = rnd * 1103515245u + 12345u;
+        size_t len = 512 + (rnd >> 16) % 2049;      // 512..2560 bytes, SBC frames decode to about 2 KB
+
+        if (len > STREAM_BYTES - sent) {
+            len = STREAM_BYTES - sent;
+        }
+        /* only the call that succeeds is timed, waiting for room is not the ring's latency */
+        double t0 = host_now_us();
+        if (s->lock_free) {
+            uint8_t *span;
+
+            while (pcm_ring_reserve(&s->ring, &span, len) != len) {
+                sched_yield();
+                t0 = host_now_us();
+            }
+            memcpy(span, s_pattern + (seq & 0xff), len);
+            pcm_ring_commit(&s->ring, len);
+        } else {
+            while (!bytebuf_send(&s->model, s_pattern + (seq & 0xff), len)) {
+                sched_yield();
+                t0 = host_now_us();
+            }
+        }
+        latency_add(&s->put, t0, host_now_us());
+        seq += len;
+        sent += len;
+    }
+    return NULL;
+}
+
+// 消费者：按I2S块读取并校验
+static void stream_consume(stream_t *s)
+{
+    uint32_t seq = 0;
+
+    while (seq < STREAM_BYTES) {
+        uint8_t *data;
+        double t0 = host_now_us();
+        size_t len = s->lock_free ? pcm_ring_peek(&s->ring, &data, CONSUMER_BYTES)
+                                  : bytebuf_receive_up_to(&s->model, &data, CONSUMER_BYTES);
+
+        if (len == 0) {
+            sched_yield();
+            continue;
+        }
+        if (memcmp(data, s_pattern + (seq & 0xff), len) != 0) {
+            atomic_store(&s->failed, true);
+        }
+        seq += len;
+        if (s->lock_free) {
+            pcm_ring_release(&s->ring, len);
+        } else {
+            bytebuf_return_item(&s->model);
+        }
+        latency_add(&s->get, t0, host_now_us());
+    }
+}
+
+// 两个线程跑完整个数据流，得到吞吐量和两侧每次调用的耗时
+static void stream_run(bool lock_free, stream_result_t *res)
+{
+    static uint8_t storage[RING_SIZE + RING_MIRROR];
+    stream_t s = { .lock_free = lock_free };
+    pthread_t producer;
+    double t0, t1;
+
+    HOST_CHECK(pcm_ring_init(&s.ring, storage, RING_SIZE, RING_MIRROR));
+    pthread_mutex_init(&s.model.lock, NULL);
+    s.model.buf = storage;
+    s.model.size = RING_SIZE;
+    atomic_init(&s.failed, false);
+
+    t0 = host_now_us();
+    HOST_CHECK(pthread_create(&producer, NULL, stream_producer, &s) == 0);
+    stream_consume(&s);
+    pthread_join(producer, NULL);
+    t1 = host_now_us();
+
+    pthread_mutex_destroy(&s.model.lock);
+    HOST_CHECK(!atomic_load(&s.failed));
+    res->mb_s = STREAM_BYTES / (t1 - t0);
+    latency_stats(&s.put, &res->put_max_us, &res->put_p99_us);
+    latency_stats(&s.get, &res->get_max_us, &res->get_p99_us);
+}
+
+// 单线程随机读写，小容量让每次请求都可能跨越回绕点
+static void test_random_spans(void)
+{
+    static uint8_t storage[64 + 16];
+    pcm_ring_t ring;
+    uint32_t written = 0, read = 0;
+    uint32_t rnd = 1;
+
+    HOST_CHECK(pcm_ring_init(&ring, storage, 64, 16));
+    for (int i = 0; i < 1000000; i++) {
+        uint8_t *span;
+
+        rnd = rnd * 1103515245u + 12345u;
+        size_t want = (rnd >> 16) % 17;
+
+        if (rnd & 0x80000000u) {
+            size_t got = pcm_ring_reserve(&ring, &span, want);
+
+            HOST_CHECK(got == 0 || got == want);
+            HOST_CHECK(got == want || ring.size - pcm_ring_fill(&ring) < want);
+            for (size_t k = 0; k < got; k++) {
+                span[k] = (uint8_t)(written + k);
+            }
+            pcm_ring_commit(&ring, got);
+            written += got;
+        } else {
+            size_t got = pcm_ring_peek(&ring, &span, want);
+
+            HOST_CHECK(got <= want && got <= pcm_ring_fill(&ring));
+            for (size_t k = 0; k < got; k++) {
+                HOST_CHECK(span[k] == (uint8_t)(read + k));
+            }
+            pcm_ring_release(&ring, got);
+            read += got;
+        }
+        HOST_CHECK(pcm_ring_fill(&ring) == written - read);
+    }
+}
+
+// 参数检查
+static void test_init(void)
+{
+    static uint8_t storage[128];
+    pcm_ring_t ring;
+
+    HOST_CHECK(!pcm_ring_init(&ring, storage, 96, 16));     // not a power of two
+    HOST_CHECK(!pcm_ring_init(&ring, storage, 64, 48));     // mirror over half the ring
+    HOST_CHECK(pcm_ring_init(&ring, storage, 64, 32));
+    HOST_CHECK(pcm_ring_fill(&ring) == 0);
+}
+
+// 一种模式的吞吐量和每次调用的耗时
+static void stream_print(const char *name, const stream_result_t *res)
+{
+    printf("  %-14s %6.0f MB/s, producer max %7.1f p99 %5.2f us, consumer max %7.1f p99 %5.2f us\n",
+           name, res->mb_s, res->put_max_us, res->put_p99_us, res->get_max_us, res->get_p99_us);
+}
+
+int main(void)
+{
+    stream_result_t lock_free, model;
+
+    for (size_t i = 0; i < sizeof(s_pattern); i++) {
+        s_pattern[i] = (uint8_t)i;
+    }
+    test_init();
+    test_random_spans();
+
+    stream_run(false, &model);
+    stream_run(true, &lock_free);
+    printf("%u MB, %u byte consumer reads (x%.2f throughput):\n",
+           STREAM_BYTES >> 20, CONSUMER_BYTES, lock_free.mb_s / model.mb_s);
+    stream_print("bytebuf model", &model);
+    stream_print("pcm_ring", &lock_free);
+    return 0;
+}